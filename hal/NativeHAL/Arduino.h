@@ -0,0 +1,111 @@
+/**
+ * @file Arduino.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for the Arduino core. Provides the subset of the Arduino API which is used by TuneStudio2560
+ * and its libraries, backed by the virtual clock and emulated registers in hal.cpp.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_arduino_h
+#define hal_arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <Print.h>
+#include <hal.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000L
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define PIN_A0 (54)
+#define PIN_A1 (55)
+#define PIN_A2 (56)
+#define PIN_A3 (57)
+#define PIN_A4 (58)
+#define PIN_A5 (59)
+#define PIN_A6 (60)
+#define PIN_A7 (61)
+
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : ((p) >= 18 && (p) <= 21 ? 23 - (p) : NOT_AN_INTERRUPT)))
+
+#define digitalPinToPort(P) (hal::pin_port(P))
+#define digitalPinToBitMask(P) (hal::pin_mask(P))
+#define portOutputRegister(P) (hal::port_register((P), 0))
+#define portModeRegister(P) (hal::port_register((P), 1))
+#define portInputRegister(P) (hal::port_register((P), 2))
+
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+#define clockCyclesToMicroseconds(a) ((a) / clockCyclesPerMicrosecond())
+#define microsecondsToClockCycles(a) ((a) * clockCyclesPerMicrosecond())
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void interrupts();
+void noInterrupts();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/** @brief avr-libc extension which is not part of glibc. */
+char* itoa(int value, char* str, int base);
+/** @brief avr-libc extension which is not part of glibc. */
+char* utoa(unsigned int value, char* str, int base);
+
+/**
+ * @brief The serial monitor. Writes to the standard output of the simulator.
+ */
+class HardwareSerial: public Stream {
+  public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  operator bool() { return true; }
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t value) override;
+  void flush() override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+void setup();
+void loop();
+
+#endif
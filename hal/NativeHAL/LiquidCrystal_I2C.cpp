@@ -0,0 +1,107 @@
+/**
+ * @file LiquidCrystal_I2C.cpp
+ * @author Jacob LuVisi
+ * @brief Native HAL implementation of the emulated 20x4 I2C LCD.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <LiquidCrystal_I2C.h>
+
+namespace {
+  /** @brief DDRAM address of the first column of each row. */
+  const uint8_t ROW_OFFSETS[4] = {0x00, 0x40, 0x14, 0x54};
+  /** @brief Readable symbols for the custom characters in CUSTOM_LCD_CHARS (note, play, pause, block, finished, empty block). */
+  const char CUSTOM_SYMBOLS[8] = {'&', '>', '"', '#', '$', '_', '?', '?'};
+}
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcdAddr, uint8_t lcdCols, uint8_t lcdRows) {
+  (void)lcdAddr;
+  _cols = lcdCols;
+  _rows = lcdRows;
+  _address = 0;
+  _backlight = false;
+  memset(_ddram, ' ', sizeof(_ddram));
+  memset(_cgram, 0, sizeof(_cgram));
+}
+
+void LiquidCrystal_I2C::send() {
+  hal::stats().lcdBytes++;
+  hal::advance(HAL_COST_LCD_BYTE);
+}
+
+void LiquidCrystal_I2C::init() {
+  begin(_cols, _rows);
+}
+
+void LiquidCrystal_I2C::begin(uint8_t cols, uint8_t rows, uint8_t charSize) {
+  (void)charSize;
+  _cols = cols;
+  _rows = rows;
+  // Function set, display control, entry mode.
+  for (uint8_t i = 0; i < 6; i++) send();
+  clear();
+}
+
+void LiquidCrystal_I2C::clear() {
+  send();
+  hal::advance(HAL_COST_LCD_CLEAR);
+  memset(_ddram, ' ', sizeof(_ddram));
+  _address = 0;
+}
+
+void LiquidCrystal_I2C::home() {
+  send();
+  hal::advance(HAL_COST_LCD_CLEAR);
+  _address = 0;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+  if (row >= _rows) row = _rows - 1;
+  send();
+  _address = (col + ROW_OFFSETS[row]) & 0x7F;
+}
+
+void LiquidCrystal_I2C::backlight() {
+  _backlight = true;
+  send();
+}
+
+void LiquidCrystal_I2C::noBacklight() {
+  _backlight = false;
+  send();
+}
+
+void LiquidCrystal_I2C::createChar(uint8_t location, uint8_t charmap[]) {
+  location &= 0x07;
+  send();
+  for (uint8_t i = 0; i < 8; i++) {
+    _cgram[location][i] = charmap[i];
+    send();
+  }
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t value) {
+  send();
+  _ddram[_address] = value;
+  // The HD44780 address counter jumps from the end of the first line (0x27) to the second line (0x40) and back to 0 at 0x67.
+  _address++;
+  if (_address == 0x28) _address = 0x40;
+  else if (_address >= 0x68) _address = 0x00;
+  return 1;
+}
+
+uint8_t LiquidCrystal_I2C::hal_char_at(uint8_t col, uint8_t row) const {
+  if (col >= _cols || row >= _rows) return ' ';
+  return _ddram[ROW_OFFSETS[row] + col];
+}
+
+void LiquidCrystal_I2C::hal_row_text(uint8_t row, char* buffer) const {
+  for (uint8_t col = 0; col < _cols; col++) {
+    const uint8_t c = hal_char_at(col, row);
+    buffer[col] = c < 8 ? CUSTOM_SYMBOLS[c] : (c < 0x20 || c > 0x7E ? '?' : (char)c);
+  }
+  buffer[_cols] = '\0';
+}
@@ -0,0 +1,65 @@
+/**
+ * @file LiquidCrystal_I2C.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for the LiquidCrystal_I2C library.
+ *
+ * Emulates the HD44780 display data RAM (DDRAM) and address counter so text wraps between rows the same way it does on the
+ * real 20x4 display. Every byte sent to the display charges the virtual clock with HAL_COST_LCD_BYTE.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_liquid_crystal_i2c_h
+#define hal_liquid_crystal_i2c_h
+
+#include <Arduino.h>
+
+class LiquidCrystal_I2C: public Print {
+  private:
+  uint8_t _cols;
+  uint8_t _rows;
+  /** @brief The DDRAM address counter. */
+  uint8_t _address;
+  /** @brief Display data RAM. Row offsets are 0x00, 0x40, 0x14, 0x54 for a 20x4 display. */
+  uint8_t _ddram[0x80];
+  /** @brief Custom character generator RAM. */
+  uint8_t _cgram[8][8];
+  bool _backlight;
+
+  /** @brief Charge the clock for sending a byte to the display. */
+  void send();
+  public:
+  LiquidCrystal_I2C(uint8_t lcdAddr, uint8_t lcdCols, uint8_t lcdRows);
+  void init();
+  void begin(uint8_t cols, uint8_t rows, uint8_t charSize = 0);
+  void clear();
+  void home();
+  void setCursor(uint8_t col, uint8_t row);
+  void backlight();
+  void noBacklight();
+  void createChar(uint8_t location, uint8_t charmap[]);
+  size_t write(uint8_t value) override;
+  using Print::write;
+
+  /**
+   * @brief [HAL ONLY] Get the character currently shown at a cell of the display.
+   *
+   * @param col The column.
+   * @param row The row.
+   * @return The character code (0-7 for custom characters).
+   */
+  uint8_t hal_char_at(uint8_t col, uint8_t row) const;
+
+  /**
+   * @brief [HAL ONLY] Get a row of the display as text. Custom characters are replaced by a readable symbol.
+   *
+   * @param row The row.
+   * @param buffer A buffer of at least cols + 1 characters.
+   */
+  void hal_row_text(uint8_t row, char* buffer) const;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file Print.cpp
+ * @author Jacob LuVisi
+ * @brief Native HAL implementation of the Arduino Print class.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <Print.h>
+#include <string.h>
+#include <stdio.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::write(const char* str) {
+  return str == nullptr ? 0 : write((const uint8_t*)str, strlen(str));
+}
+
+size_t Print::print_number(unsigned long n, uint8_t base) {
+  char buffer[8 * sizeof(long) + 1];
+  char* str = &buffer[sizeof(buffer) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    const char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+size_t Print::print(const __FlashStringHelper* text) { return write(reinterpret_cast<const char*>(text)); }
+size_t Print::print(const char text[]) { return write(text); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char n, int base) { return print((unsigned long)n, base); }
+size_t Print::print(int n, int base) { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base) { return print((unsigned long)n, base); }
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) {
+    return write((uint8_t)'-') + print_number(-(unsigned long)n, DEC);
+  }
+  return print_number((unsigned long)n, base);
+}
+size_t Print::print(unsigned long n, int base) { return print_number(n, base); }
+size_t Print::print(double n, int digits) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return write(buffer);
+}
+
+size_t Print::println() { return write("\r\n"); }
+size_t Print::println(const __FlashStringHelper* text) { return print(text) + println(); }
+size_t Print::println(const char text[]) { return print(text) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char n, int base) { return print(n, base) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
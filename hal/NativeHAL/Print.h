@@ -0,0 +1,68 @@
+/**
+ * @file Print.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for the Arduino Print and Stream classes.
+ * Only the overloads which are used by TuneStudio2560 and its libraries are provided.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_print_h
+#define hal_print_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+/** @brief Marks a string as being stored in PROGMEM. On the host it is an ordinary string. */
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class Print {
+  private:
+  size_t print_number(unsigned long n, uint8_t base);
+  public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str);
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+  size_t print(const __FlashStringHelper* text);
+  size_t print(const char text[]);
+  size_t print(char c);
+  size_t print(unsigned char n, int base = DEC);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println();
+  size_t println(const __FlashStringHelper* text);
+  size_t println(const char text[]);
+  size_t println(char c);
+  size_t println(unsigned char n, int base = DEC);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+  size_t println(double n, int digits = 2);
+
+  virtual void flush() {}
+};
+
+class Stream: public Print {
+  public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file SPI.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for the Arduino SPI library. Only the settings object which SdFat takes is needed.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_spi_h
+#define hal_spi_h
+
+#include <Arduino.h>
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define SPI_MODE0 0x00
+
+class SPISettings {
+  public:
+  SPISettings(uint32_t clockIn = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0): clock(clockIn) {
+    (void)bitOrder;
+    (void)dataMode;
+  }
+  /** @brief The requested SPI clock in hz. */
+  uint32_t clock;
+};
+
+#endif
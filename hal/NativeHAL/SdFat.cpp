@@ -0,0 +1,541 @@
+/**
+ * @file SdFat.cpp
+ * @author Jacob LuVisi
+ * @brief Native HAL implementation of the emulated SD card.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <SdFat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+
+static_assert(O_CREAT == 0x10, "SdFat open flags must not come from the host fcntl.h");
+
+/** @brief Size of a FAT directory entry. */
+constexpr uint8_t HAL_DIR_ENTRY_SIZE = 32;
+/** @brief Longest path (relative to the root of the card) the HAL supports. */
+constexpr uint8_t HAL_PATH_LENGTH = 64;
+/** @brief The amount of directories the HAL keeps slot tables for. */
+constexpr uint8_t HAL_MAX_DIRECTORIES = 8;
+
+struct HalFileState {
+  /** @brief The amount of File objects which share this state. */
+  uint16_t references;
+  /** @brief Path relative to the root of the card without a leading slash ("" for the root directory). */
+  char path[HAL_PATH_LENGTH];
+  bool directory;
+  FILE* handle;
+  uint8_t flags;
+  uint32_t position;
+  uint32_t size;
+  /** @brief Slot of the entry in its parent directory. */
+  uint16_t dirIndex;
+  /** @brief The next slot that openNextFile() will read for a directory. */
+  uint16_t dirCursor;
+};
+
+namespace {
+  /** @brief Entry slots of a directory on the card. Empty names are deleted (free) entries. */
+  struct DirectorySlots {
+    char path[HAL_PATH_LENGTH];
+    char (*names)[HAL_PATH_LENGTH];
+    uint16_t count;
+  };
+
+  DirectorySlots directories[HAL_MAX_DIRECTORIES];
+  uint8_t directoryCount = 0;
+
+  /** @brief Copy a path without the leading and trailing slashes. */
+  void normalize(const char* path, char* result) {
+    if (path == nullptr) path = "";
+    while (*path == '/') path++;
+    strncpy(result, path, HAL_PATH_LENGTH - 1);
+    result[HAL_PATH_LENGTH - 1] = '\0';
+    size_t length = strlen(result);
+    while (length > 0 && result[length - 1] == '/') result[--length] = '\0';
+  }
+
+  /** @brief Split a path into its parent directory and its name. */
+  void split_path(const char* path, char* parent, const char** name) {
+    const char* split = strrchr(path, '/');
+    if (split == nullptr) {
+      parent[0] = '\0';
+      *name = path;
+      return;
+    }
+    memcpy(parent, path, split - path);
+    parent[split - path] = '\0';
+    *name = split + 1;
+  }
+
+  void join_path(const char* dir, const char* name, char* result) {
+    snprintf(result, HAL_PATH_LENGTH, dir[0] == '\0' ? "%s%s" : "%s/%s", dir, name);
+  }
+
+  void host_path(const char* path, char* result, size_t size) {
+    snprintf(result, size, path[0] == '\0' ? "%s%s" : "%s/%s", hal::get_sd_root(), path);
+  }
+
+  bool host_stat(const char* path, struct stat* info) {
+    char host[512];
+    host_path(path, host, sizeof(host));
+    return stat(host, info) == 0;
+  }
+
+  void charge_sector() {
+    hal::stats().sdSectors++;
+    hal::advance(HAL_COST_SD_COMMAND);
+    hal::sd_transfer(HAL_SD_SECTOR_SIZE);
+  }
+
+  int compare_names(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+  }
+
+  void append_slot(DirectorySlots& slots, const char* name) {
+    // Grow the table in blocks of 32 entries.
+    if (slots.count % 32 == 0) {
+      slots.names = (char (*)[HAL_PATH_LENGTH])realloc(slots.names, (slots.count + 32) * HAL_PATH_LENGTH);
+    }
+    strncpy(slots.names[slots.count], name, HAL_PATH_LENGTH - 1);
+    slots.names[slots.count][HAL_PATH_LENGTH - 1] = '\0';
+    slots.count++;
+  }
+
+  /** @brief Get the slot table of a directory. Entries which already exist on the host are added in name order. */
+  DirectorySlots& slots_of(const char* dir) {
+    for (uint8_t i = 0; i < directoryCount; i++) {
+      if (strcmp(directories[i].path, dir) == 0) return directories[i];
+    }
+    if (directoryCount == HAL_MAX_DIRECTORIES) {
+      fprintf(stderr, "[hal] SdFat: too many directories.\n");
+      hal::finish(3);
+    }
+    DirectorySlots& slots = directories[directoryCount++];
+    strcpy(slots.path, dir);
+    slots.names = nullptr;
+    slots.count = 0;
+    char host[512];
+    host_path(dir, host, sizeof(host));
+    DIR* handle = opendir(host);
+    if (handle != nullptr) {
+      while (struct dirent* entry = readdir(handle)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        append_slot(slots, entry->d_name);
+      }
+      closedir(handle);
+    }
+    if (slots.count > 0) qsort(slots.names, slots.count, HAL_PATH_LENGTH, compare_names);
+    return slots;
+  }
+
+  int find_slot(const char* path) {
+    char parent[HAL_PATH_LENGTH];
+    const char* name;
+    split_path(path, parent, &name);
+    const DirectorySlots& slots = slots_of(parent);
+    for (uint16_t i = 0; i < slots.count; i++) {
+      if (strcasecmp(slots.names[i], name) == 0) return i;
+    }
+    return -1;
+  }
+
+  /** @brief Put a new entry in the first free slot of its directory (same as FAT). */
+  uint16_t add_slot(const char* path) {
+    char parent[HAL_PATH_LENGTH];
+    const char* name;
+    split_path(path, parent, &name);
+    DirectorySlots& slots = slots_of(parent);
+    for (uint16_t i = 0; i < slots.count; i++) {
+      if (slots.names[i][0] == '\0') {
+        strncpy(slots.names[i], name, HAL_PATH_LENGTH - 1);
+        return i;
+      }
+    }
+    append_slot(slots, name);
+    return slots.count - 1;
+  }
+
+  void free_slot(const char* path) {
+    const int slot = find_slot(path);
+    if (slot < 0) return;
+    char parent[HAL_PATH_LENGTH];
+    const char* name;
+    split_path(path, parent, &name);
+    slots_of(parent).names[slot][0] = '\0';
+  }
+
+  HalFileState* open_state(const char* path, uint8_t flags) {
+    hal::stats().sdOpens++;
+    hal::advance(HAL_COST_SD_COMMAND);
+    struct stat info;
+    const bool exists = host_stat(path, &info);
+    if (!exists && !(flags & O_CREAT)) return nullptr;
+    if (exists && (flags & O_CREAT) && (flags & O_EXCL)) return nullptr;
+
+    HalFileState* state = (HalFileState*)calloc(1, sizeof(HalFileState));
+    state->references = 1;
+    strcpy(state->path, path);
+    state->directory = exists && S_ISDIR(info.st_mode);
+    state->flags = flags;
+
+    if (state->directory) {
+      if ((flags & O_ACCMODE) != O_RDONLY) {
+        free(state);
+        return nullptr;
+      }
+      state->dirIndex = path[0] == '\0' ? 0 : find_slot(path);
+      return state;
+    }
+
+    char host[512];
+    host_path(path, host, sizeof(host));
+    const bool writable = (flags & O_ACCMODE) != O_RDONLY;
+    state->handle = fopen(host, !writable ? "rb" : (!exists || (flags & O_TRUNC) ? "w+b" : "r+b"));
+    if (state->handle == nullptr) {
+      free(state);
+      return nullptr;
+    }
+    if (!exists) {
+      // Creating an entry writes to the directory sector.
+      charge_sector();
+      state->dirIndex = add_slot(path);
+    } else {
+      state->dirIndex = find_slot(path);
+    }
+    fseek(state->handle, 0, SEEK_END);
+    state->size = ftell(state->handle);
+    state->position = (flags & (O_AT_END | O_APPEND)) ? state->size : 0;
+    fseek(state->handle, state->position, SEEK_SET);
+    return state;
+  }
+}
+
+//////////////
+//// FILE ////
+//////////////
+
+File::File(): _state(nullptr) {}
+
+File::File(HalFileState* state): _state(state) {}
+
+File::File(const File& other): _state(other._state) {
+  if (_state != nullptr) _state->references++;
+}
+
+File& File::operator=(const File& other) {
+  if (other._state != nullptr) other._state->references++;
+  release();
+  _state = other._state;
+  return *this;
+}
+
+File::~File() {
+  release();
+}
+
+void File::release() {
+  if (_state == nullptr) return;
+  if (--_state->references == 0) {
+    // Like SdFat, an open file which is never closed is not synced.
+    if (_state->handle != nullptr) fclose(_state->handle);
+    free(_state);
+  }
+  _state = nullptr;
+}
+
+File::operator bool() const {
+  return isOpen();
+}
+
+bool File::isOpen() const {
+  return _state != nullptr;
+}
+
+bool File::isDirectory() const {
+  return _state != nullptr && _state->directory;
+}
+
+bool File::isFile() const {
+  return _state != nullptr && !_state->directory;
+}
+
+int File::available() {
+  hal::advance(HAL_COST_SD_CALL);
+  if (!isFile()) return 0;
+  const uint32_t remaining = _state->size - _state->position;
+  return remaining > 0x7FFF ? 0x7FFF : remaining;
+}
+
+int File::read() {
+  uint8_t value;
+  return read(&value, 1) == 1 ? value : -1;
+}
+
+int File::peek() {
+  hal::advance(HAL_COST_SD_CALL);
+  if (!isFile() || _state->position >= _state->size) return -1;
+  const int value = fgetc(_state->handle);
+  fseek(_state->handle, _state->position, SEEK_SET);
+  return value;
+}
+
+int File::read(void* buffer, size_t size) {
+  hal::advance(HAL_COST_SD_CALL);
+  if (!isFile()) return -1;
+  if (size > _state->size - _state->position) size = _state->size - _state->position;
+  if (size == 0) return 0;
+  // Charge every sector that the read starts in or crosses into (SdFat caches one sector).
+  const uint32_t first = _state->position / HAL_SD_SECTOR_SIZE;
+  const uint32_t last = (_state->position + size - 1) / HAL_SD_SECTOR_SIZE;
+  for (uint32_t sector = first; sector <= last; sector++) {
+    if (sector != first || _state->position % HAL_SD_SECTOR_SIZE == 0) charge_sector();
+  }
+  const size_t count = fread(buffer, 1, size, _state->handle);
+  _state->position += count;
+  if (hal::is_sd_clock_too_fast()) {
+    for (size_t i = 0; i < count; i++) ((uint8_t*)buffer)[i] ^= 1;
+  }
+  return count;
+}
+
+size_t File::write(uint8_t value) {
+  return write(&value, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  hal::advance(HAL_COST_SD_CALL);
+  if (!isFile() || (_state->flags & O_ACCMODE) == O_RDONLY || size == 0) return 0;
+  // A sector is written back to the card every time the write crosses the end of the cached sector.
+  const uint32_t first = _state->position / HAL_SD_SECTOR_SIZE;
+  const uint32_t last = (_state->position + size) / HAL_SD_SECTOR_SIZE;
+  for (uint32_t sector = first; sector < last; sector++) charge_sector();
+  fseek(_state->handle, _state->position, SEEK_SET);
+  const size_t count = fwrite(buffer, 1, size, _state->handle);
+  _state->position += count;
+  if (_state->position > _state->size) _state->size = _state->position;
+  return count;
+}
+
+void File::flush() {
+  sync();
+}
+
+bool File::sync() {
+  if (!isFile()) return false;
+  if ((_state->flags & O_ACCMODE) != O_RDONLY) {
+    // Write the cached data sector and update the directory entry.
+    charge_sector();
+    charge_sector();
+    fflush(_state->handle);
+  }
+  return true;
+}
+
+bool File::close() {
+  if (!isOpen()) return false;
+  if (isFile()) {
+    sync();
+    fclose(_state->handle);
+    _state->handle = nullptr;
+  }
+  release();
+  return true;
+}
+
+uint32_t File::fileSize() const {
+  return isFile() ? _state->size : 0;
+}
+
+uint32_t File::curPosition() const {
+  return isFile() ? _state->position : 0;
+}
+
+uint32_t File::position() const {
+  return curPosition();
+}
+
+bool File::seekSet(uint32_t pos) {
+  hal::advance(HAL_COST_SD_CALL);
+  if (!isFile() || pos > _state->size) return false;
+  // Seeking into a different sector means it has to be read on the next access.
+  if (pos / HAL_SD_SECTOR_SIZE != _state->position / HAL_SD_SECTOR_SIZE && pos % HAL_SD_SECTOR_SIZE != 0) charge_sector();
+  _state->position = pos;
+  fseek(_state->handle, pos, SEEK_SET);
+  return true;
+}
+
+bool File::seek(uint32_t pos) {
+  return seekSet(pos);
+}
+
+bool File::truncate(uint32_t length) {
+  if (!isFile() || (_state->flags & O_ACCMODE) == O_RDONLY || length > _state->size) return false;
+  // Freeing the clusters past the new end updates the FAT.
+  charge_sector();
+  fflush(_state->handle);
+  if (ftruncate(fileno(_state->handle), length) != 0) return false;
+  _state->size = length;
+  if (_state->position > length) _state->position = length;
+  fseek(_state->handle, _state->position, SEEK_SET);
+  return true;
+}
+
+bool File::getName(char* name, size_t size) {
+  char parent[HAL_PATH_LENGTH];
+  const char* entryName = "/";
+  if (isOpen() && _state->path[0] != '\0') split_path(_state->path, parent, &entryName);
+  if (!isOpen() || size == 0 || strlen(entryName) >= size) {
+    if (size != 0) name[0] = '\0';
+    return false;
+  }
+  strcpy(name, entryName);
+  return true;
+}
+
+bool File::getModifyDateTime(uint16_t* pdate, uint16_t* ptime) {
+  hal::advance(HAL_COST_SD_CALL);
+  struct stat info;
+  if (!isOpen() || !host_stat(_state->path, &info)) return false;
+  struct tm modified;
+  localtime_r(&info.st_mtime, &modified);
+  // Same packing as the FAT directory entry.
+  *pdate = ((modified.tm_year - 80) << 9) | ((modified.tm_mon + 1) << 5) | modified.tm_mday;
+  *ptime = (modified.tm_hour << 11) | (modified.tm_min << 5) | (modified.tm_sec >> 1);
+  return true;
+}
+
+uint16_t File::dirIndex() const {
+  return isOpen() ? _state->dirIndex : 0;
+}
+
+File File::openNextFile(uint8_t mode) {
+  if (!isDirectory()) return File();
+  const DirectorySlots& slots = slots_of(_state->path);
+  while (_state->dirCursor < slots.count) {
+    const uint16_t slot = _state->dirCursor++;
+    // Reading a directory entry. A new sector is read every 16 entries.
+    hal::advance(HAL_COST_SD_CALL);
+    if ((slot * HAL_DIR_ENTRY_SIZE) % HAL_SD_SECTOR_SIZE == 0) charge_sector();
+    if (slots.names[slot][0] == '\0') continue;
+    char path[HAL_PATH_LENGTH];
+    join_path(_state->path, slots.names[slot], path);
+    HalFileState* state = open_state(path, mode);
+    if (state != nullptr) {
+      state->dirIndex = slot;
+      return File(state);
+    }
+  }
+  return File();
+}
+
+void File::rewindDirectory() {
+  if (isDirectory()) _state->dirCursor = 0;
+}
+
+bool File::open(File* dirFile, uint16_t index, uint8_t oflag) {
+  close();
+  if (dirFile == nullptr || !dirFile->isDirectory()) return false;
+  const DirectorySlots& slots = slots_of(dirFile->_state->path);
+  // Reading the directory sector which holds the entry.
+  charge_sector();
+  if (index >= slots.count || slots.names[index][0] == '\0') return false;
+  char path[HAL_PATH_LENGTH];
+  join_path(dirFile->_state->path, slots.names[index], path);
+  _state = open_state(path, oflag);
+  if (_state != nullptr) _state->dirIndex = index;
+  return isOpen();
+}
+
+bool File::open(const char* path, uint8_t oflag) {
+  close();
+  char normalized[HAL_PATH_LENGTH];
+  normalize(path, normalized);
+  _state = open_state(normalized, oflag);
+  return isOpen();
+}
+
+bool File::remove() {
+  if (!isFile()) return false;
+  char path[HAL_PATH_LENGTH];
+  strcpy(path, _state->path);
+  close();
+  charge_sector();
+  free_slot(path);
+  char host[512];
+  host_path(path, host, sizeof(host));
+  return unlink(host) == 0;
+}
+
+///////////////
+//// SDFAT ////
+///////////////
+
+bool SdFat::begin(uint8_t csPin, SPISettings spiSettings) {
+  (void)csPin;
+  // The ATmega2560 SPI clock can not go faster than F_CPU / 2.
+  hal::set_spi_clock(spiSettings.clock > F_CPU / 2 ? F_CPU / 2 : spiSettings.clock);
+  // Card initialization and reading the volume boot record + FAT.
+  hal::advance(HAL_COST_SD_COMMAND * 10);
+  charge_sector();
+  charge_sector();
+  struct stat info;
+  return host_stat("", &info) && S_ISDIR(info.st_mode);
+}
+
+File SdFat::open(const char* path, uint8_t mode) {
+  char normalized[HAL_PATH_LENGTH];
+  normalize(path, normalized);
+  return File(open_state(normalized, mode));
+}
+
+bool SdFat::exists(const char* path) {
+  hal::advance(HAL_COST_SD_COMMAND);
+  char normalized[HAL_PATH_LENGTH];
+  normalize(path, normalized);
+  struct stat info;
+  return host_stat(normalized, &info);
+}
+
+bool SdFat::remove(const char* path) {
+  File file = open(path, O_WRONLY);
+  return file.remove();
+}
+
+bool SdFat::rename(const char* oldPath, const char* newPath) {
+  char from[HAL_PATH_LENGTH];
+  char to[HAL_PATH_LENGTH];
+  normalize(oldPath, from);
+  normalize(newPath, to);
+  struct stat info;
+  // SdFat does not replace an existing file.
+  if (!host_stat(from, &info) || host_stat(to, &info)) return false;
+  charge_sector();
+  // FAT writes the new entry before the old one is freed.
+  add_slot(to);
+  free_slot(from);
+  char hostFrom[512];
+  char hostTo[512];
+  host_path(from, hostFrom, sizeof(hostFrom));
+  host_path(to, hostTo, sizeof(hostTo));
+  return ::rename(hostFrom, hostTo) == 0;
+}
+
+bool SdFat::mkdir(const char* path) {
+  char dir[HAL_PATH_LENGTH];
+  normalize(path, dir);
+  charge_sector();
+  char host[512];
+  host_path(dir, host, sizeof(host));
+  if (::mkdir(host, 0755) != 0) return false;
+  add_slot(dir);
+  return true;
+}
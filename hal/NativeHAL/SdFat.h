@@ -0,0 +1,121 @@
+/**
+ * @file SdFat.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for the SdFat (Adafruit Fork 1.x) library backed by a directory on the host.
+ *
+ * The directory set with hal::set_sd_root acts as the root of the card. Like FAT, every directory keeps a table of entry slots
+ * so openNextFile() and dirIndex() behave the same as they do on a real card: new files take the first free slot and deleting a
+ * file frees its slot without moving any other entries. Entries which exist when a directory is first read are ordered by name.
+ *
+ * Every call charges the virtual clock. Transferring a sector costs HAL_COST_SD_COMMAND plus the time it takes to move 512 bytes
+ * at the SPI clock given to SdFat::begin (capped at F_CPU / 2 like on the ATmega2560).
+ * Reads above the clock set with hal::set_sd_max_clock come back corrupted so the firmware's SPI clock probe can be tested.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_sd_fat_h
+#define hal_sd_fat_h
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#define SD_SCK_HZ(maxSpeed) SPISettings(maxSpeed, MSBFIRST, SPI_MODE0)
+#define SD_SCK_MHZ(maxMhz) SPISettings(1000000UL * (maxMhz), MSBFIRST, SPI_MODE0)
+#define SPI_FULL_SPEED SD_SCK_MHZ(50)
+#define SPI_HALF_SPEED SD_SCK_HZ(F_CPU / 4)
+#define SPI_QUARTER_SPEED SD_SCK_HZ(F_CPU / 8)
+
+#ifndef SS
+#define SS 53
+#endif
+
+// Open flags (SdFat values, not the host fcntl.h values).
+#ifndef O_RDONLY
+#define O_RDONLY 0x00
+#define O_WRONLY 0x01
+#define O_RDWR 0x02
+#define O_ACCMODE 0x03
+#define O_APPEND 0x08
+#define O_CREAT 0x10
+#define O_TRUNC 0x20
+#define O_EXCL 0x40
+#endif
+#define O_READ O_RDONLY
+#define O_WRITE O_WRONLY
+#define O_AT_END 0x04
+
+#define FILE_READ O_RDONLY
+#define FILE_WRITE (O_RDWR | O_CREAT | O_AT_END)
+
+/** @brief Size of a sector on the card. */
+constexpr uint16_t HAL_SD_SECTOR_SIZE = 512;
+
+struct HalFileState;
+
+class File: public Stream {
+  private:
+  /** @brief Shared (reference counted) state of the open file. nullptr when the file is closed. */
+  HalFileState* _state;
+  void release();
+  public:
+  File();
+  explicit File(HalFileState* state);
+  File(const File& other);
+  File& operator=(const File& other);
+  ~File();
+  operator bool() const;
+  bool isOpen() const;
+  bool isDirectory() const;
+  bool isFile() const;
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  int read(void* buffer, size_t size);
+  size_t write(uint8_t value) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  void flush() override;
+  bool sync();
+  bool close();
+
+  uint32_t fileSize() const;
+  uint32_t curPosition() const;
+  uint32_t position() const;
+  bool seekSet(uint32_t pos);
+  bool seek(uint32_t pos);
+  /** @brief Cut the file off at a length. The position is moved to the new end if it was past it. */
+  bool truncate(uint32_t length);
+
+  bool getName(char* name, size_t size);
+  /** @brief Get the last modification date and time of the file in FAT format. */
+  bool getModifyDateTime(uint16_t* pdate, uint16_t* ptime);
+  /** @return The index of this file's entry in its parent directory. */
+  uint16_t dirIndex() const;
+
+  File openNextFile(uint8_t mode = O_RDONLY);
+  void rewindDirectory();
+  /**
+   * @brief Open the entry at a directory slot (index) of an open directory.
+   * @return If there was a file at the slot and it could be opened.
+   */
+  bool open(File* dirFile, uint16_t index, uint8_t oflag);
+  bool open(const char* path, uint8_t oflag = O_RDONLY);
+  bool remove();
+};
+
+class SdFat {
+  public:
+  bool begin(uint8_t csPin = SS, SPISettings spiSettings = SPI_FULL_SPEED);
+  File open(const char* path, uint8_t mode = O_RDONLY);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* oldPath, const char* newPath);
+  bool mkdir(const char* path);
+};
+
+#endif
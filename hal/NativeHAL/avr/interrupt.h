@@ -0,0 +1,34 @@
+/**
+ * @file interrupt.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for <avr/interrupt.h>.
+ * Interrupt vectors are plain functions which the HAL calls from the virtual clock.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_avr_interrupt_h
+#define hal_avr_interrupt_h
+
+#include <avr/io.h>
+
+/** @brief Defines an interrupt vector. The HAL calls the vector when the emulated peripheral would. */
+#define ISR(vector, ...) extern "C" void vector(void)
+
+/** @brief Vector names. Only vectors emulated by the HAL are listed. */
+extern "C" void TIMER0_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER0_COMPB_vect(void) __attribute__((weak));
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER2_OVF_vect(void) __attribute__((weak));
+// Timers 3 to 5 only toggle the extra speaker pins. The HAL tracks their frequency but does not call them.
+extern "C" void TIMER3_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER4_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER5_COMPA_vect(void) __attribute__((weak));
+extern "C" void ADC_vect(void) __attribute__((weak));
+
+#define cli() (SREG &= 0x7F)
+#define sei() (SREG |= 0x80)
+
+#endif
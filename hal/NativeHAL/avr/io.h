@@ -0,0 +1,186 @@
+/**
+ * @file io.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for <avr/io.h>. Every ATmega2560 register used by TuneStudio2560 and NewTone is a plain variable
+ * which the HAL reads and writes to emulate the hardware.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_avr_io_h
+#define hal_avr_io_h
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_BYTE(sfr) (sfr)
+
+/** @brief Declares the PORTx, DDRx and PINx registers for a port. */
+#define HAL_DECLARE_PORT(x) extern volatile uint8_t PORT##x, DDR##x, PIN##x;
+HAL_DECLARE_PORT(A) HAL_DECLARE_PORT(B) HAL_DECLARE_PORT(C) HAL_DECLARE_PORT(D) HAL_DECLARE_PORT(E) HAL_DECLARE_PORT(F)
+HAL_DECLARE_PORT(G) HAL_DECLARE_PORT(H) HAL_DECLARE_PORT(J) HAL_DECLARE_PORT(K) HAL_DECLARE_PORT(L)
+#undef HAL_DECLARE_PORT
+
+#define PORTA0 0
+#define PORTA1 1
+#define PORTA2 2
+#define PORTA3 3
+#define PORTA4 4
+#define PORTA5 5
+#define PORTA6 6
+#define PORTA7 7
+#define PORTB0 0
+#define PORTB1 1
+#define PORTB2 2
+#define PORTB3 3
+#define PORTB4 4
+#define PORTB5 5
+#define PORTB6 6
+#define PORTB7 7
+#define PORTC0 0
+#define PORTC1 1
+#define PORTC2 2
+#define PORTC3 3
+#define PORTC4 4
+#define PORTC5 5
+#define PORTC6 6
+#define PORTC7 7
+#define PORTD0 0
+#define PORTD1 1
+#define PORTD2 2
+#define PORTD3 3
+#define PORTD4 4
+#define PORTD5 5
+#define PORTD6 6
+#define PORTD7 7
+#define PORTE0 0
+#define PORTE1 1
+#define PORTE2 2
+#define PORTE3 3
+#define PORTE4 4
+#define PORTE5 5
+#define PORTE6 6
+#define PORTE7 7
+#define PORTF0 0
+#define PORTF1 1
+#define PORTF2 2
+#define PORTF3 3
+#define PORTF4 4
+#define PORTF5 5
+#define PORTF6 6
+#define PORTF7 7
+#define PORTG0 0
+#define PORTG1 1
+#define PORTG2 2
+#define PORTG3 3
+#define PORTG4 4
+#define PORTG5 5
+#define PORTG6 6
+#define PORTG7 7
+#define PORTH0 0
+#define PORTH1 1
+#define PORTH2 2
+#define PORTH3 3
+#define PORTH4 4
+#define PORTH5 5
+#define PORTH6 6
+#define PORTH7 7
+#define PORTJ0 0
+#define PORTJ1 1
+#define PORTJ2 2
+#define PORTJ3 3
+#define PORTJ4 4
+#define PORTJ5 5
+#define PORTJ6 6
+#define PORTJ7 7
+#define PORTK0 0
+#define PORTK1 1
+#define PORTK2 2
+#define PORTK3 3
+#define PORTK4 4
+#define PORTK5 5
+#define PORTK6 6
+#define PORTK7 7
+#define PORTL0 0
+#define PORTL1 1
+#define PORTL2 2
+#define PORTL3 3
+#define PORTL4 4
+#define PORTL5 5
+#define PORTL6 6
+#define PORTL7 7
+
+// Timer0 (used by millis() in the Arduino core, the compare B interrupt is free)
+extern volatile uint8_t TIMSK0, OCR0A, OCR0B;
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+
+// Timer2 (PWM of analogWrite in the Arduino core, the overflow interrupt is free)
+extern volatile uint8_t TIMSK2;
+#define TOIE2 0
+
+// Timer1 (used by NewTone)
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t TCNT1, ICR1, OCR1A, OCR1B;
+#define WGM10 0
+#define WGM11 1
+#define COM1C0 2
+#define COM1C1 3
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+
+// Timers 3, 4 and 5 (the extra voices, CTC mode with the compare A interrupt)
+extern volatile uint8_t TCCR3A, TCCR3B, TIMSK3, TCCR4A, TCCR4B, TIMSK4, TCCR5A, TCCR5B, TIMSK5;
+extern volatile uint16_t TCNT3, OCR3A, TCNT4, OCR4A, TCNT5, OCR5A;
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define WGM32 3
+#define WGM33 4
+#define OCIE3A 1
+#define CS40 0
+#define CS41 1
+#define CS42 2
+#define WGM42 3
+#define WGM43 4
+#define OCIE4A 1
+#define CS50 0
+#define CS51 1
+#define CS52 2
+#define WGM52 3
+#define WGM53 4
+#define OCIE5A 1
+
+// Analog to digital converter
+extern volatile uint8_t ADCSRA, ADCSRB, ADMUX, DIDR0;
+extern volatile uint16_t ADC;
+#define MUX5 3
+#define REFS0 6
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+
+// Status register and stack pointer
+extern volatile uint8_t SREG;
+extern volatile uint16_t SP;
+#define RAMEND 0x21FF
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file pgmspace.h
+ * @author Jacob LuVisi
+ * @brief Native HAL stand-in for <avr/pgmspace.h>.
+ * The host has one address space so every PROGMEM helper reads the memory directly.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_avr_pgmspace_h
+#define hal_avr_pgmspace_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(str) (str)
+
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_word_near(addr) pgm_read_word(addr)
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(const void * const *)(addr))
+
+#define memcpy_P(dest, src, num) memcpy((dest), (src), (num))
+#define strcpy_P(dst, src) strcpy((dst), (src))
+#define strncpy_P(dst, src, n) strncpy((dst), (src), (n))
+#define strcat_P(dst, src) strcat((dst), (src))
+#define strcmp_P(a, b) strcmp((a), (b))
+#define strncmp_P(a, b, n) strncmp((a), (b), (n))
+#define strcasecmp_P(a, b) strcasecmp((a), (b))
+#define strncasecmp_P(a, b, n) strncasecmp((a), (b), (n))
+#define strstr_P(a, b) strstr((a), (b))
+#define strlen_P(a) strlen((a))
+#define sprintf_P(s, f, ...) sprintf((s), (f), __VA_ARGS__)
+
+#endif
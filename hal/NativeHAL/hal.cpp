@@ -0,0 +1,672 @@
+/**
+ * @file hal.cpp
+ * @author Jacob LuVisi
+ * @brief Implements the virtual clock, the emulated AVR registers, Timer0, Timer1, Timer2, the voice timers, scripted input, the WAV
+ * renderer and the Arduino core functions for the native HAL.
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <Arduino.h>
+#include <hal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Emulated registers.
+#define HAL_DEFINE_PORT(x) volatile uint8_t PORT##x = 0, DDR##x = 0, PIN##x = 0xFF;
+HAL_DEFINE_PORT(A) HAL_DEFINE_PORT(B) HAL_DEFINE_PORT(C) HAL_DEFINE_PORT(D) HAL_DEFINE_PORT(E) HAL_DEFINE_PORT(F)
+HAL_DEFINE_PORT(G) HAL_DEFINE_PORT(H) HAL_DEFINE_PORT(J) HAL_DEFINE_PORT(K) HAL_DEFINE_PORT(L)
+#undef HAL_DEFINE_PORT
+
+// The Arduino core only enables the Timer0 overflow interrupt (millis).
+volatile uint8_t TIMSK0 = _BV(TOIE0), OCR0A = 0, OCR0B = 0;
+volatile uint8_t TIMSK2 = 0;
+volatile uint8_t TCCR1A = 0, TCCR1B = 0, TIMSK1 = 0;
+volatile uint16_t TCNT1 = 0, ICR1 = 0, OCR1A = 0, OCR1B = 0;
+volatile uint8_t TCCR3A = 0, TCCR3B = 0, TIMSK3 = 0, TCCR4A = 0, TCCR4B = 0, TIMSK4 = 0, TCCR5A = 0, TCCR5B = 0, TIMSK5 = 0;
+volatile uint16_t TCNT3 = 0, OCR3A = 0, TCNT4 = 0, OCR4A = 0, TCNT5 = 0, OCR5A = 0;
+// The Arduino core enables the ADC with a prescaler of 128.
+volatile uint8_t ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0), ADCSRB = 0, ADMUX = 0, DIDR0 = 0;
+volatile uint16_t ADC = 0;
+// The Arduino core enables interrupts before setup() is called.
+volatile uint8_t SREG = 0x80;
+volatile uint16_t SP = RAMEND;
+// The end of the heap used by freeMemory() in debug.h. Set by the simulator so only the depth of the host stack is measured.
+char* __brkval = nullptr;
+
+HardwareSerial Serial;
+
+namespace {
+  /** @brief Port index (0 = PORTA) and bit for each of the 70 pins of the Arduino Mega 2560. */
+  const uint8_t PIN_MAP[70][2] = {
+    {4, 0}, {4, 1}, {4, 4}, {4, 5}, {6, 5}, {4, 3}, {7, 3}, {7, 4}, {7, 5}, {7, 6}, {1, 4}, {1, 5}, {1, 6}, {1, 7}, {8, 1},
+    {8, 0}, {7, 1}, {7, 0}, {3, 3}, {3, 2}, {3, 1}, {3, 0}, {0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}, {0, 6}, {0, 7},
+    {2, 7}, {2, 6}, {2, 5}, {2, 4}, {2, 3}, {2, 2}, {2, 1}, {2, 0}, {3, 7}, {6, 2}, {6, 1}, {6, 0}, {10, 7}, {10, 6}, {10, 5},
+    {10, 4}, {10, 3}, {10, 2}, {10, 1}, {10, 0}, {1, 3}, {1, 2}, {1, 1}, {1, 0}, {5, 0}, {5, 1}, {5, 2}, {5, 3}, {5, 4}, {5, 5},
+    {5, 6}, {5, 7}, {9, 0}, {9, 1}, {9, 2}, {9, 3}, {9, 4}, {9, 5}, {9, 6}, {9, 7}
+  };
+  constexpr uint8_t PIN_COUNT = sizeof(PIN_MAP) / sizeof(PIN_MAP[0]);
+
+  /** @brief The PORTx, DDRx and PINx registers of each port. */
+  volatile uint8_t* const PORT_REGISTERS[11][3] = {
+    {&PORTA, &DDRA, &PINA}, {&PORTB, &DDRB, &PINB}, {&PORTC, &DDRC, &PINC}, {&PORTD, &DDRD, &PIND},
+    {&PORTE, &DDRE, &PINE}, {&PORTF, &DDRF, &PINF}, {&PORTG, &DDRG, &PING}, {&PORTH, &DDRH, &PINH},
+    {&PORTJ, &DDRJ, &PINJ}, {&PORTK, &DDRK, &PINK}, {&PORTL, &DDRL, &PINL}
+  };
+
+  /** @brief External interrupt number -> pin for the Arduino Mega 2560. */
+  const uint8_t INTERRUPT_PINS[6] = {2, 3, 21, 20, 19, 18};
+
+  struct Event {
+    uint64_t timeUs;
+    void (*action)(uint8_t pin, uint16_t value);
+    uint8_t pin;
+    uint16_t value;
+  };
+
+  /** @brief A voice which started, stopped or changed its frequency. Recorded for the WAV renderer. */
+  struct ToneChange {
+    uint64_t timeUs;
+    uint8_t voice;
+    uint32_t frequency;
+  };
+
+  struct ExternalInterrupt {
+    void (*handler)(void);
+    int mode;
+    bool pending;
+  };
+
+  uint64_t clockUs = 0;
+  uint64_t endUs = UINT64_MAX;
+  bool isrActive = false;
+  Event* events = nullptr;
+  size_t eventCount = 0;
+  size_t nextEvent = 0;
+  ExternalInterrupt externalInterrupts[6] = {};
+  uint16_t analogValues[16] = {};
+  void (*finishHandler)() = nullptr;
+  const char* sdRoot = ".";
+  uint32_t spiClock = 4000000;
+  uint32_t sdMaxClock = 0;
+  bool traceTones = false;
+  hal::Stats counters = {};
+
+  // Serial state. Received bytes are kept in a ring like the 64 byte receive buffer of the Arduino core.
+  constexpr uint8_t SERIAL_RX_SIZE = 64;
+  uint8_t serialRx[SERIAL_RX_SIZE];
+  uint8_t serialRxHead = 0;
+  uint8_t serialRxTail = 0;
+  FILE* serialOut = stdout;
+
+  /** @brief The overflow period of Timer0 (64 * 256 / F_CPU). */
+  constexpr uint64_t TIMER0_PERIOD_NS = 64ULL * 256 * 1000000000ULL / F_CPU;
+
+  // Timer0 compare B state.
+  bool timer0Armed = false;
+  uint64_t timer0NextNs = 0;
+
+  /** @brief The overflow period of Timer2 in phase correct mode (64 * 510 / F_CPU). */
+  constexpr uint64_t TIMER2_PERIOD_NS = 64ULL * 510 * 1000000000ULL / F_CPU;
+
+  // Timer2 overflow state.
+  bool timer2Armed = false;
+  uint64_t timer2NextNs = 0;
+
+  // Free running ADC state.
+  bool adcArmed = false;
+  uint64_t adcNextNs = 0;
+
+  // Timer1 state.
+  bool timerArmed = false;
+  uint64_t timerNextNs = 0;
+
+  /** @brief The amount of voices (Timer1 and Timers 3 to 5). */
+  constexpr uint8_t VOICE_COUNT = 4;
+  /** @brief The registers of Timers 3 to 5 (voices 1 to 3). */
+  volatile uint8_t* const VOICE_TCCRB[VOICE_COUNT - 1] = {&TCCR3B, &TCCR4B, &TCCR5B};
+  volatile uint8_t* const VOICE_TIMSK[VOICE_COUNT - 1] = {&TIMSK3, &TIMSK4, &TIMSK5};
+  volatile uint16_t* const VOICE_OCRA[VOICE_COUNT - 1] = {&OCR3A, &OCR4A, &OCR5A};
+  /** @brief The frequency each voice was playing at the last time the voices were synced. */
+  uint32_t voiceFrequency[VOICE_COUNT] = {};
+
+  // WAV renderer state. Tone changes are only recorded when a WAV file is written.
+  constexpr uint32_t WAV_SAMPLE_RATE = 22050;
+  /** @brief The amplitude of one voice. Four voices at once still fit in 16 bits. */
+  constexpr int16_t WAV_VOICE_AMPLITUDE = 8000;
+  const char* wavPath = nullptr;
+  ToneChange* toneChanges = nullptr;
+  size_t toneChangeCount = 0;
+
+  // Deterministic state for random().
+  uint32_t randomState = 1;
+
+  /** @brief The prescaler selected by the clock select bits (CSn2:0) of a 16-bit timer or 0 if the timer is stopped. */
+  uint16_t timer_prescaler(uint8_t tccrB) {
+    switch (tccrB & 0x07) {
+    case 1: return 1;
+    case 2: return 8;
+    case 3: return 64;
+    case 4: return 256;
+    case 5: return 1024;
+    default: return 0;
+    }
+  }
+
+  uint16_t timer1_prescaler() {
+    return timer_prescaler(TCCR1B);
+  }
+
+  /** @brief The time between two compare matches in phase and frequency correct mode (counts up to ICR1 and back down). */
+  uint64_t timer1_period_ns() {
+    return (uint64_t)2 * ((uint64_t)ICR1 + 1) * timer1_prescaler() * 1000000000ULL / F_CPU;
+  }
+
+  /** @brief Arm or disarm the emulated Timer1 depending on what NewTone has written to its registers. */
+  void sync_timer1() {
+    const bool enabled = (TIMSK1 & _BV(OCIE1A)) && timer1_prescaler() != 0;
+    if (enabled && !timerArmed) {
+      timerArmed = true;
+      timerNextNs = clockUs * 1000 + timer1_period_ns();
+    } else if (!enabled && timerArmed) {
+      timerArmed = false;
+    }
+  }
+
+  /**
+   * @brief Report every voice which started, stopped or changed its frequency since the last sync.
+   * Timers 3 to 5 only toggle a pin so their interrupts are not run. Only their frequency is followed.
+   */
+  void sync_voices() {
+    for (uint8_t voice = 0; voice < VOICE_COUNT; voice++) {
+      const uint32_t frequency = voice == 0 && !timerArmed ? 0 : hal::voice_frequency(voice);
+      if (frequency == voiceFrequency[voice]) continue;
+      if (frequency != 0) counters.tones++;
+      if (traceTones) {
+        printf("[tone] %llu.%03llums %uhz", (unsigned long long)(clockUs / 1000), (unsigned long long)(clockUs % 1000), frequency);
+        // Voice 0 keeps the format from before there were voices.
+        if (voice != 0) printf(" v%u", voice);
+        printf("\n");
+      }
+      if (wavPath != nullptr) {
+        if (toneChangeCount % 256 == 0) {
+          toneChanges = (ToneChange*)realloc(toneChanges, (toneChangeCount + 256) * sizeof(ToneChange));
+        }
+        toneChanges[toneChangeCount++] = ToneChange {clockUs, voice, frequency};
+      }
+      voiceFrequency[voice] = frequency;
+    }
+  }
+
+  void put_u16(FILE* file, uint16_t value) {
+    fputc(value & 0xFF, file);
+    fputc(value >> 8, file);
+  }
+
+  void put_u32(FILE* file, uint32_t value) {
+    put_u16(file, value & 0xFFFF);
+    put_u16(file, value >> 16);
+  }
+
+  /** @brief Render the recorded tone changes into a mono 16-bit PCM WAV file. Every voice is a square wave. */
+  void write_wav() {
+    FILE* file = fopen(wavPath, "wb");
+    if (file == nullptr) {
+      fprintf(stderr, "Could not open \"%s\" for the WAV output.\n", wavPath);
+      return;
+    }
+    const uint64_t samples = clockUs * WAV_SAMPLE_RATE / 1000000;
+    const uint32_t dataBytes = samples * 2 > UINT32_MAX - 36 ? (UINT32_MAX - 36) & ~1U : (uint32_t)(samples * 2);
+    fwrite("RIFF", 1, 4, file);
+    put_u32(file, 36 + dataBytes);
+    fwrite("WAVEfmt ", 1, 8, file);
+    put_u32(file, 16);
+    put_u16(file, 1);
+    put_u16(file, 1);
+    put_u32(file, WAV_SAMPLE_RATE);
+    put_u32(file, WAV_SAMPLE_RATE * 2);
+    put_u16(file, 2);
+    put_u16(file, 16);
+    fwrite("data", 1, 4, file);
+    put_u32(file, dataBytes);
+
+    uint32_t frequencies[VOICE_COUNT] = {};
+    double phases[VOICE_COUNT] = {};
+    size_t change = 0;
+    for (uint64_t sample = 0; sample < dataBytes / 2; sample++) {
+      const uint64_t timeUs = sample * 1000000 / WAV_SAMPLE_RATE;
+      while (change < toneChangeCount && toneChanges[change].timeUs <= timeUs) {
+        const ToneChange& toneChange = toneChanges[change++];
+        frequencies[toneChange.voice] = toneChange.frequency;
+        // A new note starts at the beginning of its period like the timer does.
+        phases[toneChange.voice] = 0;
+      }
+      int32_t mix = 0;
+      for (uint8_t voice = 0; voice < VOICE_COUNT; voice++) {
+        if (frequencies[voice] == 0) continue;
+        mix += phases[voice] < 0.5 ? WAV_VOICE_AMPLITUDE : -WAV_VOICE_AMPLITUDE;
+        phases[voice] += (double)frequencies[voice] / WAV_SAMPLE_RATE;
+        if (phases[voice] >= 1) phases[voice] -= 1;
+      }
+      put_u16(file, (uint16_t)(int16_t)mix);
+    }
+    fclose(file);
+  }
+
+  /** @brief Arm or disarm the Timer0 compare interrupts. Compare matches stay in step with the free running counter. */
+  void sync_timer0() {
+    const bool enabled = TIMSK0 & (_BV(OCIE0A) | _BV(OCIE0B));
+    if (enabled && !timer0Armed) {
+      timer0Armed = true;
+      timer0NextNs = (clockUs * 1000 / TIMER0_PERIOD_NS + 1) * TIMER0_PERIOD_NS;
+    } else if (!enabled && timer0Armed) {
+      timer0Armed = false;
+    }
+  }
+
+  /** @brief Arm or disarm the Timer2 overflow interrupt. Overflows stay in step with the free running counter. */
+  void sync_timer2() {
+    const bool enabled = TIMSK2 & _BV(TOIE2);
+    if (enabled && !timer2Armed) {
+      timer2Armed = true;
+      timer2NextNs = (clockUs * 1000 / TIMER2_PERIOD_NS + 1) * TIMER2_PERIOD_NS;
+    } else if (!enabled && timer2Armed) {
+      timer2Armed = false;
+    }
+  }
+
+  /** @brief The time (in nanoseconds) one conversion takes. 13 ADC clock cycles where the ADC clock is F_CPU / prescaler. */
+  uint64_t adc_conversion_ns() {
+    const uint8_t prescalerBits = ADCSRA & 0x07;
+    const uint64_t prescaler = prescalerBits == 0 ? 2 : (1ULL << prescalerBits);
+    return 13ULL * prescaler * 1000000000ULL / F_CPU;
+  }
+
+  /** @brief Start or stop free running conversions (ADEN, ADATE, ADIE and ADSC set with ADCSRB selecting free running). */
+  void sync_adc() {
+    const uint8_t freeRunning = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADSC);
+    const bool enabled = (ADCSRA & freeRunning) == freeRunning && (ADCSRB & 0x07) == 0;
+    if (enabled && !adcArmed) {
+      adcArmed = true;
+      adcNextNs = clockUs * 1000 + adc_conversion_ns();
+    } else if (!enabled && adcArmed) {
+      adcArmed = false;
+    }
+  }
+
+  void run_isr(void (*isr)(void)) {
+    isrActive = true;
+    const uint8_t sreg = SREG;
+    SREG &= 0x7F;
+    isr();
+    SREG = sreg;
+    isrActive = false;
+  }
+
+  void service_external_interrupts() {
+    if (!(SREG & 0x80)) return;
+    for (ExternalInterrupt& interrupt : externalInterrupts) {
+      if (interrupt.pending && interrupt.handler != nullptr) {
+        interrupt.pending = false;
+        run_isr(interrupt.handler);
+      }
+    }
+  }
+}
+
+namespace hal {
+  uint64_t now_us() {
+    return clockUs;
+  }
+
+  void advance(uint64_t us) {
+    // Time spent inside of an interrupt is not modelled.
+    if (isrActive) return;
+    const uint64_t target = clockUs + us;
+    while (true) {
+      sync_timer0();
+      sync_timer1();
+      sync_voices();
+      sync_timer2();
+      sync_adc();
+      service_external_interrupts();
+      const bool interruptsEnabled = SREG & 0x80;
+      const bool timer0Due = timer0Armed && interruptsEnabled && timer0NextNs <= target * 1000;
+      const bool timer1Due = timerArmed && interruptsEnabled && timerNextNs <= target * 1000;
+      const bool timer2Due = timer2Armed && interruptsEnabled && timer2NextNs <= target * 1000;
+      const bool adcDue = adcArmed && interruptsEnabled && adcNextNs <= target * 1000;
+      const bool eventDue = nextEvent < eventCount && events[nextEvent].timeUs <= target;
+      if (!timer0Due && !timer1Due && !timer2Due && !adcDue && !eventDue) break;
+      // Run whatever is due first.
+      uint64_t dueNs = UINT64_MAX;
+      if (timer0Due) dueNs = timer0NextNs;
+      if (timer1Due && timerNextNs < dueNs) dueNs = timerNextNs;
+      if (timer2Due && timer2NextNs < dueNs) dueNs = timer2NextNs;
+      if (adcDue && adcNextNs < dueNs) dueNs = adcNextNs;
+      if (eventDue && events[nextEvent].timeUs * 1000 <= dueNs) {
+        const Event& event = events[nextEvent++];
+        if (event.timeUs > clockUs) clockUs = event.timeUs;
+        event.action(event.pin, event.value);
+        continue;
+      }
+      if (dueNs / 1000 > clockUs) clockUs = dueNs / 1000;
+      if (timer0Due && timer0NextNs == dueNs) {
+        timer0NextNs += TIMER0_PERIOD_NS;
+        // Both compare matches are handled at the same time. Only their order within the period matters to the firmware.
+        if ((TIMSK0 & _BV(OCIE0A)) && TIMER0_COMPA_vect) {
+          counters.timer0Interrupts++;
+          run_isr(TIMER0_COMPA_vect);
+        }
+        if ((TIMSK0 & _BV(OCIE0B)) && TIMER0_COMPB_vect) {
+          counters.timer0Interrupts++;
+          run_isr(TIMER0_COMPB_vect);
+        }
+        continue;
+      }
+      if (timer2Due && timer2NextNs == dueNs) {
+        timer2NextNs += TIMER2_PERIOD_NS;
+        counters.timer2Interrupts++;
+        if (TIMER2_OVF_vect) run_isr(TIMER2_OVF_vect);
+        continue;
+      }
+      if (adcDue && adcNextNs == dueNs) {
+        adcNextNs += adc_conversion_ns();
+        counters.analogReads++;
+        ADC = hal::get_analog(PIN_A0 + (ADMUX & 0x07) + (ADCSRB & _BV(MUX5) ? 8 : 0));
+        if (ADC_vect) run_isr(ADC_vect);
+        continue;
+      }
+      timerNextNs += timer1_period_ns();
+      counters.timer1Interrupts++;
+      if (TIMER1_COMPA_vect) run_isr(TIMER1_COMPA_vect);
+    }
+    clockUs = target;
+    if (clockUs >= endUs) {
+      finish(0);
+    }
+  }
+
+  bool in_isr() {
+    return isrActive;
+  }
+
+  uint8_t pin_port(uint8_t pin) {
+    return pin < PIN_COUNT ? PIN_MAP[pin][0] + 1 : 0;
+  }
+
+  uint8_t pin_mask(uint8_t pin) {
+    return pin < PIN_COUNT ? _BV(PIN_MAP[pin][1]) : 0;
+  }
+
+  volatile uint8_t* port_register(uint8_t port, uint8_t type) {
+    return port >= 1 && port <= 11 && type < 3 ? PORT_REGISTERS[port - 1][type] : nullptr;
+  }
+
+  void set_pin(uint8_t pin, bool level) {
+    volatile uint8_t* reg = port_register(pin_port(pin), 2);
+    if (reg == nullptr) return;
+    const bool previous = *reg & pin_mask(pin);
+    if (level) *reg |= pin_mask(pin); else *reg &= ~pin_mask(pin);
+    if (previous == level) return;
+    for (uint8_t i = 0; i < sizeof(INTERRUPT_PINS); i++) {
+      ExternalInterrupt& interrupt = externalInterrupts[i];
+      if (INTERRUPT_PINS[i] != pin || interrupt.handler == nullptr) continue;
+      if (interrupt.mode == CHANGE || (interrupt.mode == FALLING && !level) || (interrupt.mode == RISING && level)) {
+        interrupt.pending = true;
+      }
+    }
+    service_external_interrupts();
+  }
+
+  bool get_pin(uint8_t pin) {
+    volatile uint8_t* reg = port_register(pin_port(pin), 2);
+    return reg != nullptr && (*reg & pin_mask(pin));
+  }
+
+  void set_analog(uint8_t pin, uint16_t value) {
+    if (pin >= PIN_A0 && pin < PIN_A0 + 16) analogValues[pin - PIN_A0] = value > 1023 ? 1023 : value;
+  }
+
+  uint16_t get_analog(uint8_t pin) {
+    return pin >= PIN_A0 && pin < PIN_A0 + 16 ? analogValues[pin - PIN_A0] : 0;
+  }
+
+  void queue_event(uint64_t timeMs, void (*action)(uint8_t pin, uint16_t value), uint8_t pin, uint16_t value) {
+    // Grow the queue in blocks of 64 events.
+    if (eventCount % 64 == 0) {
+      events = (Event*)realloc(events, (eventCount + 64) * sizeof(Event));
+    }
+    events[eventCount++] = Event {timeMs * 1000, action, pin, value};
+  }
+
+  void set_end_time(uint64_t timeMs) {
+    endUs = timeMs * 1000;
+  }
+
+  void set_finish_handler(void (*handler)()) {
+    finishHandler = handler;
+  }
+
+  void finish(int code) {
+    // Prevent the finish handler from ending the simulation a second time.
+    endUs = UINT64_MAX;
+    if (finishHandler != nullptr) finishHandler();
+    if (wavPath != nullptr) write_wav();
+    fflush(stdout);
+    exit(code);
+  }
+
+  void set_sd_root(const char* path) {
+    sdRoot = path;
+  }
+
+  const char* get_sd_root() {
+    return sdRoot;
+  }
+
+  void sd_transfer(uint32_t bytes) {
+    advance((uint64_t)bytes * 8 * 1000000 / spiClock);
+  }
+
+  void set_spi_clock(uint32_t hz) {
+    spiClock = hz == 0 ? 1 : hz;
+  }
+
+  uint32_t get_spi_clock() {
+    return spiClock;
+  }
+
+  void set_sd_max_clock(uint32_t hz) {
+    sdMaxClock = hz;
+  }
+
+  bool is_sd_clock_too_fast() {
+    return sdMaxClock != 0 && spiClock > sdMaxClock;
+  }
+
+  uint32_t timer1_frequency() {
+    const uint16_t prescaler = timer1_prescaler();
+    if (prescaler == 0 || !(TIMSK1 & _BV(OCIE1A))) return 0;
+    return F_CPU / (4UL * prescaler * ((uint32_t)ICR1 + 1));
+  }
+
+  uint32_t voice_frequency(uint8_t voice) {
+    if (voice == 0) return timer1_frequency();
+    if (voice >= VOICE_COUNT) return 0;
+    const uint16_t prescaler = timer_prescaler(*VOICE_TCCRB[voice - 1]);
+    // CTC mode (WGMn2) with the compare A interrupt toggling the pin. Timers 3 to 5 share the bit positions of Timer3.
+    if (prescaler == 0 || !(*VOICE_TCCRB[voice - 1] & _BV(WGM32)) || !(*VOICE_TIMSK[voice - 1] & _BV(OCIE3A))) return 0;
+    return F_CPU / (2UL * prescaler * ((uint32_t)*VOICE_OCRA[voice - 1] + 1));
+  }
+
+  void set_wav_output(const char* path) {
+    wavPath = path;
+  }
+
+  void set_trace_tones(bool enabled) {
+    traceTones = enabled;
+  }
+
+  void serial_receive(uint8_t value) {
+    const uint8_t next = (serialRxHead + 1) % SERIAL_RX_SIZE;
+    if (next == serialRxTail) return;
+    serialRx[serialRxHead] = value;
+    serialRxHead = next;
+  }
+
+  void set_serial_output(const char* path) {
+    serialOut = fopen(path, "wb");
+    if (serialOut == nullptr) {
+      fprintf(stderr, "Could not open \"%s\" for the serial output.\n", path);
+      exit(2);
+    }
+  }
+
+  Stats& stats() {
+    return counters;
+  }
+}
+
+//////////////////////////////
+//// ARDUINO CORE METHODS ////
+//////////////////////////////
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  volatile uint8_t* ddr = portModeRegister(digitalPinToPort(pin));
+  volatile uint8_t* port = portOutputRegister(digitalPinToPort(pin));
+  if (ddr == nullptr) return;
+  if (mode == OUTPUT) {
+    *ddr |= digitalPinToBitMask(pin);
+  } else {
+    *ddr &= ~digitalPinToBitMask(pin);
+    if (mode == INPUT_PULLUP) *port |= digitalPinToBitMask(pin);
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  volatile uint8_t* port = portOutputRegister(digitalPinToPort(pin));
+  if (port == nullptr) return;
+  hal::advance(HAL_COST_DIGITAL_IO);
+  if (value) *port |= digitalPinToBitMask(pin); else *port &= ~digitalPinToBitMask(pin);
+  // Outputs read back the value that was written to them.
+  if (*portModeRegister(digitalPinToPort(pin)) & digitalPinToBitMask(pin)) {
+    volatile uint8_t* input = portInputRegister(digitalPinToPort(pin));
+    if (value) *input |= digitalPinToBitMask(pin); else *input &= ~digitalPinToBitMask(pin);
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  hal::advance(HAL_COST_DIGITAL_IO);
+  return hal::get_pin(pin) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  // A conversion takes 13 ADC clock cycles. The ADC clock is F_CPU divided by the prescaler in ADCSRA.
+  const uint8_t prescalerBits = ADCSRA & 0x07;
+  const uint32_t prescaler = prescalerBits == 0 ? 2 : (1UL << prescalerBits);
+  hal::stats().analogReads++;
+  hal::advance(13UL * prescaler / clockCyclesPerMicrosecond());
+  return hal::get_analog(pin);
+}
+
+void analogWrite(uint8_t pin, int value) {
+  digitalWrite(pin, value > 0 ? HIGH : LOW);
+}
+
+unsigned long millis() {
+  hal::advance(HAL_COST_CLOCK_READ);
+  return (unsigned long)(hal::now_us() / 1000);
+}
+
+unsigned long micros() {
+  hal::advance(HAL_COST_CLOCK_READ);
+  return (unsigned long)hal::now_us();
+}
+
+void delay(unsigned long ms) {
+  hal::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hal::advance(us);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {
+  if (interruptNum < sizeof(INTERRUPT_PINS)) externalInterrupts[interruptNum] = ExternalInterrupt {userFunc, mode, false};
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+  if (interruptNum < sizeof(INTERRUPT_PINS)) externalInterrupts[interruptNum] = ExternalInterrupt {nullptr, 0, false};
+}
+
+void interrupts() {
+  sei();
+}
+
+void noInterrupts() {
+  cli();
+}
+
+long random(long max) {
+  if (max <= 0) return 0;
+  // xorshift32
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState % max;
+}
+
+long random(long min, long max) {
+  return min >= max ? min : random(max - min) + min;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) randomState = seed;
+}
+
+char* utoa(unsigned int value, char* str, int base) {
+  char buffer[8 * sizeof(int) + 1];
+  char* p = &buffer[sizeof(buffer) - 1];
+  *p = '\0';
+  do {
+    const unsigned int digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  return strcpy(str, p);
+}
+
+char* itoa(int value, char* str, int base) {
+  if (value < 0 && base == 10) {
+    *str = '-';
+    utoa(-(unsigned int)value, str + 1, base);
+    return str;
+  }
+  return utoa((unsigned int)value, str, base);
+}
+
+int HardwareSerial::available() {
+  return (SERIAL_RX_SIZE + serialRxHead - serialRxTail) % SERIAL_RX_SIZE;
+}
+
+int HardwareSerial::read() {
+  if (serialRxHead == serialRxTail) return -1;
+  const uint8_t value = serialRx[serialRxTail];
+  serialRxTail = (serialRxTail + 1) % SERIAL_RX_SIZE;
+  return value;
+}
+
+int HardwareSerial::peek() {
+  return serialRxHead == serialRxTail ? -1 : serialRx[serialRxTail];
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+  putc(value, serialOut);
+  return 1;
+}
+
+void HardwareSerial::flush() {
+  fflush(serialOut);
+}
@@ -0,0 +1,263 @@
+/**
+ * @file hal.h
+ * @author Jacob LuVisi
+ * @brief The control interface for the native (Linux) hardware abstraction layer used by the [env:native] build.
+ *
+ * The native HAL allows the full TuneStudio2560 firmware (main.cpp, every ProgramState, Song and NewTone) to be compiled
+ * and run on a host machine. Nothing in here is compiled for the Arduino Mega 2560.
+ *
+ * <b>Virtual Clock</b><br />
+ * Time in the simulator is virtual. The clock only moves forward when the firmware does something which would take time on the
+ * real hardware (reading millis(), an analog read, writing a character to the LCD, reading a sector from the SD card, etc).
+ * The cost of each of these actions is described by the HAL_COST_* constants below. Because nothing actually waits, blocking
+ * delays such as delay_ms(4000) finish in a few milliseconds of host time which allows the program to run thousands of times faster
+ * than real time.
+ *
+ * <b>Timer1</b><br />
+ * The Timer1 registers which NewTone writes to are plain variables. Whenever the clock moves forward the HAL checks if the
+ * TIMER1_COMPA_vect interrupt is enabled and calls it at the same rate the real timer would.
+ *
+ * <b>Timers 3 to 5</b><br />
+ * The extra voices of songs with more than one track (see voices.h) run Timers 3, 4 and 5 in CTC mode. Their interrupts only toggle
+ * a speaker pin so the HAL does not call them. It follows the frequency of every voice from the registers instead, traces it and
+ * can render all of the voices mixed together into a WAV file when the simulation finishes.
+ *
+ * <b>Timer0</b><br />
+ * Timer0 is owned by millis() and always overflows every 1024us (prescaler 64). When the compare A or B interrupts are enabled
+ * in TIMSK0 the HAL calls TIMER0_COMPA_vect and TIMER0_COMPB_vect once every overflow period.
+ *
+ * <b>Timer2</b><br />
+ * Timer2 is set up by the Arduino core for analogWrite (prescaler 64, phase correct) and overflows every 2040us. When the overflow
+ * interrupt is enabled in TIMSK2 the HAL calls TIMER2_OVF_vect once every overflow period.
+ *
+ * <b>ADC</b><br />
+ * analogRead() charges the virtual clock for one conversion. When the ADC is started in free running mode with its interrupt
+ * enabled the HAL calls ADC_vect after every conversion time with ADC set to the value of the selected channel.
+ *
+ * <b>Scripted Input</b><br />
+ * Button presses, potentiometer values and serial input are read from a script file where each line is "[time in ms] [command] [arguments]".
+ * View sim_main.cpp for the script format.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef hal_h
+#define hal_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief The cost (in microseconds) of reading the clock using millis() or micros(). Models the loop overhead of busy waiting. */
+constexpr uint32_t HAL_COST_CLOCK_READ = 4;
+/** @brief The cost (in microseconds) of a digitalRead() call. */
+constexpr uint32_t HAL_COST_DIGITAL_IO = 4;
+/** @brief The cost (in microseconds) of one byte sent to the PCF8574 LCD backpack (two nibbles, three I2C frames each at 100kHz). */
+constexpr uint32_t HAL_COST_LCD_BYTE = 1200;
+/** @brief The extra cost (in microseconds) of the LCD clear and home commands. */
+constexpr uint32_t HAL_COST_LCD_CLEAR = 2000;
+/** @brief The fixed cost (in microseconds) of an SD card command (open, seek to a new sector, directory lookup). */
+constexpr uint32_t HAL_COST_SD_COMMAND = 120;
+/** @brief The cost (in microseconds) of a single byte level call into SdFat (read(), peek(), print of one char). */
+constexpr uint32_t HAL_COST_SD_CALL = 3;
+
+namespace hal {
+
+  /**
+   * @brief Counters which are collected while the simulation runs.
+   * Printed by the simulator on exit and useful for comparing the cost of two builds.
+   */
+  struct Stats {
+    /** @brief Number of times the firmware loop() method was called. */
+    uint64_t loops;
+    /** @brief Number of bytes (commands + data) sent to the LCD. */
+    uint64_t lcdBytes;
+    /** @brief Number of analog conversions (analogRead() calls and free running conversions). */
+    uint64_t analogReads;
+    /** @brief Number of 512 byte sectors transferred to or from the SD card. */
+    uint64_t sdSectors;
+    /** @brief Number of files opened on the SD card. */
+    uint64_t sdOpens;
+    /** @brief Number of times the Timer0 compare A and B interrupts were called. */
+    uint64_t timer0Interrupts;
+    /** @brief Number of times the Timer2 overflow interrupt was called. */
+    uint64_t timer2Interrupts;
+    /** @brief Number of times the Timer1 compare interrupt was called. */
+    uint64_t timer1Interrupts;
+    /** @brief Number of notes started on any voice (NewTone on Timer1 and Timers 3 to 5). */
+    uint64_t tones;
+  };
+
+  /**
+   * @return The current virtual time in microseconds.
+   */
+  uint64_t now_us();
+
+  /**
+   * @brief Move the virtual clock forward.
+   * Scripted input events and timer interrupts which are due before the new time are processed in order.
+   * Ends the simulation if the end time has been reached.
+   *
+   * @param us The amount of microseconds to move forward.
+   */
+  void advance(uint64_t us);
+
+  /**
+   * @return If the HAL is currently inside of a simulated interrupt.
+   */
+  bool in_isr();
+
+  /**
+   * @brief Drive a digital input pin to a level. Updates the PINx register and calls any interrupt attached to the pin.
+   *
+   * @param pin The Arduino pin number.
+   * @param level HIGH or LOW.
+   */
+  void set_pin(uint8_t pin, bool level);
+
+  /**
+   * @param pin The Arduino pin number.
+   * @return The level of the pin from its PINx register.
+   */
+  bool get_pin(uint8_t pin);
+
+  /**
+   * @brief Set the value which analogRead() returns for a pin.
+   *
+   * @param pin The Arduino pin number (PIN_A0 to PIN_A15).
+   * @param value A value between 0 and 1023.
+   */
+  void set_analog(uint8_t pin, uint16_t value);
+
+  /**
+   * @param pin The Arduino pin number.
+   * @return The value set for the pin with set_analog.
+   */
+  uint16_t get_analog(uint8_t pin);
+
+  /**
+   * @param pin The Arduino pin number.
+   * @return The port (1 = PORTA to 11 = PORTL) which the pin belongs to or 0 if the pin does not exist.
+   */
+  uint8_t pin_port(uint8_t pin);
+
+  /**
+   * @param pin The Arduino pin number.
+   * @return The bit mask of the pin on its port.
+   */
+  uint8_t pin_mask(uint8_t pin);
+
+  /**
+   * @brief Get a pointer to a PORTx/DDRx/PINx register.
+   *
+   * @param port The port as returned by pin_port.
+   * @param type 0 for PORTx, 1 for DDRx and 2 for PINx.
+   * @return The register or nullptr if the port does not exist.
+   */
+  volatile uint8_t* port_register(uint8_t port, uint8_t type);
+
+  /**
+   * @brief Queue a scripted event. Events must be queued in time order.
+   *
+   * @param timeMs The virtual time in milliseconds that the event should happen at.
+   * @param action The function to call.
+   * @param pin The pin argument of the event.
+   * @param value The value argument of the event.
+   */
+  void queue_event(uint64_t timeMs, void (*action)(uint8_t pin, uint16_t value), uint8_t pin, uint16_t value);
+
+  /**
+   * @brief Set the virtual time (in milliseconds) where the simulation finishes.
+   */
+  void set_end_time(uint64_t timeMs);
+
+  /**
+   * @brief Set a function to be called once the simulation has finished (used to print results).
+   */
+  void set_finish_handler(void (*handler)());
+
+  /**
+   * @brief End the simulation. Calls the finish handler and exits the process.
+   *
+   * @param code The exit code of the process.
+   */
+  [[noreturn]] void finish(int code);
+
+  /**
+   * @brief Set the host directory which acts as the root directory of the SD card.
+   */
+  void set_sd_root(const char* path);
+
+  /**
+   * @return The host directory which acts as the root directory of the SD card.
+   */
+  const char* get_sd_root();
+
+  /**
+   * @brief Charge the virtual clock for an SPI transfer to or from the SD card.
+   *
+   * @param bytes The amount of bytes transferred.
+   */
+  void sd_transfer(uint32_t bytes);
+
+  /**
+   * @brief Set the SPI clock (in hz) used when charging the clock for SD card transfers.
+   */
+  void set_spi_clock(uint32_t hz);
+
+  /**
+   * @return The SPI clock (in hz) used for SD card transfers.
+   */
+  uint32_t get_spi_clock();
+
+  /**
+   * @brief Set the fastest SPI clock (in hz) the simulated card reads correctly at. Above it every byte read from a file comes back
+   * with its lowest bit flipped, like a card on long wires without CRC checks. 0 (the default) has no limit.
+   */
+  void set_sd_max_clock(uint32_t hz);
+
+  /**
+   * @return If the SPI clock is above the clock set with set_sd_max_clock.
+   */
+  bool is_sd_clock_too_fast();
+
+  /**
+   * @return The frequency (in hz) that Timer1 is currently toggling the speaker at or 0 if no tone is playing.
+   */
+  uint32_t timer1_frequency();
+
+  /**
+   * @param voice The voice (0 is Timer1, 1 to 3 are Timers 3 to 5).
+   * @return The frequency (in hz) that the voice is currently playing or 0 if it is not playing.
+   */
+  uint32_t voice_frequency(uint8_t voice);
+
+  /**
+   * @brief Render everything the voices play into a mono 16-bit PCM WAV file (22050hz) when the simulation finishes.
+   */
+  void set_wav_output(const char* path);
+
+  /**
+   * @brief Set if tone events should be written to the standard output as they happen.
+   */
+  void set_trace_tones(bool enabled);
+
+  /**
+   * @brief Add a byte to the receive buffer of Serial as if it was sent from the serial monitor.
+   */
+  void serial_receive(uint8_t value);
+
+  /**
+   * @brief Write everything the firmware sends over Serial to a host file instead of the standard output.
+   */
+  void set_serial_output(const char* path);
+
+  /**
+   * @return The counters collected by the simulation.
+   */
+  Stats& stats();
+}
+
+#endif
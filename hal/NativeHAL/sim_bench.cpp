@@ -0,0 +1,502 @@
+/**
+ * @file sim_bench.cpp
+ * @author Jacob LuVisi
+ * @brief Microbenchmarks of the hot paths of the firmware. Run with "program --sd DIR --bench PASSES [--bench-baseline FILE]".
+ *
+ * Every benchmark times a loop over one firmware function (note lookups, compiling and streaming songs, editing prgmSong and
+ * drawing the creator mode song view and flushing it to the simulated LCD) and reports:
+ * - ns_per_op: Host time of one call. The fastest of the passes is reported because it is the least disturbed by the host.
+ * - virtual_ns_per_op: Virtual time of one call (LCD bytes, SD sectors and timer interrupts are charged to it like in the simulation).
+ *   It does not depend on the host so it only changes when the firmware does. Work which only uses the CPU is not charged, so it
+ *   is 0 for the note lookups and the prgmSong edits.
+ * - allocs_per_op: Heap allocations (malloc, calloc, realloc and operator new) of one call. The firmware does not use the heap so
+ *   anything but 0 is counted in the HAL (ex. opening a file).
+ *
+ * The results are printed as JSON which can be saved as the baseline of a later run. With a baseline every benchmark is compared
+ * to it and the run fails (exit code 1) if:
+ * - its virtual time grew by more than the "threshold_percent" of the baseline,
+ * - it allocates more,
+ * - or its host time grew by more than the "host_threshold_percent" of the baseline. The same fixed loop is timed on both computers
+ *   ("host_calibration_ns") and the host times of the baseline are scaled by how much faster or slower this computer runs it. The
+ *   threshold is wide because the fastest pass still moves with the computer and its load. It catches the slowdowns of the
+ *   benchmarks whose virtual time is 0.
+ * Virtual time and allocations are the same on every computer and host times are scaled so one baseline is kept in the repository.
+ *
+ * The songs on the SD card are used for the "_sd" benchmarks (ex. a copy of test/songs). The synthetic song is written next to
+ * them and removed at the end.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <sim_bench.h>
+#include <studio-libs/states/states.h>
+#include <studio-libs/song_stream.h>
+#include <hal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+
+namespace {
+  /** @brief Heap allocations since the simulator started. */
+  uint64_t allocations = 0;
+
+  /** @brief Written and compiled by the synthetic benchmarks. */
+  const char SYNTHETIC_SONG[] = "BENCH.TXT";
+  /** @brief The amount of notes of the synthetic song. Longer than any song prgmSong holds so every block is streamed. */
+  constexpr uint16_t SYNTHETIC_NOTES = 2000;
+  /** @brief The threshold which is printed and used when the baseline does not have one. Virtual times of the same build never vary
+   * so this only lets small intended changes through. */
+  constexpr double DEFAULT_THRESHOLD_PERCENT = 10;
+  /** @brief The host time threshold which is printed and used when the baseline does not have one. A benchmark fails once it takes
+   * 3 times as long as the baseline (on this computer). */
+  constexpr double DEFAULT_HOST_THRESHOLD_PERCENT = 200;
+  /** @brief The amount of rounds of the calibration loop. */
+  constexpr uint32_t CALIBRATION_ROUNDS = 1000000;
+
+  /** @brief Keeps the results of the timed calls so the compiler can not remove them. */
+  volatile uint32_t sink = 0;
+
+  /** @brief The time and allocations of the timed parts of one pass of a benchmark. */
+  struct Measure {
+    uint64_t ops = 0;
+    double hostNs = 0;
+    uint64_t virtualUs = 0;
+    uint64_t allocations = 0;
+    struct timespec hostStart;
+    uint64_t virtualStart = 0;
+    uint64_t allocationStart = 0;
+
+    void start() {
+      allocationStart = ::allocations;
+      virtualStart = hal::now_us();
+      clock_gettime(CLOCK_MONOTONIC, &hostStart);
+    }
+
+    /** @param amount The amount of calls which were made since start(). */
+    void stop(uint64_t amount) {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      hostNs += (now.tv_sec - hostStart.tv_sec) * 1e9 + (now.tv_nsec - hostStart.tv_nsec);
+      virtualUs += hal::now_us() - virtualStart;
+      allocations += ::allocations - allocationStart;
+      ops += amount;
+    }
+  };
+
+  struct Result {
+    const char* name;
+    double nsPerOp;
+    double virtualNsPerOp;
+    double allocsPerOp;
+  };
+
+  /**
+   * @brief Time a fixed loop of integer math, loads and branches which never changes. Compares the speed of this computer to the
+   * computer the baseline was recorded on. @return The fastest host time of the loop in ns.
+   */
+  double calibrate_host(uint32_t passes) {
+    double fastest = 0;
+    for (uint32_t pass = 0; pass < passes; pass++) {
+      uint8_t table[256];
+      for (uint16_t i = 0; i < 256; i++) {
+        table[i] = (uint8_t)(i * 151 + 7);
+      }
+      uint32_t value = 2463534242u;
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (uint32_t round = 0; round < CALIBRATION_ROUNDS; round++) {
+        // xorshift32 picks the entry so the branch can not be predicted.
+        value ^= value << 13;
+        value ^= value >> 17;
+        value ^= value << 5;
+        if (table[value & 0xFF] & 1) {
+          sink = sink + table[value >> 24];
+        }
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      const double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+      if (pass == 0 || ns < fastest) fastest = ns;
+    }
+    return fastest;
+  }
+
+  /** @brief The pitch of every note and of a pause. */
+  char pitches[PROGRAM_NOTE_AMOUNT + 1][PITCH_BUFFER_SIZE];
+
+  void bench_note_from_pitch(Measure& m) {
+    for (uint8_t note = 0; note < PROGRAM_NOTE_AMOUNT; note++) {
+      get_note_pitch(note, pitches[note]);
+    }
+    get_note_pitch(PAUSE_NOTE_INDEX, pitches[PROGRAM_NOTE_AMOUNT]);
+    m.start();
+    for (uint16_t round = 0; round < 1000; round++) {
+      for (uint8_t i = 0; i <= PROGRAM_NOTE_AMOUNT; i++) {
+        sink = sink + get_note_from_pitch(pitches[i]);
+      }
+    }
+    m.stop(1000 * (PROGRAM_NOTE_AMOUNT + 1));
+  }
+
+  void bench_note_pitch(Measure& m) {
+    char buffer[PITCH_BUFFER_SIZE];
+    m.start();
+    for (uint16_t round = 0; round < 1000; round++) {
+      for (uint8_t note = 0; note < PROGRAM_NOTE_AMOUNT; note++) {
+        sink = sink + get_note_pitch(note, buffer)[1];
+      }
+    }
+    m.stop(1000 * PROGRAM_NOTE_AMOUNT);
+  }
+
+  void bench_note_frequency(Measure& m) {
+    m.start();
+    for (uint16_t round = 0; round < 1000; round++) {
+      for (uint8_t note = 0; note < PROGRAM_NOTE_AMOUNT; note++) {
+        sink = sink + get_note_frequency(note);
+      }
+    }
+    m.stop(1000 * PROGRAM_NOTE_AMOUNT);
+  }
+
+  /** @brief Remove the cache of a song so it is compiled from its text the next time it is opened. */
+  void remove_cache(const char* name) {
+    SdFat card;
+    char cachePath[24];
+    snprintf(cachePath, sizeof(cachePath), "%s/%.*s%s", SONG_CACHE_DIR, (int)strcspn(name, "."), name, FILE_CACHE_EXTENSION);
+    card.remove(cachePath);
+  }
+
+  /** @brief Write the synthetic song. It walks up and down every note and has a pause every eighth note. */
+  void write_synthetic_song() {
+    SdFat card;
+    File song = card.open(SYNTHETIC_SONG, O_RDWR | O_CREAT | O_TRUNC);
+    song.print("TONE_DELAY=100\nTONE_LENGTH=150\n\nData:\n");
+    for (uint16_t i = 0; i < SYNTHETIC_NOTES; i++) {
+      song.print("  - ");
+      if (i % 8 == 7) {
+        song.print("PS");
+      } else {
+        const uint16_t step = i % (2 * PROGRAM_NOTE_AMOUNT);
+        song.print(pitches[step < PROGRAM_NOTE_AMOUNT ? step : 2 * PROGRAM_NOTE_AMOUNT - 1 - step]);
+      }
+      song.print("\n");
+    }
+    song.close();
+  }
+
+  /** @brief Compile a song from its text. Only sd_song_open is timed. */
+  void compile_song(Measure& m, const char* name) {
+    remove_cache(name);
+    File cache;
+    songCacheHeader_t header;
+    m.start();
+    const bool compiled = sd_song_open(name, cache, header);
+    m.stop(1);
+    cache.close();
+    if (!compiled) fprintf(stderr, "[bench] %s failed to compile\n", name);
+  }
+
+  void bench_compile_synthetic(Measure& m) {
+    for (uint8_t i = 0; i < 20; i++) {
+      compile_song(m, SYNTHETIC_SONG);
+    }
+  }
+
+  void bench_compile_sd(Measure& m) {
+    char name[14];
+    for (uint8_t song = 0; sd_get_file(song)[0] != '\0'; song++) {
+      strcpy(name, sd_get_file(song));
+      compile_song(m, name);
+    }
+  }
+
+  /** @brief Open a (compiled) song and read every step of it. Timed per step. */
+  void stream_song(Measure& m, const char* name) {
+    SongStream stream;
+    uint8_t step[SONG_MAX_TRACKS];
+    m.start();
+    if (stream.open(name)) {
+      for (song_size_t i = 0; i < stream.get_size(); i++) {
+        stream.get_step(i, step);
+        sink = sink + step[0];
+      }
+    }
+    m.stop(stream.get_size());
+  }
+
+  void bench_stream_synthetic(Measure& m) {
+    stream_song(m, SYNTHETIC_SONG);
+  }
+
+  void bench_stream_sd(Measure& m) {
+    char name[14];
+    for (uint8_t song = 0; sd_get_file(song)[0] != '\0'; song++) {
+      strcpy(name, sd_get_file(song));
+      stream_song(m, name);
+    }
+  }
+
+  void fill_song() {
+    for (song_size_t i = 0; i < MAX_SONG_LENGTH; i++) {
+      prgmSong.add_note(i % PROGRAM_NOTE_AMOUNT);
+    }
+  }
+
+  void bench_song_add_note(Measure& m) {
+    for (uint8_t round = 0; round < 50; round++) {
+      prgmSong.clear();
+      m.start();
+      fill_song();
+      m.stop(MAX_SONG_LENGTH);
+    }
+    prgmSong.clear();
+  }
+
+  void bench_song_remove_note(Measure& m) {
+    for (uint8_t round = 0; round < 50; round++) {
+      fill_song();
+      m.start();
+      for (song_size_t i = 0; i < MAX_SONG_LENGTH; i++) {
+        prgmSong.remove_note();
+      }
+      m.stop(MAX_SONG_LENGTH);
+    }
+    prgmSong.clear();
+  }
+
+  void bench_song_clear(Measure& m) {
+    for (uint8_t round = 0; round < 50; round++) {
+      fill_song();
+      m.start();
+      prgmSong.clear();
+      m.stop(1);
+    }
+  }
+
+  /** @brief Find the number which follows "key": in the JSON object which starts at object. */
+  bool read_number(const char* object, const char* key, double& value) {
+    char pattern[40];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char* end = strchr(object, '}');
+    const char* found = strstr(object, pattern);
+    if (found == nullptr || (end != nullptr && found > end)) return false;
+    value = strtod(found + strlen(pattern), nullptr);
+    return true;
+  }
+
+  /** @brief Read a whole file into memory. */
+  char* read_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return nullptr;
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)malloc(size + 1);
+    text[fread(text, 1, size, file)] = '\0';
+    fclose(file);
+    return text;
+  }
+
+  /** @return If the value grew by more than thresholdPercent of the baseline. */
+  bool is_regression(double value, double baseline, double thresholdPercent) {
+    return value > baseline * (1 + thresholdPercent / 100) + 1e-9;
+  }
+
+  /**
+   * @brief Compare the results to a baseline and print every benchmark which regressed.
+   *
+   * @param calibrationNs The host time of the calibration loop on this computer.
+   * @return The exit code.
+   */
+  int compare_baseline(const Result* results, uint8_t amount, double calibrationNs, const char* baselinePath) {
+    char* baseline = read_file(baselinePath);
+    if (baseline == nullptr) {
+      fprintf(stderr, "[bench] could not read the baseline %s\n", baselinePath);
+      return 2;
+    }
+    double threshold = DEFAULT_THRESHOLD_PERCENT;
+    read_number(baseline, "threshold_percent", threshold);
+    double hostThreshold = DEFAULT_HOST_THRESHOLD_PERCENT;
+    read_number(baseline, "host_threshold_percent", hostThreshold);
+    // How much longer the same work takes on this computer than on the computer of the baseline.
+    double hostScale = 0;
+    double baselineCalibrationNs;
+    if (read_number(baseline, "host_calibration_ns", baselineCalibrationNs) && baselineCalibrationNs > 0) {
+      hostScale = calibrationNs / baselineCalibrationNs;
+    } else {
+      fprintf(stderr, "[bench] the baseline has no host_calibration_ns, host times are not checked\n");
+    }
+    int exitCode = 0;
+    for (uint8_t i = 0; i < amount; i++) {
+      const Result& result = results[i];
+      char pattern[64];
+      snprintf(pattern, sizeof(pattern), "\"name\": \"%s\"", result.name);
+      const char* object = strstr(baseline, pattern);
+      double ns, virtualNs, allocs;
+      if (object == nullptr || !read_number(object, "ns_per_op", ns) || !read_number(object, "virtual_ns_per_op", virtualNs) ||
+        !read_number(object, "allocs_per_op", allocs)) {
+        fprintf(stderr, "[bench] %s is not in the baseline\n", result.name);
+        continue;
+      }
+      if (hostScale != 0 && is_regression(result.nsPerOp, ns * hostScale, hostThreshold)) {
+        fprintf(stderr, "[bench] REGRESSION %s: %.1f host ns/op (baseline %.1f, %.1f on this computer)\n", result.name,
+          result.nsPerOp, ns, ns * hostScale);
+        exitCode = 1;
+      }
+      if (is_regression(result.virtualNsPerOp, virtualNs, threshold)) {
+        fprintf(stderr, "[bench] REGRESSION %s: %.1f virtual ns/op (baseline %.1f)\n", result.name, result.virtualNsPerOp, virtualNs);
+        exitCode = 1;
+      }
+      // The baseline is rounded to 4 decimals.
+      if (is_regression(result.allocsPerOp, allocs + 0.00005, 0)) {
+        fprintf(stderr, "[bench] REGRESSION %s: %.4f allocs/op (baseline %.4f)\n", result.name, result.allocsPerOp, allocs);
+        exitCode = 1;
+      }
+    }
+    free(baseline);
+    if (exitCode == 0) {
+      fprintf(stderr, "[bench] no regressions (threshold %.0f%%, host threshold %.0f%%)\n", threshold, hostThreshold);
+    }
+    return exitCode;
+  }
+}
+
+/** @brief Benchmarks which need the private methods of the states. A friend of the states it benchmarks. */
+struct SimBench {
+  /** @brief Draw the song view of creator mode at every scroll position of a full song and send it to the LCD. */
+  static void print_song_lcd(Measure& m) {
+    CreatorModeCreateNew state;
+    state.init();
+    prgmSong.clear();
+    for (song_size_t i = 0; i < MAX_SONG_LENGTH; i++) {
+      state.add_song_note(i % PROGRAM_NOTE_AMOUNT);
+    }
+    const uint8_t rows = state.get_lcd_required_rows() + 1;
+    m.start();
+    for (uint8_t row = 0; row < rows; row++) {
+      state.scrolledLines = row;
+      state.print_song_lcd();
+      // The loop flushes the drawing to the display after every iteration.
+      lcd.flush();
+    }
+    m.stop(rows);
+    prgmSong.clear();
+  }
+};
+
+#ifdef __GLIBC__
+// glibc also has its allocator under these names, so malloc can be replaced to count the calls and still use it.
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t amount, size_t size);
+  void* __libc_realloc(void* memory, size_t size);
+
+  void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t amount, size_t size) {
+    allocations++;
+    return __libc_calloc(amount, size);
+  }
+
+  void* realloc(void* memory, size_t size) {
+    allocations++;
+    return __libc_realloc(memory, size);
+  }
+}
+#endif
+
+void* operator new(size_t size) {
+  #ifndef __GLIBC__
+  // Counted by malloc with glibc.
+  allocations++;
+  #endif
+  void* memory = malloc(size == 0 ? 1 : size);
+  if (memory == nullptr) throw std::bad_alloc();
+  return memory;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+  free(memory);
+}
+
+int bench_hot_paths(uint32_t passes, const char* baselinePath) {
+  struct Benchmark {
+    const char* name;
+    void (*run)(Measure& m);
+  };
+  static const Benchmark BENCHMARKS[] = {
+    {"get_note_from_pitch", bench_note_from_pitch},
+    {"get_note_pitch", bench_note_pitch},
+    {"get_note_frequency", bench_note_frequency},
+    {"sd_song_compile_synthetic", bench_compile_synthetic},
+    {"sd_song_compile_sd", bench_compile_sd},
+    {"song_stream_synthetic", bench_stream_synthetic},
+    {"song_stream_sd", bench_stream_sd},
+    {"song_add_note", bench_song_add_note},
+    {"song_remove_note", bench_song_remove_note},
+    {"song_clear", bench_song_clear},
+    {"print_song_lcd", SimBench::print_song_lcd}
+  };
+  constexpr uint8_t BENCHMARK_AMOUNT = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+  const double calibrationNs = calibrate_host(passes);
+
+  // The pitches are needed to write the synthetic song.
+  Measure unused;
+  bench_note_from_pitch(unused);
+  write_synthetic_song();
+
+  Result results[BENCHMARK_AMOUNT];
+  for (uint8_t i = 0; i < BENCHMARK_AMOUNT; i++) {
+    Result& result = results[i];
+    result = {BENCHMARKS[i].name, 0, 0, 0};
+    for (uint32_t pass = 0; pass < passes; pass++) {
+      Measure m;
+      BENCHMARKS[i].run(m);
+      if (m.ops == 0) break;
+      const double nsPerOp = m.hostNs / m.ops;
+      if (pass == 0 || nsPerOp < result.nsPerOp) {
+        result.nsPerOp = nsPerOp;
+        result.virtualNsPerOp = m.virtualUs * 1000.0 / m.ops;
+        result.allocsPerOp = m.allocations / (double)m.ops;
+      }
+    }
+  }
+  SdFat card;
+  card.remove(SYNTHETIC_SONG);
+  remove_cache(SYNTHETIC_SONG);
+
+  printf("{\n  \"threshold_percent\": %.0f,\n  \"host_threshold_percent\": %.0f,\n  \"host_calibration_ns\": %.0f,\n",
+    DEFAULT_THRESHOLD_PERCENT, DEFAULT_HOST_THRESHOLD_PERCENT, calibrationNs);
+  printf("  \"benchmarks\": [\n");
+  for (uint8_t i = 0; i < BENCHMARK_AMOUNT; i++) {
+    printf("    {\"name\": \"%s\", \"ns_per_op\": %.1f, \"virtual_ns_per_op\": %.1f, \"allocs_per_op\": %.4f}%s\n", results[i].name,
+      results[i].nsPerOp, results[i].virtualNsPerOp, results[i].allocsPerOp, i + 1 < BENCHMARK_AMOUNT ? "," : "");
+  }
+  printf("  ]\n}\n");
+  return baselinePath == nullptr ? 0 : compare_baseline(results, BENCHMARK_AMOUNT, calibrationNs, baselinePath);
+}
@@ -0,0 +1,27 @@
+/**
+ * @file sim_bench.h
+ * @author Jacob LuVisi
+ * @brief Microbenchmarks of the hot paths of the firmware which run inside of the native simulator. @see sim_bench.cpp
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef sim_bench_h
+#define sim_bench_h
+
+#include <stdint.h>
+
+/**
+ * @brief Run every benchmark and print the results as JSON. Must be called after setup() with the end time of the simulation
+ * out of reach.
+ *
+ * @param passes The amount of times each benchmark is run. The fastest pass is reported.
+ * @param baselinePath A JSON file printed by an earlier run to compare against (nullptr to only print the results).
+ * @return The exit code of the simulator: 0, 1 if a benchmark regressed past the threshold of the baseline or 2 if the baseline
+ * could not be read.
+ */
+int bench_hot_paths(uint32_t passes, const char* baselinePath);
+
+#endif
@@ -0,0 +1,315 @@
+/**
+ * @file sim_main.cpp
+ * @author Jacob LuVisi
+ * @brief The entry point of the native simulator. Takes the place of the Arduino core main() by calling setup() once and then
+ * loop() until the end of the simulation.
+ *
+ * <b>Usage</b><br />
+ * program [--sd DIR] [--script FILE] [--until MS] [--trace-tones] [--quiet] [--serial FILE] [--wav FILE] [--sd-max-clock HZ] [--bench-compile PASSES] [--bench PASSES [--bench-baseline FILE]]
+ * - --sd: Host directory used as the root of the SD card (default "sd").
+ * - --script: Input script to run (default none).
+ * - --until: Virtual time in milliseconds where the simulation ends (default 60000 or the time of the "end" command).
+ * - --trace-tones: Print every note that the voices play. Notes of voices other than the first end with " vN".
+ * - --quiet: Do not print the summary when the simulation ends.
+ * - --serial: Write the serial output of the firmware to FILE instead of the standard output.
+ * - --wav: Write everything the voices played (mixed together) to FILE as a WAV when the simulation ends.
+ * - --sd-max-clock: The fastest SPI clock the SD card reads correctly at. Faster clocks start the card but corrupt what is read.
+ * - --bench-compile: Compile every song on the SD card from its text PASSES times (after setup()) and print how many bytes of
+ *   text were parsed per second of virtual and host time. Ex: "cp -r test/songs /tmp/sd && program --sd /tmp/sd --bench-compile 50"
+ * - --bench: Run the microbenchmarks of the hot paths of the firmware PASSES times (after setup()) and print the results as JSON.
+ * - --bench-baseline: Compare the results of --bench to FILE (saved from an earlier run) and exit with 1 if any regressed.
+ *   Ex: "program --sd /tmp/sd --bench 5 --bench-baseline test/bench_baseline.json". @see sim_bench.cpp
+ *
+ * <b>Script Format</b><br />
+ * One command per line, "[time in ms] [command] [arguments]". Lines starting with '#' are comments.
+ * - press BUTTON: Hold a button down. BUTTON is TONE1-TONE5, SELECT, CANCEL or OPTION.
+ * - release BUTTON: Let go of a button.
+ * - tap BUTTON [HOLD]: Press a button and release it HOLD ms later (default 50).
+ * - pot VALUE: Set the potentiometer to VALUE (0-1023).
+ * - serial TEXT: Send TEXT over the serial port (ex. "serial T" dumps the PERF_METRICS trace).
+ * - lcd: Print the contents of the LCD.
+ * - seg: Print the contents of the 7-segment display.
+ * - end: End the simulation.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <studio-libs/tune_studio.h>
+#include <studio-libs/seg_display.h>
+#include <hal.h>
+#include <sim_bench.h>
+#include <stdio.h>
+#include <time.h>
+
+/** @brief The cost (in microseconds) of the Arduino core calling loop() once. */
+constexpr uint32_t HAL_COST_LOOP_CALL = 1;
+
+namespace {
+  struct ScriptEvent {
+    uint64_t timeMs;
+    /** @brief Position of the event in the script. Keeps events at the same time in script order. */
+    uint32_t order;
+    void (*action)(uint8_t pin, uint16_t value);
+    uint8_t pin;
+    uint16_t value;
+  };
+
+  struct ButtonName {
+    const char* name;
+    uint8_t pin;
+  };
+
+  const ButtonName BUTTONS[] = {
+    {"TONE1", BTN_TONE_1}, {"TONE2", BTN_TONE_2}, {"TONE3", BTN_TONE_3}, {"TONE4", BTN_TONE_4}, {"TONE5", BTN_TONE_5},
+    {"SELECT", BTN_ADD_SELECT}, {"CANCEL", BTN_DEL_CANCEL}, {"OPTION", BTN_OPTION}
+  };
+
+  ScriptEvent* scriptEvents = nullptr;
+  uint32_t scriptEventCount = 0;
+  bool quiet = false;
+  struct timespec hostStart;
+
+  void print_lcd_contents() {
+    char row[LCD_COLS + 1];
+    printf("+--------------------+ %llums\n", (unsigned long long)(hal::now_us() / 1000));
+    for (uint8_t i = 0; i < LCD_ROWS; i++) {
+      lcd.get_display().hal_row_text(i, row);
+      printf("|%s|\n", row);
+    }
+    printf("+--------------------+\n");
+  }
+
+  void action_press(uint8_t pin, uint16_t value) { (void)value; hal::set_pin(pin, LOW); }
+  void action_release(uint8_t pin, uint16_t value) { (void)value; hal::set_pin(pin, HIGH); }
+  void action_pot(uint8_t pin, uint16_t value) { hal::set_analog(pin, value); }
+  void action_serial(uint8_t pin, uint16_t value) { (void)value; hal::serial_receive(pin); }
+  void action_lcd(uint8_t pin, uint16_t value) { (void)pin; (void)value; print_lcd_contents(); }
+  /** @brief Print the pitch of the note the segment display shows (or its raw segments if it is not a note). */
+  void action_seg(uint8_t pin, uint16_t value) {
+    (void)pin;
+    (void)value;
+    uint8_t glyphs[SEG_DIGIT_COUNT];
+    bool isBlank = true;
+    for (uint8_t digit = 0; digit < SEG_DIGIT_COUNT; digit++) {
+      glyphs[digit] = seg_get_glyph(digit);
+      isBlank = isBlank && glyphs[digit] == SEG_GLYPH_BLANK;
+    }
+    char text[16] = "";
+    for (uint16_t note = 0; note <= UINT8_MAX && !isBlank && text[0] == '\0'; note++) {
+      bool isMatch = true;
+      for (uint8_t digit = 0; digit < SEG_DIGIT_COUNT; digit++) {
+        isMatch = isMatch && seg_note_glyph(note, digit) == glyphs[digit];
+      }
+      if (isMatch) get_note_pitch(note, text);
+    }
+    if (!isBlank && text[0] == '\0') {
+      snprintf(text, sizeof(text), "%02X %02X %02X %02X", glyphs[0], glyphs[1], glyphs[2], glyphs[3]);
+    }
+    printf("[seg] %llums \"%s\"\n", (unsigned long long)(hal::now_us() / 1000), text);
+  }
+  void action_end(uint8_t pin, uint16_t value) { (void)pin; (void)value; hal::finish(0); }
+
+  int button_pin(const char* name) {
+    for (const ButtonName& button : BUTTONS) {
+      if (strcasecmp(button.name, name) == 0) return button.pin;
+    }
+    return -1;
+  }
+
+  void add_event(uint64_t timeMs, void (*action)(uint8_t pin, uint16_t value), uint8_t pin, uint16_t value) {
+    if (scriptEventCount % 64 == 0) {
+      scriptEvents = (ScriptEvent*)realloc(scriptEvents, (scriptEventCount + 64) * sizeof(ScriptEvent));
+    }
+    scriptEvents[scriptEventCount] = ScriptEvent {timeMs, scriptEventCount, action, pin, value};
+    scriptEventCount++;
+  }
+
+  int compare_events(const void* a, const void* b) {
+    const ScriptEvent* first = (const ScriptEvent*)a;
+    const ScriptEvent* second = (const ScriptEvent*)b;
+    if (first->timeMs != second->timeMs) return first->timeMs < second->timeMs ? -1 : 1;
+    return first->order < second->order ? -1 : 1;
+  }
+
+  /** @brief Read a script file into the event list. @return The time of the "end" command or 0. */
+  uint64_t load_script(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+      fprintf(stderr, "Could not open script \"%s\".\n", path);
+      exit(2);
+    }
+    uint64_t endTime = 0;
+    char line[128];
+    unsigned int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      lineNumber++;
+      unsigned long long time;
+      char command[16] = "";
+      char argument[16] = "";
+      unsigned int extra = 50;
+      if (line[0] == '#' || sscanf(line, "%llu %15s %15s %u", &time, command, argument, &extra) < 2) continue;
+      const int pin = button_pin(argument);
+      if (strcmp(command, "press") == 0 && pin >= 0) {
+        add_event(time, action_press, (uint8_t)pin, 0);
+      } else if (strcmp(command, "release") == 0 && pin >= 0) {
+        add_event(time, action_release, (uint8_t)pin, 0);
+      } else if (strcmp(command, "tap") == 0 && pin >= 0) {
+        add_event(time, action_press, (uint8_t)pin, 0);
+        add_event(time + extra, action_release, (uint8_t)pin, 0);
+      } else if (strcmp(command, "pot") == 0) {
+        add_event(time, action_pot, TONE_FREQ, (uint16_t)atoi(argument));
+      } else if (strcmp(command, "serial") == 0) {
+        for (const char* c = argument; *c != '\0'; c++) {
+          add_event(time, action_serial, (uint8_t)*c, 0);
+        }
+      } else if (strcmp(command, "lcd") == 0) {
+        add_event(time, action_lcd, 0, 0);
+      } else if (strcmp(command, "seg") == 0) {
+        add_event(time, action_seg, 0, 0);
+      } else if (strcmp(command, "end") == 0) {
+        endTime = time;
+        add_event(time, action_end, 0, 0);
+      } else {
+        fprintf(stderr, "%s:%u: unknown command \"%s %s\".\n", path, lineNumber, command, argument);
+        exit(2);
+      }
+    }
+    fclose(file);
+    qsort(scriptEvents, scriptEventCount, sizeof(ScriptEvent), compare_events);
+    return endTime;
+  }
+
+  double host_seconds(const struct timespec& start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+  }
+
+  /** @brief Compile every song on the SD card from its text a number of times. Only the compiles are timed. */
+  void bench_compile(uint32_t passes) {
+    SdFat card;
+    uint64_t bytes = 0;
+    uint64_t virtualUs = 0;
+    double hostSeconds = 0;
+    uint8_t songs = 0;
+    for (uint32_t pass = 0; pass < passes; pass++) {
+      for (songs = 0; sd_get_file(songs)[0] != '\0'; songs++) {
+        char name[14];
+        strcpy(name, sd_get_file(songs));
+        // Remove the cache so the song is compiled from its text.
+        char cachePath[24];
+        snprintf(cachePath, sizeof(cachePath), "%s/%.*s%s", SONG_CACHE_DIR, (int)strcspn(name, "."), name, FILE_CACHE_EXTENSION);
+        card.remove(cachePath);
+        bytes += card.open(name).fileSize();
+
+        File cache;
+        songCacheHeader_t header;
+        const uint64_t virtualStart = hal::now_us();
+        struct timespec hostStart;
+        clock_gettime(CLOCK_MONOTONIC, &hostStart);
+        const bool compiled = sd_song_open(name, cache, header);
+        hostSeconds += host_seconds(hostStart);
+        virtualUs += hal::now_us() - virtualStart;
+        cache.close();
+        if (!compiled) printf("[bench] %s failed to compile\n", name);
+      }
+    }
+    printf("[bench] compiled %u songs x %u passes (%llu bytes of text)\n", songs, passes, (unsigned long long)bytes);
+    printf("[bench] virtual: %.0f bytes/s (%.1fus per song)\n", virtualUs ? bytes * 1e6 / virtualUs : 0.0,
+      songs ? virtualUs / (double)(songs * passes) : 0.0);
+    printf("[bench] host:    %.0f bytes/s\n", hostSeconds > 0 ? bytes / hostSeconds : 0.0);
+  }
+
+  void print_summary() {
+    if (quiet) return;
+    const double hostSeconds = host_seconds(hostStart);
+    const double virtualSeconds = hal::now_us() / 1e6;
+    const hal::Stats& stats = hal::stats();
+
+    print_lcd_contents();
+    printf("[sim] virtual time:     %.3fs\n", virtualSeconds);
+    printf("[sim] host time:        %.3fs (%.0fx real time)\n", hostSeconds, hostSeconds > 0 ? virtualSeconds / hostSeconds : 0.0);
+    printf("[sim] loop() calls:     %llu (%.1fus avg)\n", (unsigned long long)stats.loops,
+      stats.loops ? hal::now_us() / (double)stats.loops : 0.0);
+    printf("[sim] lcd bytes:        %llu\n", (unsigned long long)stats.lcdBytes);
+    printf("[sim] analog reads:     %llu\n", (unsigned long long)stats.analogReads);
+    printf("[sim] sd opens/sectors: %llu/%llu\n", (unsigned long long)stats.sdOpens, (unsigned long long)stats.sdSectors);
+    printf("[sim] timer0 isr calls: %llu\n", (unsigned long long)stats.timer0Interrupts);
+    printf("[sim] timer2 isr calls: %llu\n", (unsigned long long)stats.timer2Interrupts);
+    printf("[sim] timer1 isr calls: %llu\n", (unsigned long long)stats.timer1Interrupts);
+    printf("[sim] tones played:     %llu\n", (unsigned long long)stats.tones);
+  }
+}
+
+extern char* __brkval;
+
+int main(int argc, char** argv) {
+  // freeMemory() measures from the stack to __brkval. Place it as far below the start of the stack as the usable SRAM of the Mega.
+  // The address is calculated as an integer because it is outside of any object.
+  char stackStart;
+  __brkval = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(&stackStart) - (RAMEND + 1 - 0x200));
+  const char* sdRoot = "sd";
+  const char* scriptPath = nullptr;
+  uint64_t until = 0;
+  uint32_t benchPasses = 0;
+  uint32_t hotPathPasses = 0;
+  const char* baselinePath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sd") == 0 && i + 1 < argc) {
+      sdRoot = argv[++i];
+    } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+      scriptPath = argv[++i];
+    } else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+      until = strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--trace-tones") == 0) {
+      hal::set_trace_tones(true);
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[i], "--serial") == 0 && i + 1 < argc) {
+      hal::set_serial_output(argv[++i]);
+    } else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+      hal::set_wav_output(argv[++i]);
+    } else if (strcmp(argv[i], "--sd-max-clock") == 0 && i + 1 < argc) {
+      hal::set_sd_max_clock(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--bench-compile") == 0 && i + 1 < argc) {
+      benchPasses = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+      hotPathPasses = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--bench-baseline") == 0 && i + 1 < argc) {
+      baselinePath = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--sd DIR] [--script FILE] [--until MS] [--trace-tones] [--quiet] [--serial FILE] [--wav FILE] [--sd-max-clock HZ] [--bench-compile PASSES] [--bench PASSES [--bench-baseline FILE]]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (scriptPath != nullptr) {
+    const uint64_t endTime = load_script(scriptPath);
+    if (until == 0) until = endTime;
+  }
+  for (uint32_t i = 0; i < scriptEventCount; i++) {
+    hal::queue_event(scriptEvents[i].timeMs, scriptEvents[i].action, scriptEvents[i].pin, scriptEvents[i].value);
+  }
+  hal::set_end_time(until == 0 ? 60000 : until);
+  hal::set_sd_root(sdRoot);
+  hal::set_finish_handler(print_summary);
+  clock_gettime(CLOCK_MONOTONIC, &hostStart);
+
+  if (benchPasses != 0 || hotPathPasses != 0) hal::set_end_time(UINT64_MAX / 1000);
+  setup();
+  if (benchPasses != 0) {
+    bench_compile(benchPasses);
+    return 0;
+  }
+  if (hotPathPasses != 0) {
+    return bench_hot_paths(hotPathPasses, baselinePath);
+  }
+  while (true) {
+    hal::stats().loops++;
+    loop();
+    hal::advance(HAL_COST_LOOP_CALL);
+  }
+}
@@ -0,0 +1,42 @@
+/**
+ * @file cycle_bench.h
+ * @author Jacob LuVisi
+ * @brief Benchmarks which are counted to the exact CPU cycle by the simavr emulator. Only compiled when CYCLE_BENCH is true.
+ *
+ * The program runs setup() like normal and then times the hot paths (reading a tone, compiling and streaming a song from the SD
+ * card, every interrupt which runs while a song plays, one loop() of the creator and player states and saving a full song) several
+ * times each instead of running loop(). The runner adds the interrupts up into the worst case load of playing 4 voices at once.
+ *
+ * Nothing is measured on the microcontroller itself. The benchmarks mark what they are doing by writing to the general purpose
+ * I/O registers, which take a single cycle and are not used by anything else:
+ * - GPIOR2: The name of the next benchmark, one character at a time and ending with '\0'.
+ * - GPIOR0: A CycleBenchMark. The emulator (test/simavr/cycle_runner.c) counts the cycles between each START and STOP.
+ *
+ * The benchmark named "empty" times nothing so its count is the cost of the marks themselves. The runner takes it off of the
+ * other counts.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef cycle_bench_h
+#define cycle_bench_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The values written to GPIOR0 to mark the benchmarks. */
+enum CycleBenchMark: uint8_t {
+  /** @brief A run of the current benchmark starts. */
+  CYCLE_BENCH_START = 1,
+  /** @brief The run of the current benchmark has ended. */
+  CYCLE_BENCH_STOP = 2,
+  /** @brief Every benchmark has run. The emulator stops. */
+  CYCLE_BENCH_DONE = 3
+};
+
+/** @brief The amount of times every benchmark is run. The runner reports the fewest, most and average cycles of the runs. */
+constexpr uint8_t CYCLE_BENCH_RUNS = 8;
+
+#endif
@@ -20,6 +20,7 @@ extern "C" char* sbrk(int incr);
 extern char* __brkval;
 #endif  // __arm__
 
+// Only the gap at the moment of the call. The deepest the stack has been is measured by stack_watch.h.
 inline unsigned int freeMemory() {
     char top;
 #ifdef __arm__
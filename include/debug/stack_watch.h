@@ -0,0 +1,93 @@
+/**
+ * @file stack_watch.h
+ * @author Jacob LuVisi
+ * @brief Measures the deepest the stack has grown in every program state and during the operations which use the most stack.
+ * Only compiled when PERF_METRICS is true.
+ *
+ * freeMemory() (debug.h) only sees the gap between the heap and the stack at the moment it is called, which is almost never the
+ * moment the stack is deepest (ex. an interrupt firing in the middle of compiling a song). Instead every free byte of SRAM is
+ * painted with STACK_CANARY before main() runs. The stack overwrites the canary wherever it reaches so the lowest byte which is
+ * no longer the canary is the deepest the stack has been, interrupts included.
+ *
+ * The lowest address is collected (and the used part painted again) whenever the state changes and when a StackOperation starts
+ * and ends, so every StateID and every StackOperation keeps its own high-water mark. Operations may be nested.
+ *
+ * Sending STACK_REPORT_COMMAND ('S') over the serial monitor prints the static SRAM (.data and .bss) and, for every state and
+ * operation which has run, the lowest stack address, the bytes of stack used and the bytes which were still free between the
+ * static SRAM and the stack. The report is text and is skipped by tools/trace_decode.cpp. Use tools/sram_report.cpp to see which
+ * globals the static SRAM is made of.
+ *
+ * Use STACK_WATCH_STATE(state), STACK_WATCH_BEGIN(op) and STACK_WATCH_END(op) so nothing is compiled when PERF_METRICS is false.
+ * Nothing is measured in the native simulator because its stack is the stack of the computer.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef stack_watch_h
+#define stack_watch_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The operations which are measured on their own. */
+enum StackOperation: uint8_t {
+  /** @brief A song is opened for streaming (compiling it if the cache is out of date). @see SongStream::open */
+  STACK_OP_OPEN,
+  /** @brief The song being created is played back. @see Song::play_song */
+  STACK_OP_PLAYBACK,
+  /** @brief The song being created is saved to the SD card. @see sd_save_song */
+  STACK_OP_SAVE,
+  /** @brief The amount of operations. Not an operation. */
+  STACK_OP_COUNT
+};
+
+/** @brief The value every free byte of SRAM is painted with. */
+constexpr uint8_t STACK_CANARY = 0xC5;
+/** @brief The character which prints the stack report when it is received over serial. */
+constexpr char STACK_REPORT_COMMAND = 'S';
+/** @brief The amount of states which are measured. Must match the StateID enum. */
+constexpr uint8_t STACK_STATE_COUNT = CM_CREATE_NEW + 1;
+
+#if PERF_METRICS == true
+
+/**
+ * @brief Collect the deepest stack of the state which is being left. Called whenever the program state changes.
+ *
+ * @param state The state which is starting.
+ */
+void stack_watch_state(StateID state);
+
+/**
+ * @brief Start measuring an operation. The stack used before this point is counted for the current state only.
+ *
+ * @param op The operation which is starting.
+ */
+void stack_watch_begin(StackOperation op);
+
+/**
+ * @brief Stop measuring an operation and keep its deepest stack if it is deeper than any earlier run.
+ *
+ * @param op The operation which has finished.
+ */
+void stack_watch_end(StackOperation op);
+
+/**
+ * @brief Print the static SRAM and the deepest stack of every state and operation over serial.
+ */
+void stack_watch_report();
+
+#define STACK_WATCH_STATE(state) stack_watch_state(state)
+#define STACK_WATCH_BEGIN(op) stack_watch_begin(op)
+#define STACK_WATCH_END(op) stack_watch_end(op)
+
+#else
+
+#define STACK_WATCH_STATE(state)
+#define STACK_WATCH_BEGIN(op)
+#define STACK_WATCH_END(op)
+
+#endif
+
+#endif
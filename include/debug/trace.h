@@ -0,0 +1,112 @@
+/**
+ * @file trace.h
+ * @author Jacob LuVisi
+ * @brief A fixed size ring buffer of binary performance events. Only compiled when PERF_METRICS is true.
+ *
+ * Printing timing information over a 9600 baud serial port takes longer than most of the things being measured so the
+ * performance metrics only store small binary records in SRAM. Each record is the time it happened (micros(), which is counted
+ * by Timer0), the type of the event and 16 bits of data. Once the ring is full the oldest records are overwritten.
+ *
+ * Sending TRACE_DUMP_COMMAND ('T') over the serial monitor sends the contents of the ring and empties it. Events which happen
+ * while the dump is being sent are not recorded. Send it again to collect more samples. The dump is binary:
+ * - 4 bytes: TRACE_MAGIC ("TSTR")
+ * - 1 byte: TRACE_VERSION
+ * - 1 byte: The size of one record (7).
+ * - 2 bytes: The amount of records in the dump.
+ * - 2 bytes: The amount of records which were overwritten before they could be dumped (at most 65535).
+ * - The records from oldest to newest: 4 bytes time (us), 1 byte TraceEvent, 2 bytes data.
+ *
+ * All values are little endian. Capture the serial output to a file and run it through tools/trace_decode.cpp to get the loop()
+ * latency of every StateID as a histogram. Anything else on the serial port (ex. DEBUG messages) is skipped by the decoder.
+ *
+ * Use TRACE_EVENT(event, data) to record an event so nothing is compiled when PERF_METRICS is false.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef trace_h
+#define trace_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The types of events stored in the trace. */
+enum TraceEvent: uint8_t {
+  /** @brief loop() has started. Data is the StateID of the current state. */
+  TRACE_LOOP_START,
+  /** @brief loop() has finished. Data is the StateID of the state which ran. */
+  TRACE_LOOP_END,
+  /** @brief The program state was changed. Data is the StateID of the new state. */
+  TRACE_STATE,
+  /** @brief A note has started playing. Data is the index of the note (low byte) and the voice playing it (high byte). */
+  TRACE_NOTE_ON,
+  /** @brief A playing note was stopped. Data is the voice which stopped (high byte). */
+  TRACE_NOTE_OFF,
+  /** @brief A song was opened on the SD card. Data is the amount of notes in it (0 if it could not be opened). */
+  TRACE_SD_OPEN,
+  /** @brief A song on the SD card was closed. Data is unused. */
+  TRACE_SD_CLOSE,
+  /** @brief A sample of the free memory. Data is the amount of free bytes between the heap and the stack. */
+  TRACE_MEMORY
+};
+
+/** @brief The amount of records the ring buffer holds. Must be a power of 2. */
+constexpr uint8_t TRACE_BUFFER_SIZE = 128;
+/** @brief The character which dumps the trace when it is received over serial. */
+constexpr char TRACE_DUMP_COMMAND = 'T';
+/** @brief The first bytes of a dump. */
+const char TRACE_MAGIC[] = "TSTR";
+/** @brief Changed whenever the layout of a dump changes. */
+constexpr uint8_t TRACE_VERSION = 1;
+/** @brief How often (in ms) the free memory is sampled. */
+constexpr uint16_t TRACE_MEMORY_INTERVAL = 1250;
+
+#if PERF_METRICS == true
+
+/**
+ * @brief Represents a single event in the trace. <i>(Used as traceRecord_t)</i>
+ */
+typedef struct __attribute__((packed)) traceRecord {
+  /** @brief The time (micros) the event happened at. */
+  uint32_t time;
+  /** @brief The TraceEvent. */
+  uint8_t event;
+  /** @brief Information about the event. @see TraceEvent */
+  uint16_t data;
+} traceRecord_t;
+
+/**
+ * @brief Start the serial port used to dump the trace.
+ */
+void trace_begin();
+
+/**
+ * @brief Add an event to the trace. Safe to call from an interrupt.
+ *
+ * @param event The type of event.
+ * @param data Information about the event.
+ */
+void trace_record(TraceEvent event, uint16_t data);
+
+/**
+ * @brief Dump the trace if TRACE_DUMP_COMMAND was received over serial or print the stack report if STACK_REPORT_COMMAND was
+ * received (see stack_watch.h). Called once every loop().
+ */
+void trace_poll();
+
+/**
+ * @brief Send every record in the trace over serial and empty it.
+ */
+void trace_dump();
+
+#define TRACE_EVENT(event, data) trace_record(event, data)
+
+#else
+
+#define TRACE_EVENT(event, data)
+
+#endif
+
+#endif
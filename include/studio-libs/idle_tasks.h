@@ -0,0 +1,61 @@
+/**
+ * @file idle_tasks.h
+ * @author Jacob LuVisi
+ * @brief Runs small background tasks while delay_ms is waiting instead of spinning.
+ *
+ * A task is a step function which does a small piece of work and returns if it has more to do. Every time delay_ms goes around
+ * its loop one task (in turn) is given its budget of time. The task is only started when its whole budget fits before the end of
+ * the delay and its steps are only repeated while another step (as long as the slowest one so far) still fits in the budget, so
+ * a delay never ends later than it did without tasks. delay_ms still checks is_interrupt() between every task.
+ *
+ * Tasks are cooperative: a step must never call delay_ms itself and should take much less time than its budget.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef idle_tasks_h
+#define idle_tasks_h
+
+#include <studio-libs/tune_studio.h>
+
+/**
+ * @brief One step of a background task.
+ *
+ * @param context The pointer the task was added with.
+ * @return If the task has more work to do right away.
+ */
+typedef bool (*idleTaskStep_t)(void * context);
+
+/** @brief The most tasks which can be added at the same time. */
+constexpr uint8_t IDLE_TASK_MAX = 4;
+
+/**
+ * @brief Add a background task. Nothing happens if the same step and context were already added.
+ *
+ * @param step The step function of the task.
+ * @param context Passed to every step (ex. the ProgramState which owns the task).
+ * @param budgetUs The most time (in microseconds) the task is given each time it runs.
+ * @return If the task was added (false if IDLE_TASK_MAX tasks are already added).
+ */
+bool idle_task_add(idleTaskStep_t step, void * context, uint16_t budgetUs);
+
+/**
+ * @brief Remove a background task. Must be called before the context of the task is destroyed.
+ *
+ * @param step The step function of the task.
+ * @param context The context the task was added with.
+ */
+void idle_task_remove(idleTaskStep_t step, void * context);
+
+/**
+ * @brief Give the next task its budget if it fits before a deadline. Called by delay_ms.
+ *
+ * @param deadline The millis() that the caller has to return by.
+ * @return If a task was run.
+ */
+bool idle_tasks_run(unsigned long deadline);
+
+#endif
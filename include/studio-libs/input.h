@@ -0,0 +1,90 @@
+/**
+ * @file input.h
+ * @author Jacob LuVisi
+ * @brief Scans the eight buttons from a timer interrupt and turns them into a queue of debounced events.
+ *
+ * The Timer2 overflow interrupt (about every 2ms, Timer2 keeps running the PWM of the RGB led) reads PINA, PINE and PING once
+ * and feeds every button into its own debounce counter. A button only changes state after it has read the same level for
+ * INPUT_DEBOUNCE_TICKS scans in a row so pressing one button never blocks another one.
+ *
+ * When a button changes state the interrupt pushes an event (press, release, long press or chord) into a single producer, single
+ * consumer queue. The interrupt is the only writer of the head and the main loop is the only writer of the tail so neither side
+ * needs to turn off interrupts. Presses are queued while the main loop is busy (playing a song, writing to the SD card) and are
+ * handled when it gets back to them instead of being missed.
+ *
+ * A chord is SELECT or DEL/CANCEL pressed while OPTION is held. It replaces the press of SELECT or DEL/CANCEL.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef input_h
+#define input_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The index of every button in the scan (and the bit of the button in input_get_held()). */
+enum InputButton: uint8_t {
+  INPUT_TONE_1, INPUT_TONE_2, INPUT_TONE_3, INPUT_TONE_4, INPUT_TONE_5, INPUT_SELECT, INPUT_CANCEL, INPUT_OPTION, INPUT_BUTTON_COUNT
+};
+
+/** @brief What happened to a button. */
+enum InputEventType: uint8_t {
+  /** @brief The button was pressed down. */
+  INPUT_PRESS,
+  /** @brief The button was let go. */
+  INPUT_RELEASE,
+  /** @brief The button has been held for INPUT_LONG_PRESS_TICKS. Sent once per press. */
+  INPUT_LONG_PRESS,
+  /** @brief SELECT or DEL/CANCEL was pressed while OPTION was held. Sent instead of INPUT_PRESS. */
+  INPUT_CHORD
+};
+
+/** @brief One event from the queue. */
+typedef struct inputEvent {
+  /** @brief The InputEventType. */
+  uint8_t type;
+  /** @brief The InputButton the event happened to. */
+  uint8_t button;
+} inputEvent_t;
+
+/** @brief The amount of scans (about 2ms each) a button must read the same level before its state changes. */
+constexpr uint8_t INPUT_DEBOUNCE_TICKS = 4;
+/** @brief The amount of scans (about 2ms each) a button must be held before INPUT_LONG_PRESS is sent. */
+constexpr uint16_t INPUT_LONG_PRESS_TICKS = 300;
+/** @brief The amount of events the queue holds. Must be a power of 2. Events are dropped when the queue is full. */
+constexpr uint8_t INPUT_QUEUE_SIZE = 16;
+
+/**
+ * @brief Converts a button pin to an InputButton.
+ *
+ * @return The InputButton or INPUT_BUTTON_COUNT if the pin is not a button.
+ */
+constexpr uint8_t input_button_of(uint8_t pin) {
+  return pin == BTN_TONE_1 ? INPUT_TONE_1 : pin == BTN_TONE_2 ? INPUT_TONE_2 : pin == BTN_TONE_3 ? INPUT_TONE_3 :
+    pin == BTN_TONE_4 ? INPUT_TONE_4 : pin == BTN_TONE_5 ? INPUT_TONE_5 : pin == BTN_ADD_SELECT ? INPUT_SELECT :
+    pin == BTN_DEL_CANCEL ? INPUT_CANCEL : pin == BTN_OPTION ? INPUT_OPTION : INPUT_BUTTON_COUNT;
+}
+
+/**
+ * @brief Start scanning the buttons from the Timer2 overflow interrupt. Every button starts released.
+ * Called once from setup() after the pull ups are enabled.
+ */
+void input_begin();
+
+/**
+ * @brief Take the oldest event from the queue. Only called from the main loop.
+ *
+ * @param event Set to the event.
+ * @return If there was an event.
+ */
+bool input_pop(inputEvent_t &event);
+
+/**
+ * @return The debounced state of every button (bit n set if InputButton n is held).
+ */
+uint8_t input_get_held();
+
+#endif
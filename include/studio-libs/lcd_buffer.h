@@ -0,0 +1,110 @@
+/**
+ * @file lcd_buffer.h
+ * @author Jacob LuVisi
+ * @brief A shadow framebuffer for the 20x4 I2C display.
+ *
+ * States draw into the buffer using the same methods as LiquidCrystal_I2C (setCursor, print, write, clear) which only change
+ * SRAM. Nothing is sent over I2C until flush() is called. flush() compares the buffer with what is currently on the display and
+ * only sends the cells which changed. A run of changed cells on a row is sent as one cursor set followed by the characters.
+ *
+ * Redrawing a screen which did not change (ex. the name line in the save screen) costs nothing and clearing the display does not
+ * need the slow HD44780 clear command.
+ *
+ * The buffer is flushed by delay_ms() and after every iteration of loop(). Loops which never delay must call flush() themselves.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef lcd_buffer_h
+#define lcd_buffer_h
+
+#include <LiquidCrystal_I2C.h>
+
+/** @brief How many columns the connected I2C LCD has. */
+constexpr uint8_t LCD_COLS = 20;
+/** @brief How many rows the connected I2C LCD has. */
+constexpr uint8_t LCD_ROWS = 4;
+
+class LcdBuffer: public Print {
+  private:
+  /** @brief The display which the buffer is flushed to. */
+  LiquidCrystal_I2C _lcd;
+  /** @brief What the states want to show on the display. */
+  uint8_t _cells[LCD_ROWS][LCD_COLS];
+  /** @brief What is currently shown on the display. */
+  uint8_t _shown[LCD_ROWS][LCD_COLS];
+  /** @brief The column that the next character is written to. */
+  uint8_t _col;
+  /** @brief The row that the next character is written to. */
+  uint8_t _row;
+
+  public:
+  /**
+   * @brief Construct a new buffer for a display.
+   *
+   * @param lcdAddr The I2C address of the display.
+   */
+  LcdBuffer(uint8_t lcdAddr);
+
+  /**
+   * @brief Initalize the display. Clears both the display and the buffer.
+   */
+  void init();
+
+  /**
+   * @brief Turn the backlight on. Sent right away.
+   */
+  void backlight();
+
+  /**
+   * @brief Create a custom character. Sent right away.
+   *
+   * @param location The slot of the character (0-7).
+   * @param charmap The 8 rows of the character.
+   */
+  void createChar(uint8_t location, uint8_t charmap[]);
+
+  /**
+   * @brief Clear the buffer and move the cursor to the top left.
+   */
+  void clear();
+
+  /**
+   * @brief Move the cursor of the buffer.
+   *
+   * @param col The column.
+   * @param row The row.
+   */
+  void setCursor(uint8_t col, uint8_t row);
+
+  /**
+   * @brief Write a character to the buffer. Past the end of a row the cursor moves to the next row in the same order as the HD44780.
+   *
+   * @param value The character.
+   * @return 1
+   */
+  size_t write(uint8_t value) override;
+  using Print::write;
+
+  /**
+   * @brief Clear a single row of the buffer and move the cursor to the start of it.
+   *
+   * @param row The row to clear.
+   */
+  void clear_row(uint8_t row);
+
+  /**
+   * @brief Send every cell which is different from the display.
+   */
+  void flush();
+
+  /**
+   * @return The display which the buffer is flushed to.
+   */
+  LiquidCrystal_I2C & get_display();
+};
+
+#endif
@@ -118,4 +118,8 @@ const char pitch_a7[] PROGMEM = "A7";
 const char pitch_as7[] PROGMEM = "AS7";
 const char pitch_b7[] PROGMEM = "B7";
 
+// Reserved (Not on a tune button)
+const char pitch_pause[] PROGMEM = "PS";
+const char pitch_empty[] PROGMEM = "0000";
+
 #endif
@@ -0,0 +1,49 @@
+/**
+ * @file pot.h
+ * @author Jacob LuVisi
+ * @brief Reads the potentiometer (TONE_FREQ) in the background with the ADC in free running mode.
+ *
+ * The ADC converts the potentiometer over and over (about 9600 times a second) and calls an interrupt after each conversion.
+ * The interrupt averages every POT_OVERSAMPLE conversions and only publishes the average when it has moved more than
+ * POT_HYSTERESIS away from the last published value. A knob which rests between two of the 17 tones (or two naming characters)
+ * therefore stays on one of them instead of jittering back and forth.
+ *
+ * Reading the potentiometer is only a copy of the published value and never waits for a conversion.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef pot_h
+#define pot_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The amount of conversions which are averaged into one reading. Must be a power of 2 and 64 or less. */
+constexpr uint8_t POT_OVERSAMPLE = 16;
+/** @brief How far (out of 1023) an average must move from the published value before it is published. */
+constexpr uint8_t POT_HYSTERESIS = 6;
+/** @brief The highest value of the ADC. */
+constexpr uint16_t POT_MAX = 1023;
+
+/**
+ * @brief Take a first reading and start the ADC in free running mode. Called once from setup().
+ */
+void pot_begin();
+
+/**
+ * @return The last published value of the potentiometer (0 to 1023).
+ */
+uint16_t pot_get_value();
+
+/**
+ * @brief Check if a new value was published since the last time this was called. Clears the flag.
+ * @remark Only one place in the program should use the flag (get_current_tone) or it would miss changes.
+ *
+ * @return If the value of the potentiometer changed.
+ */
+bool pot_has_changed();
+
+#endif
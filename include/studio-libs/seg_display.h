@@ -0,0 +1,83 @@
+/**
+ * @file seg_display.h
+ * @author Jacob LuVisi
+ * @brief Drives the 4 digit 7-segment display (2x 74HC595N shift registers) from a timer interrupt.
+ *
+ * The resistors of the display are on the digit pins so only one segment can be lit at a time. The display is multiplexed one
+ * segment per interrupt: the interrupt shifts out a 16 bit word which turns on segment N and every digit which shows segment N.
+ * The Timer0 compare A interrupt (about once every millisecond) is used so the whole display is refreshed about 140 times a
+ * second no matter what the main loop is doing (SD card, LCD, delays).
+ *
+ * The 7 words for every note (and the pause, empty and blank displays) are calculated by the compiler and stored in PROGMEM.
+ * Changing the note which is shown only changes which row of the table the interrupt reads from.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef seg_display_h
+#define seg_display_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The amount of digits on the display. */
+constexpr uint8_t SEG_DIGIT_COUNT = 4;
+
+/** @brief A digit with every segment off. */
+constexpr uint8_t SEG_GLYPH_BLANK = 0x00;
+/** @brief The segments (bit 0 = A to bit 6 = G) which show the numbers 0-9. */
+constexpr uint8_t SEG_GLYPH_NUMBERS[10] = { 0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F };
+/** @brief The segments which show the letter of each semitone from C to B. */
+constexpr uint8_t SEG_GLYPH_SEMITONES[12] = { 0x39, 0x39, 0x5E, 0x5E, 0x79, 0x71, 0x71, 0x3D, 0x3D, 0x77, 0x77, 0x7C };
+/** @brief The segments which show the letter 'S'. */
+constexpr uint8_t SEG_GLYPH_S = 0x6D;
+/** @brief The segments which show the letter 'P'. */
+constexpr uint8_t SEG_GLYPH_P = 0x73;
+
+/**
+ * @brief Get the segments shown on one digit of the display for a note. The note is shown the same way as its pitch (ex. "CS4").
+ *
+ * @param note The index of the note (in PROGRAM_NOTES), PAUSE_NOTE_INDEX or EMPTY_NOTE_INDEX.
+ * @param digit The digit (0 is the left most).
+ * @return The segments of the digit (bit 0 = A to bit 6 = G).
+ */
+constexpr uint8_t seg_note_glyph(uint8_t note, uint8_t digit) {
+  return note == PAUSE_NOTE_INDEX ? (digit == 0 ? SEG_GLYPH_P : digit == 1 ? SEG_GLYPH_S : SEG_GLYPH_BLANK) :
+    note >= PROGRAM_NOTE_AMOUNT ? SEG_GLYPH_NUMBERS[0] :
+    digit == 0 ? SEG_GLYPH_SEMITONES[(FIRST_NOTE_CHROMATIC + note) % 12] :
+    // Sharps are one character longer (ex. "C4" and "CS4").
+    (FIRST_NOTE_CHROMATIC + note) % 12 == 1 || (FIRST_NOTE_CHROMATIC + note) % 12 == 3 || (FIRST_NOTE_CHROMATIC + note) % 12 == 6 ||
+    (FIRST_NOTE_CHROMATIC + note) % 12 == 8 || (FIRST_NOTE_CHROMATIC + note) % 12 == 10 ?
+      (digit == 1 ? SEG_GLYPH_S : digit == 2 ? SEG_GLYPH_NUMBERS[(FIRST_NOTE_CHROMATIC + note) / 12] : SEG_GLYPH_BLANK) :
+      (digit == 1 ? SEG_GLYPH_NUMBERS[(FIRST_NOTE_CHROMATIC + note) / 12] : SEG_GLYPH_BLANK);
+}
+
+/**
+ * @brief Set up the shift register pins and start refreshing the display from the Timer0 compare A interrupt. The display is blank.
+ * Called once from setup().
+ */
+void seg_begin();
+
+/**
+ * @brief Show a note on the display.
+ *
+ * @param note The index of the note (in PROGRAM_NOTES), PAUSE_NOTE_INDEX or EMPTY_NOTE_INDEX.
+ */
+void seg_show_note(uint8_t note);
+
+/**
+ * @brief Turn every digit of the display off.
+ */
+void seg_blank();
+
+/**
+ * @brief Get what the interrupt is currently showing on a digit.
+ *
+ * @param digit The digit (0 is the left most).
+ * @return The segments of the digit (bit 0 = A to bit 6 = G).
+ */
+uint8_t seg_get_glyph(uint8_t digit);
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * @file sequencer.h
+ * @author Jacob LuVisi
+ * @brief An interrupt driven note sequencer. Starts and stops the notes of a song from a timer interrupt so playback does not
+ * block the main loop and note timing does not depend on how long the loop takes.
+ *
+ * The sequencer piggybacks on Timer0 (which the Arduino core already runs for millis()) by enabling its compare B interrupt.
+ * The interrupt is called about once every millisecond and checks if the next note event (note on, note off or the end of a rest)
+ * is due. Every event is scheduled from the deadline of the previous event rather than from the time it was handled so the song
+ * never drifts.
+ *
+ * The main loop only feeds notes into a small queue with sequencer_feed() and reads sequencer_get_played() to know how far
+ * along the song is. A note is counted as played once its length (or PAUSE_DELAY for a rest) has passed.
+ *
+ * Songs with more than one track are fed one step at a time (the note of every track which starts at the same time). The notes of
+ * a step start and stop together, each on its own voice. @see voices.h
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef sequencer_h
+#define sequencer_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The amount of steps that can be fed to the sequencer before they are played. Must be a power of two. */
+constexpr uint8_t SEQUENCER_QUEUE_SIZE = 16;
+
+/**
+ * @brief Enable the Timer0 compare interrupt which runs the sequencer. Called once from setup().
+ */
+void sequencer_begin();
+
+/**
+ * @brief Set the delay between notes and the length of each note. Takes effect from the next note.
+ *
+ * @param noteDelay The delay between each note.
+ * @param noteLength The length that each note is played for.
+ */
+void sequencer_set_timing(uint16_t noteDelay, uint8_t noteLength);
+
+/**
+ * @brief Change the delay between notes and the length of each note from the next step which is fed instead of the next step
+ * which plays. Used to feed the first step of the next song of a playlist behind the last steps of the current song.
+ * @remark The delay after the step before it is not changed so the next song starts one note delay of the current song after
+ * its last note. sequencer_clear() removes the change.
+ *
+ * @param noteDelay The delay between each note.
+ * @param noteLength The length that each note is played for.
+ * @return If the change was made (false while an earlier change has not started playing yet).
+ */
+bool sequencer_feed_timing(uint16_t noteDelay, uint8_t noteLength);
+
+/**
+ * @brief Add a step (the notes of every track which start at the same time) to the end of the queue.
+ * Every note of the step is played on its own voice. @see voices.h
+ *
+ * @param notes The index of each note (in PROGRAM_NOTES) or PAUSE_NOTE_INDEX.
+ * @param amount The amount of notes (tracks) in the step. Tracks past the amount are silent.
+ * @return If there was room for the step.
+ */
+bool sequencer_feed(const uint8_t * notes, uint8_t amount = 1);
+
+/**
+ * @brief Stop the current note, remove every note (and timing change) from the queue and reset the played counter. The pause state
+ * is kept.
+ * @remark Used to stop playback or to seek to a different note (clear and then feed from the new note).
+ */
+void sequencer_clear();
+
+/**
+ * @brief Pause or resume playback. The current note is stopped (and counted as played) when pausing.
+ * Playback continues with the next note right away when resumed.
+ *
+ * @param paused If the sequencer should be paused.
+ */
+void sequencer_pause(bool paused);
+
+/**
+ * @return The amount of notes which have finished playing since the last sequencer_clear().
+ */
+uint16_t sequencer_get_played();
+
+#endif
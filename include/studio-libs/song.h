@@ -4,9 +4,13 @@
  * @brief The song header file used for defining the methods for a song object. Songs can be added to, removed from, played, and saved
  * to permanent storage like an SD Card. There are important notes about using the song class which should be read below.
  *
- * Note that songs do not use the "note" struct defined in tune_studio.h to store notes. Instead a basic 16-bit unsigned integer
- * array stores the frequencies of each of the individual notes. In order to get the respective "pitch" of the current note the
- * frequency must be passed into the get_note_from_freq(const uint16_t frequency) method in the main class.
+ * Note that songs do not use the "note" struct defined in tune_studio.h to store notes. Instead a basic 8-bit unsigned integer
+ * array stores the index of each note in PROGRAM_NOTES (or PAUSE_NOTE_INDEX/EMPTY_NOTE_INDEX). In order to get the respective "pitch"
+ * or frequency of a note the index must be passed into get_note_pitch_P(const uint8_t note) or get_note_frequency(const uint8_t note) in the main class.
+ *
+ * <b>R6 & NEWER</b>:
+ * Notes are stored as 1-byte indices instead of 16-bit frequencies. A song takes half of the SRAM it used to so the MAX_SONG_LENGTH of every
+ * PRGM_MODE was doubled. The frequency of a note is only looked up when it is played.
  *
  * <b>[OUTDATED] R1 & R2:</b>
  * X // The array which stores the frequencies for the song is dynamically allocated initally depending on the _maxLength value but it cannot
@@ -18,6 +22,11 @@
  * at any time during the programming cycle. (Songs are no longer created/freed on the heap as of v1.2.0-R3)
  * 
  *
+ * <b>Tracks</b>:
+ * A song can have up to SONG_MAX_TRACKS tracks which are played at the same time (one voice each). The notes are stored step by step
+ * (every track of the first note, then every track of the second note and so on) so a song of N notes and T tracks uses N * T bytes.
+ * Songs start with one track and get_size() always counts notes (steps), not bytes.
+ *
  * The size of the song is dependent on the PRGM_MODE ("Program Mode"). This allows any user who edits TuneStudio2560 to change the max length
  * of the song to their own desire. A special song_size_t datatype is used to keep track of which unsigned integer datatype to use depending on the Program Mode for
  * maximum efficiency.
@@ -33,8 +42,8 @@
 
 #include <NewTone.h>
 
-/** @brief A variable type which can be either uint8_t or uint16_t depending on song size and PRGM_MODE. */
-typedef uint8_t song_size_t;
+/** @brief The type of a note count or note position in a song. Holds the MAX_SONG_LENGTH of every PRGM_MODE. */
+typedef uint16_t song_size_t;
 
 /** @brief The global delay that should be used when a PAUSE_NOTE is encountered. Default: 500ms */
 constexpr uint16_t PAUSE_DELAY = 500;
@@ -51,19 +60,20 @@ class Song {
   /** @brief The current hardware pin of a speaker. */
   uint8_t _pin; 
   /** @brief The note delay of the song. */
-  uint8_t _noteDelay; 
+  uint16_t _noteDelay; 
   /** @brief The note length of the song. */
   uint8_t _noteLength; 
   /** @brief The current size of the song. Is changed every time a note is added or remove from the _songData. */
   song_size_t _currSize;
   /**
-   * @brief An array of MAX_SONG_SIZE which holds the values of all of the frequencies the song should play.
-   * @remark It is important to know that the Song class does not directly deal with the note_t struct at all. Rather, notes are stored as frequencies only and pitches are retrieved on the fly.
-   * @see note_t get_note_from_freq(const uint16_t frequency)
-   * @see note_t get_note_from_pitch(const char * const pitch)
+   * @brief An array of MAX_SONG_SIZE which holds the index (in PROGRAM_NOTES) of all of the notes the song should play.
+   * @remark It is important to know that the Song class does not directly deal with the note_t struct at all. Rather, notes are stored as indices only and pitches/frequencies are retrieved on the fly.
+   * @see PGM_P get_note_pitch_P(const uint8_t note)
+   * @see uint16_t get_note_frequency(const uint8_t note)
+   * @see uint8_t get_note_from_pitch(const char * const pitch)
    * 
    */
-  uint16_t _songData[MAX_SONG_SIZE];
+  uint8_t _songData[MAX_SONG_SIZE];
   public:
     /**
      * @brief Construct a new song object.
@@ -78,9 +88,9 @@ class Song {
    * @brief Play a note at a specified pin. This method is not neccessarily tied to any specific song object and works the same
    * no matter how the song is built.
    *
-   * @param note The note to play.
+   * @param note The index of the note to play. The frequency is looked up from PROGRAM_NOTES.
    */
-  void play_note(uint16_t note);
+  void play_note(uint8_t note);
 
   /**
    * @return If the song has reached its max length and nothing more can be added to it.
@@ -90,9 +100,9 @@ class Song {
   /**
    * @brief Adds a note to the end of the song. If the song is full then the method completes without executing.
    *
-   * @param note The note to add.
+   * @param note The index of the note to add (on the first track).
    */
-  void add_note(uint16_t note);
+  void add_note(uint8_t note);
 
   /**
    * @brief Adds a pause to the song. The amount of time the song is paused by is determined by a unchangeable variable. If the song is full then the method completes without executing.
@@ -107,7 +117,7 @@ class Song {
 
   /**
    * @brief Plays the current song.
-   * @remark Uses a blocking delay method.
+   * @remark Waits until the song has finished (or an interrupt happens) but the notes are timed by the sequencer.
    */
   void play_song();
 
@@ -117,12 +127,19 @@ class Song {
   void clear();
 
   /**
-   * @brief Get a frequency at a specified index of the song.
+   * @brief Get a note at a specified index of the song.
    *
    * @param index The index of the note to retrieve.
-   * @return The frequency of the note.
+   * @param track The track of the note.
+   * @return The index of the note in PROGRAM_NOTES (or PAUSE_NOTE_INDEX/EMPTY_NOTE_INDEX).
+   */
+  uint8_t get_note(song_size_t index, uint8_t track = 0);
+
+  /**
+   * @return The amount of tracks of the song. Always 1, the creator makes songs with one track. Songs with more tracks are only
+   * written by hand and are played from the SD card. @see SongStream
    */
-  uint16_t get_note(song_size_t index);
+  uint8_t get_track_count();
 
   /**
    * @return If a song is empty as in it has no notes in it.
@@ -130,7 +147,7 @@ class Song {
   bool is_empty();
 
   /**
-   * @brief Gets the size of the song (number of individual frequencies).
+   * @brief Gets the size of the song (number of individual notes).
    * @return Size of the song.
    */
   song_size_t get_size();
@@ -0,0 +1,159 @@
+/**
+ * @file song_stream.h
+ * @author Jacob LuVisi
+ * @brief Plays back a song directly from its compiled cache on the SD card instead of copying it into the global song object.
+ *
+ * Only two blocks of SONG_STREAM_BLOCK_SIZE bytes (notes) are kept in SRAM at a time. Block n of the song is always stored in slot (n & 1)
+ * so while one block is being played the other one can be filled with the next block of the song in between notes (prefetch).
+ * This keeps the memory used by playback the same no matter how long the song is and songs are only limited by the SD card.
+ *
+ * Seeking backwards or forwards simply asks for a different note. If its block is not in memory it is read from the SD card.
+ *
+ * Songs with more than one track store every track of a note next to each other so the blocks are counted in bytes and a note
+ * may start in one block and end in the next (which is always in the other slot).
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef song_stream_h
+#define song_stream_h
+
+#include <studio-libs/tune_studio.h>
+
+class SongStream {
+  private:
+  /** @brief The open cache file of the song. */
+  File _file;
+  /** @brief The header of the cache file (note count, track count, delay and length). */
+  songCacheHeader_t _header;
+  /** @brief The two blocks of notes which are held in memory. */
+  uint8_t _blocks[2][SONG_STREAM_BLOCK_SIZE];
+  /** @brief The block of the song that each slot holds. NO_BLOCK if the slot is empty. */
+  song_size_t _blockNumber[2];
+  /** @brief Marks an empty slot. */
+  static constexpr song_size_t NO_BLOCK = UINT16_MAX;
+  /** @brief The name of the song which is open or being opened (empty if no song is open). */
+  char _fileName[13];
+  /** @brief If the song is still being verified or compiled. @see open_step */
+  bool _isOpening;
+
+  /**
+   * @brief Read a block of the song from the SD card into its slot.
+   *
+   * @param block The block of the song to read.
+   * @return If the block could be read.
+   */
+  bool load_block(song_size_t block);
+
+  /**
+   * @brief Finish opening the song once sd_song_open_start, sd_song_open_step or sd_song_open_finish is done with it. The first
+   * block of the song is read right away.
+   *
+   * @param status What opening the song returned. Nothing happens while it is SONG_OPEN_BUSY.
+   */
+  void open_status(SongOpenStatus status);
+
+  public:
+  SongStream();
+  ~SongStream();
+
+  /**
+   * @brief Open a song to be streamed. The first block of the song is read right away. If the song is already being opened
+   * (open_begin) the rest of it is opened without stopping.
+   *
+   * @param fileName The name of the song (.txt) on the SD card.
+   * @return If the song was valid and could be opened.
+   */
+  bool open(const char * const fileName);
+
+  /**
+   * @brief Start opening a song to be streamed without waiting for it to be verified or compiled. @see open_step
+   *
+   * @param fileName The name of the song (.txt) on the SD card.
+   * @return If the song exists and is being opened.
+   */
+  bool open_begin(const char * const fileName);
+
+  /**
+   * @brief Verify or compile the next small part of the song which is being opened. Takes about as long as reading a block.
+   *
+   * @return If there is more to do. Once it is done is_open tells if the song could be opened (get_size() is 0 if it could not).
+   */
+  bool open_step();
+
+  /**
+   * @param fileName The name of a song (.txt) on the SD card.
+   * @return If the song is the one which is open.
+   */
+  bool is_open(const char * const fileName);
+
+  /**
+   * @param fileName The name of a song (.txt) on the SD card.
+   * @return If the song is the one which is being opened. @see open_begin
+   */
+  bool is_opening(const char * const fileName);
+
+  /**
+   * @brief Close the song (or stop opening it). Must be called before the song file is deleted.
+   */
+  void close();
+
+  /**
+   * @brief Get a note of the song. The block of the note is read from the SD card if it is not in memory.
+   *
+   * @param index The index of the note.
+   * @param track The track of the note.
+   * @return The note (index in PROGRAM_NOTES or PAUSE_NOTE_INDEX) or EMPTY_NOTE_INDEX if it could not be read.
+   */
+  uint8_t get_note(song_size_t index, uint8_t track = 0);
+
+  /**
+   * @brief Get every track of a note. @see get_note
+   *
+   * @param index The index of the note.
+   * @param notes Set to the note of each track. Must hold get_track_count() notes.
+   */
+  void get_step(song_size_t index, uint8_t * notes);
+
+  /**
+   * @brief Make sure that the block after the note is in memory so the next notes do not need to wait for the SD card.
+   * Should be called in between notes.
+   *
+   * @param index The index of the note which is currently being played.
+   */
+  void prefetch(song_size_t index);
+
+  /**
+   * @return The amount of notes in the song.
+   */
+  song_size_t get_size();
+
+  /**
+   * @return The amount of tracks of the song (1 if no song is open).
+   */
+  uint8_t get_track_count();
+
+  /**
+   * @return The delay between each note.
+   */
+  uint16_t get_note_delay();
+
+  /**
+   * @return The length that each note is played for.
+   */
+  uint8_t get_note_length();
+};
+
+/**
+ * @brief The song which is highlighted in the listening mode menu. The menu opens it while the user is browsing so the song player
+ * can start playing it right away. The song player plays from it and closes it when it is done.
+ */
+extern SongStream stagedSong;
+
+/** @brief The next song of a playlist. It is opened while the current song is still playing. @see ListeningModePlayingSong */
+extern SongStream queuedSong;
+
+#endif
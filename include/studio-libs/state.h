@@ -21,7 +21,9 @@
  * Each individual state is defined in the "states.h" header file. This header file represents the parent class to every state.
  * The main.cpp class holds one global "state" variable called "prgmState" which is overriden when a new state is loaded.
  *
- * "prgmState" is a pointer to this class (parent class) and can be reallocated to any of the child states.
+ * "prgmState" is a pointer to this class (parent class) and can point to any of the child states.
+ * States are not allocated on the heap. Every state is constructed in the same static storage (sized to the largest state) and a
+ * state change requested with update_state() is only applied at the top of loop().
  *
  * @version 0.1
  * @date 2021-07-26
@@ -17,6 +17,9 @@
 #define states_h
 
 #include <studio-libs/tune_studio.h>
+#include <studio-libs/song_stream.h>
+#include <studio-libs/sequencer.h>
+#include <studio-libs/seg_display.h>
 
 class MainMenu: public ProgramState {
   private: 
@@ -25,8 +28,26 @@ class MainMenu: public ProgramState {
   public: MainMenu();~MainMenu();
 };
 
+/** @brief What the song player does after a song has finished. Changed with the red tone button while listening. */
+enum PlaylistMode: uint8_t {
+  /** @brief Stop and show FINISHED SONG. */
+  PLAYLIST_OFF,
+  /** @brief Play the next song on the SD card (the first song after the last one). */
+  PLAYLIST_SEQUENTIAL,
+  /** @brief Play a random song other than the current one. */
+  PLAYLIST_SHUFFLE,
+  /** @brief Play the same song again. */
+  PLAYLIST_REPEAT,
+  PLAYLIST_MODE_AMOUNT
+};
+
 class ListeningModePlayingSong: public ProgramState {
   #define LM_BOTTOM_TEXT_DELAY_INTERVAL 5000
+  /**
+   * @brief The time (in microseconds) feed_task is given while waiting. Reading a block of the song at SPI_CLOCK takes about 4ms
+   * and so does a step of opening the next song of the playlist.
+   */
+  #define LM_FEED_TASK_BUDGET_US 5000
   private: 
   void init() override;
   void loop() override;
@@ -40,12 +61,78 @@ class ListeningModePlayingSong: public ProgramState {
   bool isPaused;
   /** @brief If the user has requested to delete their song. */
   bool requestedDelete;
-  /** @brief The last time a tone was played. */
-  unsigned long lastTonePlay;
+  /** @brief The note of the song which the sequencer started playing from (changed when seeking). */
+  song_size_t playbackStart;
+  /** @brief The next note of the song which needs to be fed to the sequencer. */
+  song_size_t nextFeedNote;
   /** @brief The current note of the song that we are on. */
   song_size_t currentSongNote;
   /** @brief The size of the current song. */
   song_size_t currentSongSize;
+  /** @brief The song which is playing (stagedSong or queuedSong). The other one holds the next song of the playlist. */
+  SongStream * song;
+  /** @brief The song which is being fed to the sequencer. Moves on to the next song of the playlist before the current one ends. */
+  SongStream * feedSong;
+  /** @brief The number (like get_selected_song()) of the next song of the playlist or 0 if it has not been opened. */
+  uint8_t queuedSongNumber;
+  /** @brief If the next song of the playlist has been picked (even if it could not be opened). */
+  bool isQueueTried;
+  /** @brief The number of the song which is being opened as the next song of the playlist or 0 if none is. */
+  uint8_t queueCandidate;
+  /** @brief The amount of songs which have been tried as the next song of the playlist. */
+  uint8_t queueTries;
+  /**
+   * @brief Restart the sequencer from currentSongNote. Used after seeking forwards or backwards.
+   */
+  void seek_playback();
+  /**
+   * @brief Feed the next step of the song to the sequencer. After the last step of the song the steps of the next song of the
+   * playlist are fed (once it is open) so it starts one note delay after the last note without waiting for the SD card.
+   *
+   * @return If the step was fed (false if the song has been fed to the end or the queue of the sequencer is full).
+   */
+  bool feed_step();
+  /**
+   * @brief Pick the next song of the playlist and start opening it in the stream which is not playing. @see queue_step
+   */
+  void queue_next_song();
+  /**
+   * @brief Start opening the song after queueCandidate in the playlist order. Sets queueCandidate to 0 once every song has been
+   * tried.
+   */
+  void queue_open_candidate();
+  /**
+   * @brief Verify or compile the next small part of the next song of the playlist. Songs which can not be opened are skipped.
+   *
+   * @return If the next song needs more steps.
+   */
+  bool queue_step();
+  /**
+   * @brief Drop the next song of the playlist so it is picked again (ex. after the order changed). If it was fed already the
+   * current song is fed again from the current note.
+   */
+  void unqueue_next_song();
+  /**
+   * @brief Show the next song of the playlist once the last note of the current song has played.
+   */
+  void start_queued_song();
+  /**
+   * @brief Print the number and name of the song and an empty progress bar, and split the song into progress blocks.
+   *
+   * @param name The name of the song.
+   */
+  void print_song_info(const char * name);
+  /**
+   * @brief Print the playlist order on the bottom row of the LCD.
+   */
+  void print_playlist_mode();
+  /**
+   * @brief Keeps the sequencer fed and the next block of the song read while delay_ms is waiting. @see idle_tasks.h
+   *
+   * @param context The state.
+   * @return If more steps can be fed or the next song of the playlist needs more steps.
+   */
+  static bool feed_task(void * context);
   #if PRGM_MODE == 0
   /** @brief Tracks how many notes need to pass before a progress block is filled in. */
   song_size_t blockRequirement; 
@@ -62,11 +149,29 @@ class ListeningModePlayingSong: public ProgramState {
 };
 
 class ListeningModeMenu: public ProgramState {
+  /** @brief How long (in ms) a song must stay highlighted before it is opened. Songs which are skipped past are not read. */
+  #define LM_STAGE_DELAY 250
+  /** @brief The time (in microseconds) stage_task is given every time the menu goes around its loop. */
+  #define LM_STAGE_TASK_BUDGET_US 5000
   private: 
   void init() override;
   void loop() override;
   /** @brief The previous song that the method has read the user selected. Used for knowing when to update the lcd with new information. */
   uint8_t previousSong;
+  /** @brief The time the highlighted song was changed. */
+  unsigned long highlightTime;
+  /** @brief If the highlighted song has been opened in stagedSong. */
+  bool isStaged;
+  /** @brief If stage_task is still opening the highlighted song. */
+  bool isStaging;
+  /**
+   * @brief Opens the highlighted song a small part at a time so the buttons are still read while its text is compiled.
+   * @see idle_tasks.h
+   *
+   * @param context The state.
+   * @return If the song needs more steps.
+   */
+  static bool stage_task(void * context);
 
   public: ListeningModeMenu();~ListeningModeMenu();
 
@@ -80,6 +185,10 @@ class CreatorModeMenu: public ProgramState {
 };
 
 class CreatorModeCreateNew: public ProgramState {
+  #ifdef TUNESTUDIO_NATIVE
+  /** @brief Benchmarks print_song_lcd in the native simulator. @see sim_bench.cpp */
+  friend struct SimBench;
+  #endif
 
   private: 
   void init() override;
@@ -94,12 +203,45 @@ class CreatorModeCreateNew: public ProgramState {
   bool playSound;
   /** @brief The amount of lines the user has scrolled on the lcd. Needed for determining what notes to show. */
   uint8_t scrolledLines;
+  /** @brief The most rows the song can take on the lcd. Every row fits at least six pitches (three characters each). */
+  static constexpr uint8_t SONG_LCD_MAX_ROWS = MAX_SONG_LENGTH / (LCD_COLS / 3) + 1;
+  /** @brief The index of the first note of every row of the song on the lcd. Kept up to date as notes are added and removed. */
+  song_size_t rowStarts[SONG_LCD_MAX_ROWS];
+  /** @brief The amount of rows in rowStarts. */
+  uint8_t rowCount;
+  /** @brief The amount of columns taken by the pitches on the last row. */
+  uint8_t lastRowColumns;
   
+  /**
+   * @brief Add a note to the song and update the rows of the lcd without walking the song.
+   *
+   * @param note The note to add. Nothing happens if the song is full.
+   */
+  void add_song_note(uint8_t note);
+
+  /**
+   * @brief Remove the last note of the song and update the rows of the lcd without walking the song.
+   * Nothing happens if the song is empty.
+   */
+  void remove_song_note();
+
   /**
    * @brief Prints the current song to the LCD and accounts for scrolling.
    */
   void print_song_lcd();
 
+  /**
+   * @brief Prints the top row of the LCD (the scrolled row and the size of the song).
+   */
+  void print_song_header();
+
+  /**
+   * @brief Prints one row of the song if it is scrolled onto the LCD. Rows past the end of the song are cleared.
+   *
+   * @param row The row of the song (0 is the first row).
+   */
+  void print_song_row(uint8_t row);
+
   /**
    * @brief Get the amount of pages that the song should have.
    *
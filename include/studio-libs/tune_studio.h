@@ -14,11 +14,11 @@
 #ifndef tune_studio_h
 #define tune_studio_h
 
-#include <LiquidCrystal_I2C.h> 
-#include <SevSegShift.h>
+#include <studio-libs/lcd_buffer.h>
 #include <studio-libs/song.h>
 #include <studio-libs/state.h> 
 #include <lib/digitalWriteFast.h>
+#include <SdFat.h>
 #include <studio-libs/pitches.h>
 #include <studio-libs/song.h>
 
@@ -30,12 +30,24 @@
 
  /**
   * @brief Enable/Disable performance metrics for TuneStudio2560.<br/>
-  * Enabling this will: Enable serial console prints on the current Ram Usage, Stack Size, and Heap Fragmentation, as well as provide
-  * metrics on how fast certain functions are executing in micro and milliseconds as well as the change since last execute.<br/><br/>
+  * Enabling this will: Record the start and end of every loop(), state changes, notes, SD card songs and the free memory into a
+  * small binary trace in SRAM which is sent over serial when 'T' is received. The trace is decoded on a computer. Measure the
+  * deepest stack of every state and of opening, playing and saving songs, which is printed when 'S' is received.<br/><br/>
   *
-  * <b>NOTE:</b> Enabling performance metrics REQUIRES debug to be true.
+  * <b>NOTE:</b> DEBUG does not need to be enabled but its messages will slow down the loops being measured. @see trace.h
   */
+#ifndef PERF_METRICS
 #define PERF_METRICS false
+#endif
+
+/**
+ * @brief Build the cycle count benchmarks instead of the normal program.<br/>
+ * Enabling this will: Replace main() with one which runs setup() and then times the hot paths for the simavr emulator to count
+ * (see test/simavr). The program does nothing else. Set by the simavr_mode environments in platformio.ini. @see cycle_bench.h
+ */
+#ifndef CYCLE_BENCH
+#define CYCLE_BENCH false
+#endif
 
 /**
  * @brief Select a mode for the program to run in.
@@ -44,27 +56,10 @@
  * Mode 0 = Small Code Size <br />
  * Mode 1 = Balanced <br />
  * Mode 2 = High Features, Larger Songs <br />
- * 
+ * Can be set from the build flags (ex. -DPRGM_MODE=2) to build every mode without editing this file.
  */
+#ifndef PRGM_MODE
 #define PRGM_MODE 1
-
-
-/**
- * @brief A macro for defining if fast analog read should be used.
- * <br />
- * Faster Analog Read takes up around 30-40 more bytes of flash but allows much faster analog read. <br />
- * Increases the iterations per second (IPS) of creator mode by around 300-400.
- * <br /><br />
- * <i>Automatically enabled in PRGM_MODE == 2</i>
- */
-#define FAST_ADC (PRGM_MODE == 2 ? true : false)
-#if FAST_ADC
-#ifndef cbi
-#define cbi(sfr, bit) (_SFR_BYTE(sfr) &= ~_BV(bit))
-#endif
-#ifndef sbi
-#define sbi(sfr, bit) (_SFR_BYTE(sfr) |= _BV(bit))
-#endif
 #endif
 
 
@@ -135,28 +130,44 @@ constexpr uint8_t TONE_FREQ = PIN_A7;
 
 /** @brief The pin which is connected to the primary passive speaker. */
 constexpr uint8_t SPEAKER_1 = 34;
+/**
+ * @brief The pin of the second voice. The speaker pins should each go through a 1k resistor to the speaker (or to their own speaker).
+ * Only SPEAKER_1 is needed for songs with one track. @see voices.h
+ */
+constexpr uint8_t SPEAKER_2 = 35;
+/** @brief The pin of the third voice. */
+constexpr uint8_t SPEAKER_3 = 36;
+/** @brief The pin of the fourth voice. */
+constexpr uint8_t SPEAKER_4 = 37;
 
-/** @brief How many columns the connected I2C LCD has. */
-constexpr uint8_t LCD_COLS = 20;
-/** @brief How many rows the connected I2C LCD has. */
-constexpr uint8_t LCD_ROWS = 4;
-
-/** @brief The delay between when button presses should be read by the program. @see is_pressed **/
-constexpr uint16_t DEBOUNCE_RATE = 500;
-
-// Maximum number of notes in a song.
-// Note! Adjusting requires the editing of the song_size_t typedef in "song.h"
+// Maximum number of notes in a song. Each note takes 1 byte of SRAM.
+// Note! Must stay below 65535 (the largest song_size_t, see "song.h") and must fit the SRAM left over, see tools/sram_report.cpp
 #if PRGM_MODE == 0
-constexpr song_size_t MAX_SONG_LENGTH = 64;
+constexpr song_size_t MAX_SONG_LENGTH = 128;
 #elif PRGM_MODE == 2
-constexpr song_size_t MAX_SONG_LENGTH = 512;
+constexpr song_size_t MAX_SONG_LENGTH = 1024;
 #else
-constexpr song_size_t MAX_SONG_LENGTH = 255;
+constexpr song_size_t MAX_SONG_LENGTH = 510;
 #endif
 
 /** @brief Minimum allowed number of notes in a song for playback and saving */
 constexpr uint8_t MIN_SONG_LENGTH = 8;
 
+/**
+ * @brief The most tracks (notes played at the same time) a song can have. Each track is played by its own voice. @see voices.h
+ * In a song file the tracks are the pitches on the same line (ex. "  - C4 E4 G4").
+ */
+constexpr uint8_t SONG_MAX_TRACKS = 4;
+
+/**
+ * @brief The amount of bytes (notes of every track) in each of the two blocks that a SongStream keeps in SRAM while a song is played back.
+ * Songs which are played back are not limited by MAX_SONG_LENGTH. @see SongStream
+ */
+constexpr uint8_t SONG_STREAM_BLOCK_SIZE = 32;
+
+/** @brief The size of a sector on the SD card. Songs are saved one whole sector at a time. @see sd_save_song */
+constexpr uint16_t SD_SECTOR_SIZE = 512;
+
 /** @brief Maximum allowed number of songs on the SD card. */
 constexpr uint8_t MAX_SONG_AMOUNT = 255;
 
@@ -273,6 +284,23 @@ const note_t PAUSE_NOTE = { "PS", (const uint16_t)1 };
  */
 const note_t EMPTY_NOTE = { "0000", (const uint16_t)0 };
 
+/** @brief The amount of notes in PROGRAM_NOTES. A note index is (button index * TONES_PER_BUTTON) + tone index. */
+constexpr uint8_t PROGRAM_NOTE_AMOUNT = TONE_BUTTON_AMOUNT * TONES_PER_BUTTON;
+
+/** @brief The chromatic number (octave * 12 + semitone) of the first note in PROGRAM_NOTES (B0). Every note after it is one semitone higher. */
+constexpr uint8_t FIRST_NOTE_CHROMATIC = 11;
+
+/** @brief The reserved note index which represents the PAUSE_NOTE in a song. */
+constexpr uint8_t PAUSE_NOTE_INDEX = UINT8_MAX - 1;
+
+/** @brief The reserved note index which represents the EMPTY_NOTE (an empty space) in a song. */
+constexpr uint8_t EMPTY_NOTE_INDEX = UINT8_MAX;
+
+static_assert(PROGRAM_NOTE_AMOUNT < PAUSE_NOTE_INDEX, "Note indices must not overlap with the reserved PAUSE/EMPTY indices.");
+
+/** @brief The size of a buffer which can hold any pitch (including the null character). @see get_note_pitch */
+constexpr uint8_t PITCH_BUFFER_SIZE = sizeof(pitch_empty);
+
 ////////////////////////////////////
 //// PROGRAM METHODS & GLOBALS ////
 //////////////////////////////////
@@ -285,6 +313,16 @@ const PROGMEM char PROGRESS_LABEL[] = "PROGRESS:";
 const char FILE_TXT_EXTENSION[] = ".txt";
 /** @brief A string representing the README file (Non-PROGMEM). */
 const char README_FILE[] = "README.TXT";
+/** @brief A string representing the song index file (Non-PROGMEM). @see songIndexEntry_t */
+const char SONG_INDEX_FILE[] = "SONGS.IDX";
+/** @brief The directory which stores the compiled song cache files (Non-PROGMEM). @see songCacheHeader_t */
+const char SONG_CACHE_DIR[] = "CACHE";
+/** @brief A string representing the extension of compiled song cache files (Non-PROGMEM). */
+const char FILE_CACHE_EXTENSION[] = ".BIN";
+/** @brief A string representing the extension of the temporary file a song is written to while it is saved (Non-PROGMEM). */
+const char FILE_TMP_EXTENSION[] = ".TMP";
+/** @brief The file which stores the SPI clock chosen for the SD card so it is only probed once (Non-PROGMEM). @see sd_tune_spi_clock */
+const char SPI_CLOCK_FILE[] = "SPICLOCK.BIN";
 /** 
  * @brief A char array of all possible characters which can be used when naming a song.
  * @brief <b>Valid Characters are:</b>
@@ -303,15 +341,7 @@ const PROGMEM char OPTIONAL_NAMING_CHARACTERS[] = { 'A','B','C','D','E','F','G',
  * Editing TuneStudio2560 to accomidate smaller displays is possible by adjusting the LCD_COLS and LCD_ROWS but some changes to setCursor(x, x) methods would
  * need to be done.
  */
-extern LiquidCrystal_I2C lcd;
-
-/**
- * @brief Represents the 4-digit-wide 7-segment display used in TuneStudio2560.
- * @brief
- * The segment display is reponsible for showing the current note in Creator Mode. <br />
- * The display is wired using the SevSegShift library by being connected to <b>2x 74HC595N Shift Registers</b>.
- */
-extern SevSegShift segDisplay;
+extern LcdBuffer lcd;
 
 /**
  * @brief Represents the global song object to be used in the program when managing songs.
@@ -325,8 +355,14 @@ extern SevSegShift segDisplay;
  */
 extern Song<MAX_SONG_LENGTH> prgmSong;
 
-/** @brief The SPI_CLOCK as defined by the SdFat library. Set to 1MHz for maximum compatiblity (can go up to 20MHz for good modules and sd cards). */
-#define SPI_CLOCK SD_SCK_MHZ(1)
+/** @brief The SPI clock (in hz) the SD card is started at and falls back to. 1MHz works with every module and sd card. */
+#define SPI_CLOCK_HZ 1000000UL
+/** @brief The SPI_CLOCK as defined by the SdFat library. @see sd_tune_spi_clock */
+#define SPI_CLOCK SD_SCK_HZ(SPI_CLOCK_HZ)
+/** @brief The faster SPI clocks (in hz) tried when a card is first used, slowest first. The ATmega2560 can not go past F_CPU / 2. */
+constexpr uint32_t SPI_PROBE_CLOCKS[] = { F_CPU / 8, F_CPU / 4, F_CPU / 2 };
+/** @brief The amount of bytes at the start of the README which are read to check an SPI clock. */
+constexpr uint16_t SPI_PROBE_BYTES = 2048;
 
 // Try to select the best SD card configuration.
 #if HAS_SDIO_CLASS
@@ -344,21 +380,23 @@ bool is_interrupt();
 
 /**
  * @brief A custom (blocking) delay function which checks if an immediate interrupt is occuring.
- * Works the same as the normal arduino delay(ms) function just with a custom handler.
+ * Works the same as the normal arduino delay(ms) function just with a custom handler. The lcd buffer is flushed before waiting.
+ * The background tasks (see idle_tasks.h) are run while waiting when they fit before the delay ends.
  *
  * @param milliseconds The time to delay for.
  */
 void delay_ms(const unsigned long milliseconds);
 
 /**
- * @brief Handles any interrupts which could be generated by the add/select or del/cancel buttons.
- * Whether or not the immediateInterrupt variable should be toggled on depends on the current 
- * ProgramState and how it wants to handle interrupts.
+ * @brief Handles the events which the button scanner has queued. @see input.h
+ * In the menus the add/select and del/cancel buttons change the state and set the immediateInterrupt variable.
+ * Every other press is kept until the current ProgramState checks for it.
  */
-void isr_btn_handle();
+void handle_input();
 
 /**
- * @brief Forcefully update the current state.
+ * @brief Request a change of the current state. Safe to call from an interrupt.
+ * The change is applied at the top of the next loop() so the current state keeps running until its loop() returns.
  * This method call should be the last one during a states loop() iteration and no code should come after this function call.
  *
  * @param newState The new state to set the application to.
@@ -366,13 +404,29 @@ void isr_btn_handle();
 void update_state(StateID state);
 
 /**
- * @brief Checks for button presses & updates Debounce rate.
+ * @brief Checks if a button was pressed since the last time this was called for the button.
+ * Presses are kept until they are checked or the state changes.
  *
  * @param buttonPin The pin of the button to check for.
- * @return If the button is being pressed.
+ * @return If the button was pressed.
  */
 bool is_pressed(const uint8_t buttonPin);
 
+/**
+ * @brief Checks if a button was pressed while OPTION was held (OPTION+SELECT or OPTION+DEL) since the last time this was called for
+ * the button. A chord is not also a press of the button.
+ *
+ * @param buttonPin BTN_ADD_SELECT or BTN_DEL_CANCEL.
+ * @return If the button was pressed with OPTION.
+ */
+bool is_chord_pressed(const uint8_t buttonPin);
+
+/**
+ * @param buttonPin The pin of the button to check for.
+ * @return If the button has been held for longer than a long press and is still held.
+ */
+bool is_long_pressed(const uint8_t buttonPin);
+
 /**
  * @brief Prints text to the lcd and wraps text automatically.
  *
@@ -439,7 +493,7 @@ uint8_t get_selected_song();
  * Whatever tune button was pressed previously is not accounted for.
  * 
  * @remark This method does not deal with any tune buttons, rather it simply returns the current value as measured by the arduino.
- * @remark This method's speed increases drastically when PRGM_MODE==2 or fast analog read is enabled.
+ * @remark The value is read in the background and filtered so this never waits for the ADC. @see pot.h
  *
  * @return The current frequency read by the potentiometer. (0 and 1023)
  */
@@ -448,25 +502,97 @@ uint16_t get_current_freq();
 
 /**
  * @param toneButton The button which was pressed.
- * @return A note struct from the toneButton that was pressed. Finds the note by copying information from PROGMEM.
+ * @return The index of the note (in PROGRAM_NOTES) from the toneButton that was pressed or EMPTY_NOTE_INDEX for an unknown button.
+ */
+uint8_t get_current_tone(uint8_t toneButton);
+
+/**
+ * @brief Retrieve the frequency of a note by copying it from PROGMEM.
+ *
+ * @param note The index of the note.
+ * @return The frequency of the note. PAUSE_NOTE and EMPTY_NOTE frequencies for the reserved indices.
+ */
+uint16_t get_note_frequency(const uint8_t note);
+
+/**
+ * @brief Retrieve the PROGMEM pointer to the human readable pitch of a note.
+ * @remark Nothing is copied so the pitch can be printed with (const __FlashStringHelper*) or measured with strlen_P.
+ *
+ * @param note The index of the note.
+ * @return The pitch of the note in PROGMEM. pitch_pause and pitch_empty for the reserved indices.
  */
-note_t get_current_tone(uint8_t toneButton);
+PGM_P get_note_pitch_P(const uint8_t note);
 
 /**
- * @brief Retrieve a note object that matches a specified frequency.
+ * @brief Copy the human readable pitch of a note into a buffer.
+ * @remark Replaces pgm_pcpyr. Every caller provides its own buffer so the pitch is not overwritten by other calls.
  *
- * @param frequency The frequency to search for.
- * @return The note which has the frequency.
+ * @param note The index of the note.
+ * @param buffer A buffer of at least PITCH_BUFFER_SIZE characters.
+ * @return The buffer which the pitch was copied to.
  */
-note_t get_note_from_freq(const uint16_t frequency);
+char* get_note_pitch(const uint8_t note, char* const buffer);
 
 /**
- * @brief Retrieve a note object from a specified pitch.
+ * @brief Retrieve a note index from a specified pitch.
+ * @brief
+ * Every pitch in PROGRAM_NOTES is one semitone above the previous one (B0 to B7) so the index of a pitch is computed
+ * directly from its letter, sharp and octave (a minimal perfect hash). No PROGMEM strings are compared.
  *
  * @param pitch The pitch string to search for.
- * @return The note which matches the frequency.
+ * @return The index of the note which matches the pitch. PAUSE_NOTE_INDEX for a pause and EMPTY_NOTE_INDEX if nothing matched.
+ */
+uint8_t get_note_from_pitch(const char* const pitch);
+
+/**
+ * @brief Represents a single song in the song index file. <i>(Used as songIndexEntry_t)</i>
+ * @brief
+ * The song index file (SONG_INDEX_FILE) stores one entry for every valid song on the SD card ordered the same way as the
+ * songs are in the root directory. The n-th song is found by seeking to n * sizeof(songIndexEntry_t) instead of walking
+ * through the directory.
+ *
+ * @see sd_get_file
  */
-note_t get_note_from_pitch(const char* const pitch);
+typedef struct songIndexEntry {
+  /** @brief The position of the song's entry in the root directory. */
+  uint16_t dirIndex;
+  /** @brief The 8.3 name of the song (includes the file extension). */
+  char name[14];
+} songIndexEntry_t;
+
+/** @brief Identifies a song cache file. Changed whenever the layout of songCacheHeader_t changes so old caches are rebuilt. */
+constexpr uint16_t SONG_CACHE_VERSION = 0x5303;
+
+/**
+ * @brief Represents the start of a compiled song cache file. <i>(Used as songCacheHeader_t)</i>
+ * @brief
+ * The first time a song (.txt) is loaded it is compiled into a cache file (SONG_CACHE_DIR/NAME.BIN) which stores this header
+ * followed by the note indices of the song (every track of the first note, then every track of the second note and so on). Songs
+ * are played back by streaming the notes out of the cache instead of parsing the text. The cache is rebuilt when the size or the
+ * modification time of the text file changes.
+ *
+ * @see sd_song_open
+ */
+typedef struct songCacheHeader {
+  /** @brief The size of the text file which the cache was compiled from. */
+  uint32_t sourceSize;
+  /** @brief Always SONG_CACHE_VERSION. */
+  uint16_t version;
+  /** @brief The modification date (FAT format) of the text file which the cache was compiled from. */
+  uint16_t sourceDate;
+  /** @brief The modification time (FAT format) of the text file which the cache was compiled from. */
+  uint16_t sourceTime;
+  /** @brief The delay between each note of the song. */
+  uint16_t noteDelay;
+  /** @brief The amount of notes (lines) which come after the header. Each note has trackCount bytes. */
+  uint16_t noteCount;
+  /** @brief The length that each note of the song is played for. */
+  uint8_t noteLength;
+  /** @brief The amount of tracks of the song (1 to SONG_MAX_TRACKS). */
+  uint8_t trackCount;
+  /** @brief CRC-CCITT of the notes followed by the header (with the crc set to zero). */
+  uint16_t crc;
+} songCacheHeader_t;
 
 /**
  * @brief Saves a song class to the SD card by using the SD.h library and writing all of
@@ -474,6 +600,8 @@ note_t get_note_from_pitch(const char* const pitch);
  * be longer then 8 characters and should include a .TXT extension.
  * 
  * @since v1.3.0-5: Now directly references global song object, no longer takes an object in.
+ * @remark The song is written to a temporary file in whole sectors and then renamed over the old song. If the power is cut
+ * during a save then the previous version of the song is kept (or the save is finished when the program starts).
  *
  * @param fileName The name to save the song as. Must be between 1 and 8 characters, A-Z, 0-9 and underscores only.
  * @param song The song instance to save.
@@ -482,25 +610,97 @@ void sd_save_song(const char * const fileName);
 
 /**
  * @brief Gets a file name from the SD card in descending order according to a specified index. For example index "0" would be the file at the top of the SD card.
+ * @remark Reads a single entry of the song index instead of walking through the root directory.
  *
  * @param index The index of the file to get.
- * @return The name of the file (includes the file extension)
+ * @return The name of the file (includes the file extension) or an empty string if there is no song at the index.
  */
 const char* sd_get_file(uint8_t index);
 
 /**
- * @brief Copies and parses song data from a .txt file onto the global song object.
- * The file must be in the correct format to work properly.
- * @since v1.3.0-R5: Function no longer takes in a parameter for a reference to a song "&song". Instead it directly references the global song variable.
+ * @return The amount of songs in the song index. @see sd_get_file
+ */
+uint8_t sd_get_song_count();
+
+/**
+ * @brief Checks the song index file against the root directory by walking through it once.
+ * @remark Called once when the program starts so songs which were added or removed on a computer are picked up. The index
+ * is only written from the first song which no longer matches it, so the SD card is not written to when nothing changed.
+ * A save which was interrupted by a power loss is also recovered.
+ */
+void sd_index_build();
+
+/** @brief The progress of a song which is being opened. @see sd_song_open_start */
+enum SongOpenStatus: uint8_t {
+  /** @brief The song is not valid or its cache could not be opened. */
+  SONG_OPEN_FAILED,
+  /** @brief The song needs more steps to be verified or compiled. */
+  SONG_OPEN_BUSY,
+  /** @brief The cache of the song is open and positioned at the first note. */
+  SONG_OPEN_DONE
+};
+
+/** @brief The most bytes of a song that sd_song_open_step reads. Only every few steps has to wait for a new sector. */
+constexpr uint8_t SONG_OPEN_STEP_SIZE = 64;
+
+/**
+ * @brief Start opening a song one step at a time so a long song can be verified or compiled in between other work.
+ * @remark Only one song is opened at a time. Starting another one stops the song which is being opened (its steps fail).
+ *
+ * @param fileName The path in the SD card.
+ * @param cache The file to open the cache with. Must stay valid until the song is opened or sd_song_open_cancel is called.
+ * @param header The header of the cache is copied into this. Only valid once the song has been opened.
+ * @return SONG_OPEN_FAILED if the song does not exist, otherwise SONG_OPEN_BUSY. @see sd_song_open_step
+ */
+SongOpenStatus sd_song_open_start(const char * const fileName, File & cache, songCacheHeader_t & header);
+
+/**
+ * @brief Verify or compile the next SONG_OPEN_STEP_SIZE bytes of the song which is being opened.
+ *
+ * @param cache The cache file the song was started with.
+ * @return SONG_OPEN_BUSY while there is more to do.
+ */
+SongOpenStatus sd_song_open_step(File & cache);
+
+/**
+ * @brief Verify or compile the rest of the song which is being opened without stopping.
+ *
+ * @param cache The cache file the song was started with.
+ * @return SONG_OPEN_DONE or SONG_OPEN_FAILED.
+ */
+SongOpenStatus sd_song_open_finish(File & cache);
+
+/**
+ * @brief Stop opening a song. A cache which was only partly compiled is deleted.
+ *
+ * @param cache The cache file the song was started with. Nothing happens if it is not the song which is being opened.
+ */
+void sd_song_open_cancel(File & cache);
+
+/**
+ * @brief Opens the compiled cache of a song so its notes can be streamed from the SD card.
+ * The text file must be in the correct format to work properly.
+ * @remark The cache is reused when it is up to date. Otherwise the text is parsed and compiled straight into a new cache.
+ * Neither of these keep the song in memory so there is no limit on the length of the song other than song_size_t. Same as
+ * sd_song_open_start followed by sd_song_open_finish.
  *
  * @param fileName The path in the SD card.
+ * @param cache The file to open the cache with. It is left positioned at the first note (after the header).
+ * @param header The header of the cache is copied into this.
+ *
+ * @return If the song was valid and its cache could be opened.
+ */
+bool sd_song_open(const char * const fileName, File & cache, songCacheHeader_t & header);
+
+/**
+ * @brief Delete the compiled cache of a song so it is compiled again the next time it is opened.
  *
- * @return If the song was able to be successfully copied.
+ * @param fileName The name of the song (.txt) on the SD card.
  */
-bool sd_songcpy(const char * const fileName);
+void sd_cache_remove(const char * const fileName);
 
 /**
- * @brief Delete a file from the microSD.
+ * @brief Delete a file from the microSD. The compiled cache of a song is deleted with it.
  *
  * @param fileName The file to delete.
  */
@@ -512,23 +712,14 @@ void sd_rem(const char* const fileName);
  */
 void sd_make_readme();
 
-
 /**
- * @brief Copies the string data from a index on PROGRAM_NOTES PROGMEM and then
- * returns the string data for that pointer.
- * 
- * @brief After the pointer is retrieved from PROGMEM the value is stored in a private static buffer array which can be used
- * by other methods.
- * <br />
- * Ex: pgm_pcpyr(0, 0) -> "B0"
- * 
- * @since v1.2.0-R3
- * 
- * @param btnIndex The button to get in the PROGRAM_NOTES array.
- * @param noteIndex The note to get for that button.
- * @return The data which was copied from the pointer.
+ * @brief Moves the SD card to the fastest SPI clock it can read correctly. The card must already be started at SPI_CLOCK and
+ * have a README.
+ * @remark Each of SPI_PROBE_CLOCKS is tried (slowest first) by starting the card at it and reading the start of the README. The
+ * fastest clock which reads the same bytes as SPI_CLOCK is kept and saved to SPI_CLOCK_FILE. On the next start only the saved
+ * clock is checked and the card is probed again if it fails.
  */
-const char* pgm_pcpyr(uint8_t btnIndex, uint8_t noteIndex);
+void sd_tune_spi_clock();
 
 #if DEBUG == true
 /**
@@ -0,0 +1,50 @@
+/**
+ * @file voices.h
+ * @author Jacob LuVisi
+ * @brief Plays up to VOICE_COUNT square waves at the same time, one on each speaker pin, so a song can have more than one track.
+ *
+ * Voice 0 is NewTone on Timer1 (SPEAKER_1) so songs with one track sound exactly the same as before. Voices 1 to 3 use the spare
+ * 16-bit Timers 3, 4 and 5 in CTC mode (the timer counts up to OCRnA and starts over) and toggle SPEAKER_2 to SPEAKER_4 from their
+ * compare A interrupts. The output compare pins of those timers are taken by the shift register and the buttons so the pins are
+ * toggled in software. Each interrupt is a single XOR of the port register (a few cycles) and is only enabled while its voice
+ * plays. A voice interrupts twice per period of its note, so 4 voices at 4kHz are 32000 interrupts a second on top of the ADC and
+ * Timer0. test/simavr/run_cycle_bench.sh counts every one of those interrupts and prints the worst case share of the CPU they
+ * take, failing if less than half is left for loop().
+ *
+ * The speaker pins are mixed with a 1k resistor each into the speaker (or each go to their own speaker).
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef voices_h
+#define voices_h
+
+#include <studio-libs/tune_studio.h>
+
+/** @brief The amount of notes which can play at the same time (one for every track of a song). */
+constexpr uint8_t VOICE_COUNT = SONG_MAX_TRACKS;
+
+/**
+ * @brief Set the speaker pins of voices 1 to 3 to output LOW. Called once from setup().
+ */
+void voice_begin();
+
+/**
+ * @brief Start a note on the lowest voice which is not playing. May be called from an interrupt.
+ *
+ * @param frequency The frequency of the note (31hz or more).
+ * @return The voice which plays the note or VOICE_COUNT if every voice is playing (or the frequency is 0).
+ */
+uint8_t voice_start(uint16_t frequency);
+
+/**
+ * @brief Stop a voice and leave its speaker pin LOW. May be called from an interrupt.
+ *
+ * @param voice The voice returned by voice_start.
+ */
+void voice_stop(uint8_t voice);
+
+#endif
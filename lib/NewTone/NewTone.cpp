@@ -46,6 +46,6 @@ void noNewTone(uint8_t pin) {
 }
 
 ISR(TIMER1_COMPA_vect) { // Timer interrupt vector.
-  if (millis() >= _nt_time) noNewTone(); // Check to see if it's time for the note to end.
+  if (_nt_time != 0xFFFFFFFF && millis() >= _nt_time) noNewTone(); // Check to see if it's time for the note to end (skipped when playing "forever").
   *_pinOutput ^= _pinMask; // Toggle the pin state.
 }
\ No newline at end of file
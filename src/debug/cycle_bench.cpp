@@ -0,0 +1,321 @@
+/**
+ * @file cycle_bench.cpp
+ * @author Jacob LuVisi
+ * @brief The benchmarks which are counted by the simavr emulator. @see cycle_bench.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <debug/cycle_bench.h>
+
+#if CYCLE_BENCH == true
+
+#include <studio-libs/states/states.h>
+#include <studio-libs/song_stream.h>
+#include <studio-libs/sequencer.h>
+#include <studio-libs/input.h>
+#include <studio-libs/pot.h>
+#include <debug/stack_watch.h>
+#include <avr/sleep.h>
+
+// The interrupts are called like functions. They end with reti so interrupts are enabled again after each call.
+extern "C" void TIMER0_OVF_vect(void);
+extern "C" void TIMER0_COMPA_vect(void);
+extern "C" void TIMER0_COMPB_vect(void);
+extern "C" void TIMER1_COMPA_vect(void);
+extern "C" void TIMER2_OVF_vect(void);
+extern "C" void TIMER3_COMPA_vect(void);
+extern "C" void TIMER4_COMPA_vect(void);
+extern "C" void TIMER5_COMPA_vect(void);
+extern "C" void ADC_vect(void);
+
+/** @brief Keeps the results of the timed calls so the compiler can not remove them. */
+static volatile uint8_t cycleBenchSink;
+
+/**
+ * @brief Start timing a run. The barrier stops the compiler from moving work from before the mark into the run.
+ */
+static inline void cycle_bench_start() {
+  asm volatile("" ::: "memory");
+  GPIOR0 = CYCLE_BENCH_START;
+  asm volatile("" ::: "memory");
+}
+
+/**
+ * @brief Stop timing a run.
+ */
+static inline void cycle_bench_stop() {
+  asm volatile("" ::: "memory");
+  GPIOR0 = CYCLE_BENCH_STOP;
+  asm volatile("" ::: "memory");
+}
+
+/**
+ * @brief Send the name of the benchmark which the next runs belong to.
+ */
+static void cycle_bench_name(const char * name) {
+  while (*name != '\0') {
+    GPIOR2 = *name++;
+  }
+  GPIOR2 = '\0';
+}
+
+/**
+ * @brief Press every button by driving its pin LOW or release it by letting its pull up bring it back HIGH. A pressed button also
+ * reads LOW so this is safe with the real buttons.
+ */
+static void cycle_bench_set_buttons(bool pressed) {
+  static const uint8_t pins[] = { BTN_TONE_1, BTN_TONE_2, BTN_TONE_3, BTN_TONE_4, BTN_TONE_5, BTN_ADD_SELECT, BTN_DEL_CANCEL,
+    BTN_OPTION };
+  for (uint8_t pin : pins) {
+    if (pressed) {
+      pinMode(pin, OUTPUT);
+      digitalWrite(pin, LOW);
+    } else {
+      pinMode(pin, INPUT_PULLUP);
+    }
+  }
+}
+
+/**
+ * @brief Run loop() until a state which was requested with update_state has initalized.
+ */
+static void cycle_bench_enter(StateID state) {
+  update_state(state);
+  // The first loop() changes the state and runs init(). The second one is the first normal loop of the state.
+  loop();
+  loop();
+}
+
+int main() {
+  // Set up the Arduino core (Timer0, the ADC prescaler and the PWM timers) like its own main() would.
+  init();
+  setup();
+
+  cycle_bench_name("empty");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cycle_bench_start();
+    cycle_bench_stop();
+  }
+
+  cycle_bench_name("get_current_tone");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cycle_bench_start();
+    cycleBenchSink = get_current_tone(BTN_TONE_3);
+    cycle_bench_stop();
+  }
+
+  // The first song on the SD card image. Compiling it replaces sd_songcpy (songs are no longer copied into prgmSong).
+  char name[14];
+  strcpy(name, sd_get_file(0));
+
+  cycle_bench_name("sd_song_open_compile");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    sd_cache_remove(name);
+    File cache;
+    songCacheHeader_t header;
+    STACK_WATCH_BEGIN(STACK_OP_OPEN);
+    cycle_bench_start();
+    cycleBenchSink = sd_song_open(name, cache, header);
+    cycle_bench_stop();
+    STACK_WATCH_END(STACK_OP_OPEN);
+    cache.close();
+  }
+
+  cycle_bench_name("sd_song_open_cached");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    File cache;
+    songCacheHeader_t header;
+    cycle_bench_start();
+    cycleBenchSink = sd_song_open(name, cache, header);
+    cycle_bench_stop();
+    cache.close();
+  }
+
+  // Every SONG_STREAM_BLOCK_SIZE steps a block is read from the SD card so the most cycles are a block read.
+  cycle_bench_name("song_stream_get_step");
+  {
+    SongStream stream;
+    uint8_t step[SONG_MAX_TRACKS];
+    if (stream.open(name)) {
+      for (song_size_t i = 0; i < stream.get_size() && i < 4 * SONG_STREAM_BLOCK_SIZE; i++) {
+        cycle_bench_start();
+        stream.get_step(i, step);
+        cycle_bench_stop();
+        cycleBenchSink = step[0];
+      }
+    }
+  }
+
+  cycle_bench_name("TIMER1_COMPA_vect");
+  NewTone(SPEAKER_1, 440);
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    cycle_bench_start();
+    TIMER1_COMPA_vect();
+    cycle_bench_stop();
+  }
+  noNewTone(SPEAKER_1);
+
+  // The voices toggle their speaker pin on every compare match. Every pin is toggled an even amount of times so it ends up LOW.
+  static_assert(CYCLE_BENCH_RUNS % 2 == 0, "The last runs of the voice interrupts must leave their pins LOW.");
+  cycle_bench_name("TIMER3_COMPA_vect");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    cycle_bench_start();
+    TIMER3_COMPA_vect();
+    cycle_bench_stop();
+  }
+
+  cycle_bench_name("TIMER4_COMPA_vect");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    cycle_bench_start();
+    TIMER4_COMPA_vect();
+    cycle_bench_stop();
+  }
+
+  cycle_bench_name("TIMER5_COMPA_vect");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    cycle_bench_start();
+    TIMER5_COMPA_vect();
+    cycle_bench_stop();
+  }
+
+  // Timer0 also keeps millis() (the Arduino core) and refreshes the 7-segment display.
+  cycle_bench_name("TIMER0_OVF_vect");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    cycle_bench_start();
+    TIMER0_OVF_vect();
+    cycle_bench_stop();
+  }
+
+  cycle_bench_name("TIMER0_COMPA_vect");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    cycle_bench_start();
+    TIMER0_COMPA_vect();
+    cycle_bench_stop();
+  }
+
+  // Every POT_OVERSAMPLE runs one of them finishes an average (the most work the interrupt does) so the most cycles are that run.
+  // The real interrupt is turned off so it does not take the conversions.
+  cycle_bench_name("ADC_vect");
+  ADCSRA &= ~_BV(ADIE);
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS * POT_OVERSAMPLE; run++) {
+    cli();
+    cycle_bench_start();
+    ADC_vect();
+    cycle_bench_stop();
+  }
+  ADCSRA |= _BV(ADIE);
+
+  // Every timed scan is the one where every button has finished debouncing, so it sends an event for each of them (the most work a
+  // scan does). The runs press and release the buttons in turn. The real interrupt is turned off so it does not take the scans.
+  static_assert(CYCLE_BENCH_RUNS % 2 == 0, "The last run of TIMER2_OVF_vect must release the buttons.");
+  cycle_bench_name("TIMER2_OVF_vect");
+  TIMSK2 &= ~_BV(TOIE2);
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cycle_bench_set_buttons(run % 2 == 0);
+    for (uint8_t scan = 1; scan < INPUT_DEBOUNCE_TICKS; scan++) {
+      cli();
+      TIMER2_OVF_vect();
+    }
+    cli();
+    cycle_bench_start();
+    TIMER2_OVF_vect();
+    cycle_bench_stop();
+    inputEvent_t event;
+    while (input_pop(event)) {
+    }
+  }
+  TIMSK2 |= _BV(TOIE2);
+
+  cycle_bench_enter(CM_CREATE_NEW);
+  cycle_bench_name("CreatorModeCreateNew::loop");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cycle_bench_start();
+    loop();
+    cycle_bench_stop();
+  }
+
+  set_selected_page(1);
+  set_selected_song(1);
+  cycle_bench_enter(LM_PLAYING_SONG);
+  cycle_bench_name("ListeningModePlayingSong::loop");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cycle_bench_start();
+    loop();
+    cycle_bench_stop();
+  }
+
+  // Every run is set up so the step is due: a step with a note on every track is fed to an empty sequencer and started, then
+  // stopped. A note length of 0 makes the notes due to stop as soon as they start. The real interrupt is turned off so it does
+  // not play the step first.
+  uint8_t step[SONG_MAX_TRACKS];
+  for (uint8_t track = 0; track < SONG_MAX_TRACKS; track++) {
+    step[track] = track * 4;
+  }
+  TIMSK0 &= ~_BV(OCIE0B);
+  sequencer_pause(false);
+  sequencer_set_timing(DEFAULT_NOTE_DELAY, 0);
+
+  cycle_bench_name("TIMER0_COMPB_vect_note_on");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    sequencer_clear();
+    sequencer_feed(step, SONG_MAX_TRACKS);
+    cycle_bench_start();
+    TIMER0_COMPB_vect();
+    cycle_bench_stop();
+  }
+
+  cycle_bench_name("TIMER0_COMPB_vect_note_off");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    cli();
+    sequencer_clear();
+    sequencer_feed(step, SONG_MAX_TRACKS);
+    TIMER0_COMPB_vect();
+    cli();
+    cycle_bench_start();
+    TIMER0_COMPB_vect();
+    cycle_bench_stop();
+  }
+  sequencer_clear();
+  TIMSK0 |= _BV(OCIE0B);
+
+  // A full prgmSong is saved (the longest file the creator writes). Runs last because the saved song joins the song list.
+  for (song_size_t i = 0; !prgmSong.is_song_full(); i++) {
+    prgmSong.add_note(i % PROGRAM_NOTE_AMOUNT);
+  }
+  cycle_bench_name("sd_save_song");
+  for (uint8_t run = 0; run < CYCLE_BENCH_RUNS; run++) {
+    STACK_WATCH_BEGIN(STACK_OP_SAVE);
+    cycle_bench_start();
+    sd_save_song("BENCH.TXT");
+    cycle_bench_stop();
+    STACK_WATCH_END(STACK_OP_SAVE);
+  }
+  prgmSong.clear();
+
+  #if PERF_METRICS == true
+  // The simavr_stack environment checks the stack painter and the scan with this report. @see run_cycle_bench.sh
+  stack_watch_report();
+  Serial.flush();
+  #endif
+
+  GPIOR0 = CYCLE_BENCH_DONE;
+  // Sleeping with interrupts off also stops simavr if the runner missed the mark.
+  cli();
+  sleep_enable();
+  while (true) {
+    sleep_cpu();
+  }
+}
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file stack_watch.cpp
+ * @author Jacob LuVisi
+ * @brief The stack high-water marks of every state and operation. @see stack_watch.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <debug/stack_watch.h>
+
+#if PERF_METRICS == true
+
+/** @brief The deepest stack (bytes below RAMEND) measured in every state. 0 if the state has not run. */
+static uint16_t stateDepth[STACK_STATE_COUNT];
+/** @brief The deepest stack measured during any run of every operation. 0 if the operation has not run. */
+static uint16_t opDepth[STACK_OP_COUNT];
+/** @brief The deepest stack measured during the current run of every operation which is running. */
+static uint16_t opRunDepth[STACK_OP_COUNT];
+/** @brief The operations which are running (bit n is StackOperation n). */
+static uint8_t activeOps = 0;
+/** @brief The state the stack is currently measured for. The program starts in the main menu. */
+static StateID watchedState = MAIN_MENU;
+
+/** @brief The names of the operations in the report. */
+static const char STACK_OP_NAMES[STACK_OP_COUNT][9] PROGMEM = { "open", "playback", "save" };
+
+#ifndef TUNESTUDIO_NATIVE
+
+/** @brief The end of .bss (set by the linker). The heap would start here but TuneStudio2560 never uses it. */
+extern uint8_t __heap_start;
+/** @brief The end of the heap if anything was allocated (set by malloc). */
+extern char * __brkval;
+
+/**
+ * @brief Paint every byte from the end of the static SRAM to the top of the stack with STACK_CANARY. Runs from .init1, before
+ * the zero register and the stack pointer are set up, so it is written in assembly and uses no stack.
+ */
+extern "C" void stack_watch_paint() __attribute__((naked, used, section(".init1")));
+extern "C" void stack_watch_paint() {
+  asm volatile(
+    "  ldi r30, lo8(__heap_start)\n"
+    "  ldi r31, hi8(__heap_start)\n"
+    "  ldi r24, %[canary]\n"
+    "  ldi r25, hi8(__stack)\n"
+    "  rjmp 2f\n"
+    "1:\n"
+    "  st Z+, r24\n"
+    "2:\n"
+    "  cpi r30, lo8(__stack)\n"
+    "  cpc r31, r25\n"
+    "  brlo 1b\n"
+    "  breq 1b\n"
+    :: [canary] "M" (STACK_CANARY)
+  );
+}
+
+#endif
+
+/**
+ * @brief Find how deep the stack has been since the last collect, paint that part again and keep the depth for the watched state
+ * and every running operation.
+ */
+static void stack_watch_collect() {
+  #ifndef TUNESTUDIO_NATIVE
+  uint8_t * lowest = __brkval ? (uint8_t *) __brkval : &__heap_start;
+  // Interrupts are left on while searching. An interrupt which goes deeper than the search already looked is counted next time.
+  while (lowest < (uint8_t *) SP && *lowest == STACK_CANARY) {
+    lowest++;
+  }
+  const uint8_t sreg = SREG;
+  cli();
+  // Nothing is below the stack pointer while interrupts are off so the part the stack reached can be painted again.
+  for (uint8_t * address = lowest; address <= (uint8_t *) SP; address++) {
+    *address = STACK_CANARY;
+  }
+  SREG = sreg;
+  const uint16_t depth = RAMEND - (uint16_t) lowest;
+  #else
+  // The simulated firmware runs on the stack of the computer.
+  const uint16_t depth = 0;
+  #endif
+
+  if (depth > stateDepth[watchedState]) {
+    stateDepth[watchedState] = depth;
+  }
+  for (uint8_t op = 0; op < STACK_OP_COUNT; op++) {
+    if ((activeOps & (1 << op)) && depth > opRunDepth[op]) {
+      opRunDepth[op] = depth;
+    }
+  }
+}
+
+void stack_watch_state(StateID state) {
+  stack_watch_collect();
+  watchedState = state;
+}
+
+void stack_watch_begin(StackOperation op) {
+  stack_watch_collect();
+  activeOps |= 1 << op;
+  opRunDepth[op] = 0;
+}
+
+void stack_watch_end(StackOperation op) {
+  stack_watch_collect();
+  activeOps &= ~(1 << op);
+  if (opRunDepth[op] > opDepth[op]) {
+    opDepth[op] = opRunDepth[op];
+  }
+}
+
+/**
+ * @brief Print the end of a line of the report: where the stack reached and how much SRAM was left.
+ *
+ * @param depth The deepest stack which was measured.
+ * @param staticEnd The first address after the static SRAM.
+ */
+static void stack_watch_print(uint16_t depth, uint16_t staticEnd) {
+  Serial.print(F(" lowest=0x"));
+  Serial.print(RAMEND - depth, HEX);
+  Serial.print(F(" used="));
+  Serial.print(depth);
+  Serial.print(F(" free="));
+  Serial.println(RAMEND - depth - staticEnd);
+}
+
+void stack_watch_report() {
+  // The current state is measured up to this point.
+  stack_watch_collect();
+  #ifndef TUNESTUDIO_NATIVE
+  const uint16_t staticEnd = (uint16_t) &__heap_start;
+  Serial.print(F("STACK static="));
+  Serial.print(staticEnd - RAMSTART);
+  Serial.print(F(" sram="));
+  Serial.println(RAMEND + 1 - RAMSTART);
+  #else
+  const uint16_t staticEnd = 0;
+  Serial.println(F("STACK not measured in the simulator"));
+  #endif
+
+  // States and operations which have not run are left out.
+  for (uint8_t state = 0; state < STACK_STATE_COUNT; state++) {
+    if (stateDepth[state] != 0) {
+      Serial.print(F("STACK state "));
+      Serial.print(state);
+      stack_watch_print(stateDepth[state], staticEnd);
+    }
+  }
+  for (uint8_t op = 0; op < STACK_OP_COUNT; op++) {
+    if (opDepth[op] != 0) {
+      Serial.print(F("STACK op "));
+      Serial.print((const __FlashStringHelper *) STACK_OP_NAMES[op]);
+      stack_watch_print(opDepth[op], staticEnd);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file trace.cpp
+ * @author Jacob LuVisi
+ * @brief The ring buffer of binary performance events. @see trace.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <debug/trace.h>
+#include <debug/stack_watch.h>
+
+#if PERF_METRICS == true
+
+/** @brief The records of the trace. */
+static volatile traceRecord_t traceBuffer[TRACE_BUFFER_SIZE];
+/** @brief The total amount of records which have been added since the last dump. */
+static volatile uint32_t traceWritten = 0;
+/** @brief Stops events from being recorded while the buffer is being sent. */
+static volatile bool traceDumping = false;
+
+/**
+ * @brief Write a little endian value to serial.
+ */
+static void trace_write(uint32_t value, uint8_t bytes) {
+  for (uint8_t i = 0; i < bytes; i++) {
+    Serial.write((uint8_t) (value >> (i * 8)));
+  }
+}
+
+void trace_begin() {
+  Serial.begin(9600);
+}
+
+void trace_record(TraceEvent event, uint16_t data) {
+  const uint8_t sreg = SREG;
+  cli();
+  if (!traceDumping) {
+    volatile traceRecord_t & record = traceBuffer[traceWritten & (TRACE_BUFFER_SIZE - 1)];
+    record.time = micros();
+    record.event = event;
+    record.data = data;
+    traceWritten++;
+  }
+  SREG = sreg;
+}
+
+void trace_poll() {
+  if (!Serial.available()) {
+    return;
+  }
+  switch (Serial.read()) {
+  case TRACE_DUMP_COMMAND:
+    trace_dump();
+    return;
+  case STACK_REPORT_COMMAND:
+    stack_watch_report();
+    return;
+  }
+}
+
+void trace_dump() {
+  traceDumping = true;
+  // Nothing else writes to the buffer until the dump is finished so it can be sent without turning interrupts off.
+  const uint32_t written = traceWritten;
+  const uint16_t count = written < TRACE_BUFFER_SIZE ? written : TRACE_BUFFER_SIZE;
+  const uint32_t overwritten = written - count;
+
+  Serial.write(TRACE_MAGIC, sizeof(TRACE_MAGIC) - 1);
+  trace_write(TRACE_VERSION, 1);
+  trace_write(sizeof(traceRecord_t), 1);
+  trace_write(count, 2);
+  trace_write(overwritten < UINT16_MAX ? overwritten : UINT16_MAX, 2);
+  for (uint32_t i = overwritten; i != written; i++) {
+    const volatile traceRecord_t & record = traceBuffer[i & (TRACE_BUFFER_SIZE - 1)];
+    trace_write(record.time, 4);
+    trace_write(record.event, 1);
+    trace_write(record.data, 2);
+  }
+  Serial.flush();
+
+  traceWritten = 0;
+  traceDumping = false;
+}
+
+#endif
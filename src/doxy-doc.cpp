@@ -14,8 +14,6 @@
  *   - Interacts with the 20x4 I2C-protocol Liquid Crystal display.
  * - SdFat (https://github.com/greiman/SdFat)
  *   - Interacts with a FAT16/FAT32 microSD card.
- * - SevSegShift (https://github.com/bridystone/SevSegShift?utm_source=platformio&utm_medium=piohome)
- *   - Uses 2x 74HC595N shift registers to control a 4 digit wide 7-segment display.
  * @section notes Notes
  * - Comments are Doxygen compatible.
  * - The information for every method is located in the header file.
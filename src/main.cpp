@@ -37,8 +37,16 @@
 
 #include <studio-libs/tune_studio.h>
 #include <studio-libs/states/states.h>
+#include <studio-libs/pot.h>
+#include <studio-libs/input.h>
+#include <studio-libs/voices.h>
+#include <studio-libs/idle_tasks.h>
 #include <SPI.h>
 #include <SdFat.h>
+#include <util/crc16.h>
+#include <new>
+#include <debug/trace.h>
+#include <debug/stack_watch.h>
 
 #if PERF_METRICS == true
 #include <debug/debug.h>
@@ -53,8 +61,12 @@ to the main loop() function as fast as possible.
 The delay_ms(ms) function in this program also makes use of this variable.
 */
 static volatile bool immediateInterrupt = false;
-/** @brief The last time a button was pressed that the main class registered through is_pressed. */
-static volatile unsigned long lastButtonPress = 0;
+/** @brief The buttons (bit n is InputButton n) which were pressed and have not been checked by is_pressed yet. */
+static uint8_t pressedButtons = 0;
+/** @brief The buttons which were pressed with OPTION held and have not been checked by is_chord_pressed yet. */
+static uint8_t chordButtons = 0;
+/** @brief The buttons which have been held long enough for a long press and are still held. */
+static uint8_t longPressedButtons = 0;
 /** @brief The current index of the selected. */
 static volatile uint8_t selectedSong = 1;
 /** @brief The current selected page of the program. @remark Each page contains 5 different songs on the SD card. */
@@ -68,16 +80,10 @@ static volatile uint8_t selectedPage = 1;
  * <br />
  * Editing TuneStudio2560 to accomidate smaller displays is possible by adjusting the LCD_COLS and LCD_ROWS but some changes to setCursor(x, x) methods would
  * need to be done.
+ * <br />
+ * Everything is drawn into a shadow buffer first and only the changed cells are sent when the buffer is flushed. @see lcd_buffer.h
  */
-LiquidCrystal_I2C lcd(0x27, LCD_COLS, LCD_ROWS);
-
-/**
- * @brief Represents the 4-digit-wide 7-segment display used in TuneStudio2560.
- * @brief
- * The segment display is reponsible for showing the current note in Creator Mode. <br />
- * The display is wired using the SevSegShift library by being connected to <b>2x 74HC595N Shift Registers</b>.
- */
-SevSegShift segDisplay(SHIFT_PIN_DS, SHIFT_PIN_SHCP, SHIFT_PIN_STCP);
+LcdBuffer lcd(0x27);
 
 /**
  * @brief Represents the global song object to be used in the program when managing songs.
@@ -97,22 +103,27 @@ Song<MAX_SONG_LENGTH> prgmSong(SPEAKER_1, DEFAULT_NOTE_LENGTH, DEFAULT_NOTE_DELA
  */
 static SdFat SD;
 
+/**
+ * @brief The song index file on the SD card. Kept open for the entire program so looking up a song is a single seek and read.
+ * @see sd_get_file
+ */
+static File songIndex;
+
+/** @brief The amount of songs in the song index. */
+static uint8_t songCount = 0;
+
 //////////////////////////////
 //// INTERRUPTS & DELAYS ////
 ////////////////////////////
 
 bool is_interrupt() {
+  handle_input();
 
   #if PERF_METRICS == true
-  if (millis() % 1250 == 0) {
-    Serial.println();
-    Serial.print(get_active_time());
-    Serial.println(" FREE MEMORY: " + String(freeMemory()) + +"B/8192B");
-    Serial.print(get_active_time());
-    Serial.println(" STACK SIZE: " + String((RAMEND - SP)) + "B");
-    Serial.print(get_active_time());
-    Serial.println(" HEAP FRAG: " + String(getFragmentation()) + "%");
-    Serial.println();
+  static unsigned long nextMemorySample = 0;
+  if ((long) (millis() - nextMemorySample) >= 0) {
+    nextMemorySample = millis() + TRACE_MEMORY_INTERVAL;
+    TRACE_EVENT(TRACE_MEMORY, freeMemory());
   }
   #endif
 
@@ -121,10 +132,15 @@ bool is_interrupt() {
 
 
 void delay_ms(const unsigned long milliseconds) {
+  // Show whatever was drawn before waiting.
+  lcd.flush();
   // Set a constant "waitTime" so we can track the time the delay function was first called.
   const unsigned long waitTime = milliseconds + millis();
   while (waitTime > millis() && !is_interrupt()) { // Continue looping forever.
-    asm("nop");
+    // Background work is only started if it can finish before waitTime. @see idle_tasks.h
+    if (!idle_tasks_run(waitTime)) {
+      asm("nop");
+    }
   }
 }
 
@@ -132,22 +148,48 @@ void delay_ms(const unsigned long milliseconds) {
 //// SETUP & LOOP FUNCTIONS ////
 ////////////////////////////////
 
+/** @brief The size of the largest of the given states. */
+template <typename State> constexpr size_t largest_state() {
+  return sizeof(State);
+}
+template <typename State, typename Next, typename... Others> constexpr size_t largest_state() {
+  return sizeof(State) > largest_state<Next, Others...>() ? sizeof(State) : largest_state<Next, Others...>();
+}
+
+/**
+ * @brief The storage which every ProgramState is constructed in. Only one state exists at a time so the storage only needs to be as
+ * large as the largest state. States are never allocated on the heap.
+ */
+alignas(MainMenu) alignas(CreatorModeMenu) alignas(ListeningModeMenu) alignas(ListeningModePlayingSong) alignas(CreatorModeCreateNew)
+static uint8_t statePool[largest_state<MainMenu, CreatorModeMenu, ListeningModeMenu, ListeningModePlayingSong, CreatorModeCreateNew>()];
+
 /**
  * @brief A global main-class-scoped variable which is a pointer to a ProgramState instance.
  * 
  * @paragraph A Brief Description
  * The prgmState variable represents the current ProgramState the program is in on a global scale.
  * <br />
- * The prgmState is a pointer to a larger ProgramState object which was allocated on the heap.<br />
+ * The prgmState points to the statePool which the current state was constructed in.<br />
  * Whenever we need to interact with the current user state we access the prgmState variable which is only scoped to the main class.<br />
  * To change the prgmState from another class you either need to use an interrupt from a supporting ProgramState or use the update_state method.<br />
- * The prgmState variable <b>SHOULD NEVER</b> be allocated with new() outside of update_state and the setup() method. <br />
+ * The prgmState variable <b>SHOULD NEVER</b> be changed outside of apply_pending_state. <br />
  * To learn more about program states view the state.h file.
  * 
  * @see state.h
  * @see update_state(StateID state)
  */
-static ProgramState * prgmState = new MainMenu();
+static ProgramState * prgmState = new (statePool) MainMenu();
+
+/** @brief Marks that no state change has been requested. */
+constexpr uint8_t NO_PENDING_STATE = UINT8_MAX;
+
+/**
+ * @brief The StateID which update_state has requested (or NO_PENDING_STATE).
+ * The change is applied at the top of loop() when the current state is not running.
+ */
+static volatile uint8_t pendingState = NO_PENDING_STATE;
+
+static void apply_pending_state();
 
 /**
  * @brief Sets up TuneStudio2560 to be used on an infinite loop by initalizing hardware and checking for errors.
@@ -155,12 +197,13 @@ static ProgramState * prgmState = new MainMenu();
  * @par In Order:
  * - [DEBUG ONLY] Initalize the Serial Monitor
  * - Setup pinMode
- * - Attach interrupts to select/cancel buttons.
+ * - Start scanning the buttons.
  * - Initalize the Liquid Crystal Display.
  * - Add custom characters to the LCD.
  * - Initalize and setup the 4-digit 7-Segment display.
  * - Setup the SD card and check for errors.
  * - Make the README.TXT file.
+ * - Move the SD card to the fastest SPI clock it can use.
  * - [PRGM_MODE==2] Enable Fast Analog Read
  * - Set the prgmState variable to the Main Menu.
  */
@@ -184,15 +227,8 @@ void setup() {
   Serial.println(F("[!!!] WARNING: DEBUG mode is enabled. When DEBUG is enabled TuneStudio2560 may not run at full speed due to performance reduction outputting to Serial Monitor. Using performance metrics will also largely reduce speed."));
   delay_ms(1000);
   #endif
-  #if DEBUG == false && PERF_METRICS == true
-  Serial.begin(9600);
-  while (!Serial) {
-    ;
-  }
-  while (true) {
-    Serial.println(F("ERROR: YOU MUST ENABLE DEBUG IN ORDER TO USE PERFORMANCE METRICS."));
-    delay_ms(500);
-  }
+  #if PERF_METRICS == true
+  trace_begin();
   #endif
   #if DEBUG == true
   Serial.print(get_active_time());
@@ -252,9 +288,14 @@ void setup() {
   Serial.println(F(" pins have been initalized."));
   #endif
 
-  // Interrupt to handle when the select button is pressed.
-  attachInterrupt(digitalPinToInterrupt(BTN_ADD_SELECT), isr_btn_handle, FALLING);
-  attachInterrupt(digitalPinToInterrupt(BTN_DEL_CANCEL), isr_btn_handle, FALLING);
+  // Scan the buttons from the Timer2 overflow interrupt. @see input.h
+  input_begin();
+
+  // The extra speaker pins of songs with more than one track. @see voices.h
+  voice_begin();
+
+  // Start the interrupt which plays back songs.
+  sequencer_begin();
 
   // Initalize the LCD.
   lcd.init();
@@ -271,37 +312,8 @@ void setup() {
   Serial.print(get_active_time());
   Serial.println(F(" lcd has been initalized."));
   #endif
-  // Setup 4-wide 7 segment display.
-  // More information: https://github.com/bridystone/SevSegShift
-
-  const byte numDigits = 4;
-  constexpr byte digitPins[] = {
-    8 + 2,
-    8 + 5,
-    8 + 6,
-    2
-  }; // of ShiftRegister(s) | 8+x (2nd Register)
-  constexpr byte segmentPins[] = {
-    8 + 3,
-    8 + 7,
-    4,
-    6,
-    7,
-    8 + 4,
-    3,
-    5
-  }; // of Shiftregister(s) | 8+x (2nd Register)
-
-  const bool resistorsOnSegments = false; // 'false' means resistors are on digit pins
-  const byte hardwareConfig = COMMON_CATHODE; // See README.md for options
-  const bool updateWithDelays = false; // Default 'false' is Recommended
-  const bool leadingZeros = false; // Use 'true' if you'd like to keep the leading zeros
-  bool disableDecPoint = false; // Use 'true' if your decimal point doesn't exist or isn't connected. Then, you only need to specify 7 segmentPins[]
-
-  segDisplay.begin(hardwareConfig, numDigits, (byte * ) digitPins, (byte * ) segmentPins, resistorsOnSegments,
-    updateWithDelays, leadingZeros, disableDecPoint);
-  segDisplay.blank();
-  segDisplay.refreshDisplay();
+  // Setup 4-wide 7 segment display. It is refreshed from the Timer0 compare A interrupt. @see seg_display.h
+  seg_begin();
   #if DEBUG == true
   Serial.print(get_active_time());
   Serial.println(F(" segment display has been initalized."));
@@ -309,7 +321,7 @@ void setup() {
 
 
   // Setup SD Card
-  if (!SD.begin(SD_CS_PIN)) {
+  if (!SD.begin(SD_CS_PIN, SPI_CLOCK)) {
     #if DEBUG == true
     Serial.println(F("[CRITICAL] SD module cannot be initalized due to one or more problems."));
     Serial.println(F("* Is the card properly inserted?"));
@@ -329,6 +341,7 @@ void setup() {
     #else
     analogWrite(RGB_RED, RGB_BRIGHTNESS);
     #endif
+    lcd.flush();
     while (true) {
       ;
     }
@@ -344,13 +357,23 @@ void setup() {
   Serial.println(F(" README file has been generated."));
   #endif
 
-  #if FAST_ADC == 1
-  // set prescale to 16
-  sbi(ADCSRA, ADPS2);
-  cbi(ADCSRA, ADPS1);
-  cbi(ADCSRA, ADPS0);
+  sd_tune_spi_clock();
+  #if DEBUG == true
+  Serial.print(get_active_time());
+  Serial.println(F(" SD card SPI clock has been set."));
+  #endif
+
+  sd_index_build();
+  #if DEBUG == true
+  Serial.print(get_active_time());
+  Serial.print(F(" Song index has been built with "));
+  Serial.print(songCount);
+  Serial.println(F(" songs."));
   #endif
 
+  // Start reading the potentiometer in the background.
+  pot_begin();
+
   // Blink LED according to Program Mode.
   #if PRGM_MODE==0
     digitalWriteFast(RGB_GREEN, HIGH);
@@ -382,50 +405,28 @@ void setup() {
 /**
  * @brief The primary loop() method of the Arduino is responsible for managing the programState and resetting interrupts.
  * @paragraph What it does
- * The loop() method will first call the execute() function for the prgmState variable.
+ * The loop() method will first handle any button presses and change the state if one was requested.
+ * It then calls the execute() function for the prgmState variable.
  * The execute() function will handle the initalization and looping for the Program State.
  * <br />
+ * Anything the state drew on the lcd is then flushed to the display.
+ * <br />
  * After, the immediateInterrupt variable is set to "false" just in case the loop was reset due to an interrupt.
  * <br /><br />
- * <i>For PERF_METRICS & DEBUG Only:</i><br />
- * Prints out performance statistics to the Serial monitor.
- * The performance statistics which are displayed are:
- * - Time the loop took to complete (in microseconds)
- * - The RAM usage of the program.
- * - The current (%) of RAM the program is utilizing.
- * - The number of clock cycles which have passed since the previous iteration.
- * - The "IPS" or "Iterations Per Second" of the loop which describes how many times the loop can run PER SECOND if the number of clock cycles is counted accurately.
- * 
+ * <i>For PERF_METRICS Only:</i><br />
+ * The start and end of every iteration are added to the trace along with the current StateID and the trace is dumped if it
+ * was requested over serial. @see trace.h
  */
 void loop() {
-  #if PERF_METRICS // For testing the iteration speed of the programState loop() function. Results will be off for functions who use blocking delays.
-  unsigned long startingMicros = micros();
-  #define RAM_SIZE_BYTES 8192
-  #endif
+  handle_input();
+  apply_pending_state();
+  TRACE_EVENT(TRACE_LOOP_START, prgmState -> get_state());
   prgmState -> execute();
+  lcd.flush();
   immediateInterrupt = false;
-  #if PERF_METRICS
-  const unsigned long finishTime = micros() - startingMicros;
-  const unsigned int memoryUtilBytes = RAM_SIZE_BYTES - freeMemory();
-  const float ramUtilPercent = ((float) memoryUtilBytes / (float) RAM_SIZE_BYTES) * (float) 100;
-  const unsigned long clockCycles = microsecondsToClockCycles(finishTime);
-  const uint32_t iterationsPerSecond = F_CPU / microsecondsToClockCycles(finishTime);
-
-  Serial.print(F("Loop Complete in: "));
-  Serial.print(finishTime); // Amount of microseconds it takes to complete an iteration of the program state.
-  Serial.print(F("μs | RAM USAGE: "));
-  Serial.print(memoryUtilBytes); // How much SRAM the current application is using.
-  Serial.print(F("B ("));
-  Serial.print(ramUtilPercent); // The percent of ram being utilized.
-  Serial.print(F("%)"));
-  Serial.print(F(" | "));
-  Serial.print(F("Cycles: "));
-  Serial.print(clockCycles); // How many clock cycles the loop took.
-  Serial.print(F(" > IPS: "));
-  // How many times the loop executes per second judging on the last known amount of clock cycles the loop took to execute.
-  // IPS means Iterations Per Second (how many times loop() can run per second)
-  Serial.println(iterationsPerSecond);
-
+  TRACE_EVENT(TRACE_LOOP_END, prgmState -> get_state());
+  #if PERF_METRICS == true
+  trace_poll();
   #endif
 }
 
@@ -461,86 +462,68 @@ void set_selected_song(uint8_t song) {
 uint8_t get_selected_song() {
   return selectedSong;
 }
-const char* pgm_pcpyr(uint8_t btnIndex, uint8_t noteIndex) {
-  // Create a static buffer to hold the value of any pitch the program wants to use.
-  static char pitchBuff[4];
-  // Copy the PROGMEM pointer data to pitchBuff.
-  strcpy_P(pitchBuff, (PGM_P)pgm_read_word(&(PROGRAM_NOTES[btnIndex].notes[noteIndex].pitch)));
-  return pitchBuff;
+uint16_t get_note_frequency(const uint8_t note) {
+  if (note >= PROGRAM_NOTE_AMOUNT) {
+    return note == PAUSE_NOTE_INDEX ? PAUSE_NOTE.frequency : EMPTY_NOTE.frequency;
+  }
+  return (uint16_t) pgm_read_word( & PROGRAM_NOTES[note / TONES_PER_BUTTON].notes[note % TONES_PER_BUTTON].frequency);
 }
 
-
-note_t get_note_from_freq(const uint16_t frequency) {
-  if (frequency == PAUSE_NOTE.frequency) {
-    return PAUSE_NOTE;
+PGM_P get_note_pitch_P(const uint8_t note) {
+  if (note >= PROGRAM_NOTE_AMOUNT) {
+    return note == PAUSE_NOTE_INDEX ? pitch_pause : pitch_empty;
   }
+  return (PGM_P) pgm_read_ptr( & PROGRAM_NOTES[note / TONES_PER_BUTTON].notes[note % TONES_PER_BUTTON].pitch);
+}
 
-  // 5 tune buttons, 17 pitches each
-  for (uint8_t i = 0; i < TONE_BUTTON_AMOUNT; i++) {
-    for (uint8_t j = 0; j < TONES_PER_BUTTON; j++) {
-      if (pgm_read_word( & PROGRAM_NOTES[i].notes[j].frequency) == frequency) {
-
-        // Get a pointer to the current note we want.
-        const char * pitch = pgm_pcpyr(i, j);
-
-        return note_t {
-          pitch,
-          frequency
-        }; // Dont need to find the frequency because the parameter already passed it.
-      }
-    }
-  }
-  #if DEBUG == true
-  Serial.print(get_active_time());
-  Serial.print(F(" WARNING: Encountered unknown frequency "));
-  Serial.print(frequency);
-  Serial.println(F("."));
-  #endif
-  return EMPTY_NOTE;
+char * get_note_pitch(const uint8_t note, char * const buffer) {
+  return strcpy_P(buffer, get_note_pitch_P(note));
 }
 
-note_t get_note_from_pitch(const char *
+/** @brief The semitone (from C) of each natural note letter from A to G. */
+const uint8_t PITCH_SEMITONES[7] PROGMEM = { 9, 11, 0, 2, 4, 5, 7 };
+
+uint8_t get_note_from_pitch(const char *
   const pitch) {
   // If the note is a pause then return it instantly.
   if (strcmp(PAUSE_NOTE.pitch, pitch) == 0) {
-    return PAUSE_NOTE;
+    return PAUSE_NOTE_INDEX;
   }
 
-  // Go through every tune button and find a match.
-  for (uint8_t i = 0; i < TONE_BUTTON_AMOUNT; i++) {
-    for (uint8_t j = 0; j < TONES_PER_BUTTON; j++) {
-      if (strcmp(pgm_pcpyr(i, j), pitch) == 0) {
+  // Pitches are a letter (A-G), an optional sharp (S) and an octave (0-7). Ex: "CS4"
+  const char letter = pitch[0];
+  const bool isSharp = letter != '\0' && pitch[1] == 'S';
+  const char octave = letter != '\0' ? pitch[1 + isSharp] : '\0';
+  // E and B do not have a sharp in PROGRAM_NOTES (ES is the same as F).
+  const bool isValid = letter >= 'A' && letter <= 'G' && octave >= '0' && octave <= '7' && pitch[2 + isSharp] == '\0' && !(isSharp && (letter == 'E' || letter == 'B'));
+  const int16_t note = isValid ? ((octave - '0') * 12) + pgm_read_byte( & PITCH_SEMITONES[letter - 'A']) + isSharp - FIRST_NOTE_CHROMATIC : -1;
 
-        uint16_t freq = (uint16_t) pgm_read_word( & PROGRAM_NOTES[i].notes[j].frequency);
-
-        return note_t {
-          pitch,
-          freq
-        }; // Dont need to find the pitch because the parameter already passed it.
-      }
-    }
+  if (note < 0 || note >= PROGRAM_NOTE_AMOUNT) {
+    #if DEBUG == true
+    Serial.print(get_active_time());
+    Serial.print(F(" WARNING: Encountered unknown pitch "));
+    Serial.print(pitch);
+    Serial.println(F("."));
+    #endif
+    return EMPTY_NOTE_INDEX;
   }
-  #if DEBUG == true
-  Serial.print(get_active_time());
-  Serial.print(F(" WARNING: Encountered unknown pitch "));
-  Serial.print(pitch);
-  Serial.println(F("."));
-  #endif
-  return EMPTY_NOTE;
+  return note;
 }
 
-note_t get_current_tone(uint8_t toneButton) {
-  // Split the potentiometer value into 17 different sections because each tune button represents 17 different tones.
-  // Note that the subTone value is not evenly split and the final subTone (17) has slightly less potential values.
-  const uint8_t subTone = (get_current_freq() + 1) / 61;
+uint8_t get_current_tone(uint8_t toneButton) {
+  static uint8_t subTone = 0;
+  // Only recalculated when the potentiometer has moved.
+  if (pot_has_changed()) {
+    // Split the potentiometer value into 17 different sections because each tune button represents 17 different tones.
+    // Note that the subTone value is not evenly split and the final subTone (17) has slightly less potential values.
+    subTone = (get_current_freq() + 1) / 61;
+  }
   toneButton = BTN_TO_INDEX(toneButton);
-  return toneButton != UINT8_MAX ? note_t {
-    (pgm_pcpyr(toneButton, subTone)), ((uint16_t) pgm_read_word( & PROGRAM_NOTES[toneButton].notes[subTone].frequency))
-  } : EMPTY_NOTE;
+  return toneButton != UINT8_MAX ? (toneButton * TONES_PER_BUTTON) + subTone : EMPTY_NOTE_INDEX;
 }
 
 uint16_t get_current_freq() {
-  return analogRead(TONE_FREQ);
+  return pot_get_value();
 }
 
 ////////////////////////
@@ -615,11 +598,7 @@ void print_scrolling(const __FlashStringHelper * text, uint8_t cursorY, uint8_t
 }
 
 void lcd_clear_row(uint8_t row) {
-  lcd.setCursor(0, row);
-  for (uint8_t i = 0; i < LCD_COLS; i++) {
-    lcd.print(F(" "));
-  }
-  lcd.setCursor(0, row);
+  lcd.clear_row(row);
 }
 
 ////////////////////////////
@@ -627,12 +606,25 @@ void lcd_clear_row(uint8_t row) {
 //////////////////////////
 
 void update_state(StateID state) {
+  pendingState = state;
+}
+
+/**
+ * @brief Replace the current state with the state requested by update_state (if any).
+ * Only called at the top of loop() so the old state is never destroyed while its loop() is running.
+ */
+static void apply_pending_state() {
+  const uint8_t state = pendingState;
+  if (state == NO_PENDING_STATE) {
+    return;
+  }
+  pendingState = NO_PENDING_STATE;
   if (state == prgmState -> get_state()) {
     return;
   }
   
-  // Free the memory that the previous program state.
-  delete prgmState;
+  // Destroy the previous program state. Its storage is reused by the new state.
+  prgmState -> ~ProgramState();
   prgmSong.clear();
   // Reset the songs attributes in case they were changed.
   prgmSong.set_attributes(DEFAULT_NOTE_LENGTH, DEFAULT_NOTE_DELAY);
@@ -642,285 +634,958 @@ void update_state(StateID state) {
   Serial.print(F(" changed current program state to "));
   Serial.println(state);
   #endif
+  TRACE_EVENT(TRACE_STATE, state);
+  STACK_WATCH_STATE((StateID) state);
+  // Presses which the previous state never checked for do not carry over.
+  pressedButtons = 0;
+  chordButtons = 0;
 
   switch (state) {
   case MAIN_MENU:
-    prgmState = new MainMenu();
+    prgmState = new (statePool) MainMenu();
     return;
   case CM_MENU:
-    prgmState = new CreatorModeMenu();
+    prgmState = new (statePool) CreatorModeMenu();
     return;
   case LM_MENU:
-    prgmState = new ListeningModeMenu();
+    prgmState = new (statePool) ListeningModeMenu();
     return;
   case LM_PLAYING_SONG:
-    prgmState = new ListeningModePlayingSong();
+    prgmState = new (statePool) ListeningModePlayingSong();
     return;
   case CM_CREATE_NEW:
-    prgmState = new CreatorModeCreateNew();
+    prgmState = new (statePool) CreatorModeCreateNew();
     return;
   default:
     #if DEBUG == true
     Serial.print(get_active_time());
     Serial.println(F(" Unknown State Requested."));
     #endif
+    // The storage can not be left empty so go back to the main menu.
+    prgmState = new (statePool) MainMenu();
     return;
   }
 }
 
-void isr_btn_handle() {
-  // First, we must check if the current state wants to handle an interrupt in the first place.
-  if(millis() - lastButtonPress < DEBOUNCE_RATE || digitalReadFast(BTN_OPTION) == LOW) {
-    return; // Terminate ISR
+/**
+ * @brief Change the state from one of the menus when SELECT or DEL/CANCEL is pressed.
+ *
+ * @return If the press was used by the menu.
+ */
+static bool handle_menu_press(const uint8_t button) {
+  if (button != INPUT_SELECT && button != INPUT_CANCEL) {
+    return false;
   }
-  #define SELECT 0 // Select button signified as false (LOW)
-  #define CANCEL 1 // Cancel button signified as true (HIGH)
-
-  bool buttonType = digitalReadFast(BTN_ADD_SELECT); // Check if the select button was the button pressed.
+  const StateID state = prgmState -> get_state();
+  if (state != MAIN_MENU && state != LM_MENU && state != CM_MENU) {
+    return false;
+  }
+  // Presses are ignored until a state change which was already requested has been applied.
+  if (pendingState != NO_PENDING_STATE) {
+    return true;
+  }
+  const bool isSelect = button == INPUT_SELECT;
 
   immediateInterrupt = true;
-  switch(prgmState->get_state()) {
+  switch(state) {
     case MAIN_MENU:
-      if(buttonType==SELECT) update_state(CM_MENU);
-      if(buttonType==CANCEL) update_state(LM_MENU);
+      update_state(isSelect ? CM_MENU : LM_MENU);
       break;
     case LM_MENU:
-      if(buttonType==SELECT && prgmState->has_initalized()) { update_state(LM_PLAYING_SONG); immediateInterrupt = false;}
-      if(buttonType==CANCEL) { update_state(MAIN_MENU); set_selected_page(1); set_selected_song(1); }
-      break;
-    case CM_MENU:
-      if(buttonType==SELECT) update_state(CM_CREATE_NEW);
-      if(buttonType==CANCEL) update_state(MAIN_MENU);
+      if(isSelect && prgmState->has_initalized()) { update_state(LM_PLAYING_SONG); immediateInterrupt = false;}
+      if(!isSelect) { update_state(MAIN_MENU); set_selected_page(1); set_selected_song(1); }
       break;
     default:
-      immediateInterrupt = false;
+      update_state(isSelect ? CM_CREATE_NEW : MAIN_MENU);
       break;
   }
-  lastButtonPress = millis();
+  return true;
 }
 
-bool is_pressed(const uint8_t buttonPin) {
-  if (!(millis() - lastButtonPress < DEBOUNCE_RATE) && digitalRead(buttonPin) == LOW) {
-    lastButtonPress = millis();
-    return true;
+void handle_input() {
+  inputEvent_t event;
+  while (input_pop(event)) {
+    const uint8_t mask = 1 << event.button;
+    switch (event.type) {
+    case INPUT_PRESS:
+      if (!handle_menu_press(event.button)) {
+        pressedButtons |= mask;
+      }
+      break;
+    case INPUT_CHORD:
+      chordButtons |= mask;
+      break;
+    case INPUT_LONG_PRESS:
+      longPressedButtons |= mask;
+      break;
+    case INPUT_RELEASE:
+      longPressedButtons &= ~mask;
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Check and clear the bit of a button in one of the pressed button masks.
+ */
+static bool take_button(uint8_t &buttons, const uint8_t buttonPin) {
+  handle_input();
+  const uint8_t button = input_button_of(buttonPin);
+  if (button == INPUT_BUTTON_COUNT || !(buttons & (1 << button))) {
+    return false;
   }
-  return false;
+  buttons &= ~(1 << button);
+  return true;
+}
+
+bool is_pressed(const uint8_t buttonPin) {
+  return take_button(pressedButtons, buttonPin);
+}
+
+bool is_chord_pressed(const uint8_t buttonPin) {
+  return take_button(chordButtons, buttonPin);
+}
+
+bool is_long_pressed(const uint8_t buttonPin) {
+  handle_input();
+  const uint8_t button = input_button_of(buttonPin);
+  return button != INPUT_BUTTON_COUNT && (longPressedButtons & (1 << button));
 }
 
 ////////////////////////////
 //// SD CARD FUNCTIONS ////
 //////////////////////////
 
-void sd_save_song(const char * const fileName) {
-  // Delete the previous song if the name already exists.
-  sd_rem(fileName);
-  // Create a song object to be saved
-  File songFile = SD.open(fileName, FILE_WRITE);
+/**
+ * @brief Check if a file in the root directory is a valid song.
+ *
+ * @param entry The opened file.
+ * @param name The name of the file.
+ * @return If the file is a song file (.txt) which is not the README.
+ */
+static bool sd_is_song(File & entry, const char * const name) {
+  return entry && !entry.isDirectory() && strcasestr(name, FILE_TXT_EXTENSION) && strcasecmp(name, README_FILE) != 0;
+}
 
-  songFile.print(F(
-    "# Welcome to a song file!\n"
-    "# To view more information, check out https://github.com/devjluvisi/TuneStudio2560/wiki/For-Users\n"
-    "\n# The delay between each different tone (ms). (Must be 9999 or less and greater than 0)\n"
-    "TONE_DELAY="
-  ));
-  songFile.println(DEFAULT_NOTE_DELAY);
-  songFile.print(F("\n# The length that each tone should play for (ms). (Must be 255 or less and greater than 0)\nTONE_LENGTH="));
-  songFile.println(DEFAULT_NOTE_LENGTH);
-  songFile.println(F("\nData:"));
+/**
+ * @brief Adds a new song to the song index. Entries are kept in the same order as the root directory.
+ *
+ * @param songFile The opened song file.
+ */
+static void sd_index_add(File & songFile) {
+  if (!songFile || songCount == MAX_SONG_AMOUNT) {
+    return;
+  }
+  songIndexEntry_t entry;
+  entry.dirIndex = songFile.dirIndex();
+  songFile.getName(entry.name, sizeof(entry.name));
+
+  // Move every entry which comes after the new song up by one.
+  uint8_t position = songCount;
+  songIndexEntry_t previous;
+  while (position > 0) {
+    songIndex.seekSet((uint32_t)(position - 1) * sizeof(songIndexEntry_t));
+    songIndex.read(&previous, sizeof(previous));
+    if (previous.dirIndex < entry.dirIndex) {
+      break;
+    }
+    songIndex.write((const uint8_t *) &previous, sizeof(previous));
+    position--;
+  }
+  songIndex.seekSet((uint32_t)position * sizeof(songIndexEntry_t));
+  songIndex.write((const uint8_t *) &entry, sizeof(entry));
+  songIndex.sync();
+  songCount++;
+}
 
-  // Convert each frequency in the song to a pitch and save it on the SD.
-  for (song_size_t i = 0; i < prgmSong.get_size(); i++) {
-    songFile.print(F("  - "));
-    songFile.println(get_note_from_freq(prgmSong.get_note(i)).pitch);
+/**
+ * @brief Removes a song from the song index.
+ *
+ * @param fileName The name of the song to remove.
+ */
+static void sd_index_remove(const char * const fileName) {
+  songIndexEntry_t entry;
+  uint8_t position = 0;
+  // Find the song.
+  songIndex.seekSet(0);
+  while (position < songCount) {
+    songIndex.read(&entry, sizeof(entry));
+    if (strcasecmp(entry.name, fileName) == 0) {
+      break;
+    }
+    position++;
   }
-  songFile.println(F("\n# END"));
-  songFile.close();
-  #if DEBUG == true
-  Serial.print(get_active_time());
-  Serial.println(F(" Finished writing with SD Card."));
-  #endif
-  return;
+  if (position == songCount) {
+    return;
+  }
+  // Move every entry which comes after the song down by one.
+  for (uint8_t i = position + 1; i < songCount; i++) {
+    songIndex.seekSet((uint32_t)i * sizeof(songIndexEntry_t));
+    songIndex.read(&entry, sizeof(entry));
+    songIndex.seekSet((uint32_t)(i - 1) * sizeof(songIndexEntry_t));
+    songIndex.write((const uint8_t *) &entry, sizeof(entry));
+  }
+  songCount--;
+  songIndex.truncate((uint32_t)songCount * sizeof(songIndexEntry_t));
+  songIndex.sync();
 }
 
-void sd_rem(const char * const fileName) {
-  if (SD.exists(fileName)) {
-    #if DEBUG == true
-    Serial.print(get_active_time());
-    Serial.print(F(" "));
-    Serial.print(fileName);
-    Serial.println(F(" HAS BEEN DELETED FROM SD CARD."));
-    #endif
-    // Delete the old file.
-    SD.remove(fileName);
+/**
+ * @brief Get the path of the compiled cache file for a song. Ex: "SONG.TXT" -> "CACHE/SONG.BIN"
+ *
+ * @param fileName The name of the song.
+ * @param cachePath A buffer of at least 24 characters to write the path to.
+ */
+static void sd_cache_path(const char * const fileName, char * const cachePath) {
+  const uint8_t dirLength = strlen(SONG_CACHE_DIR);
+  memcpy(cachePath, SONG_CACHE_DIR, dirLength);
+  cachePath[dirLength] = '/';
+  // Copy the name without its extension (8 characters at most for 8.3 names).
+  uint8_t nameLength = 0;
+  while (fileName[nameLength] != '\0' && fileName[nameLength] != '.' && nameLength < 8) {
+    cachePath[dirLength + 1 + nameLength] = fileName[nameLength];
+    nameLength++;
   }
-  return;
+  strcpy(cachePath + dirLength + 1 + nameLength, FILE_CACHE_EXTENSION);
 }
 
-const char * sd_get_file(uint8_t index) {
-  File baseDir = SD.open(ROOT_DIR);
-  baseDir.rewindDirectory();
-  // The current amount of song files we have opened.
-  uint8_t count = 0;
-  static char name[14];
-  while (true) {
-    File entry = baseDir.openNextFile();
+/**
+ * @brief Continue a checksum over a song cache header.
+ *
+ * @param header The header of the cache.
+ * @param crc The CRC-CCITT of the notes of the song (started at 0xFFFF).
+ * @return The CRC-CCITT of the notes followed by the header (with the crc set to zero).
+ */
+static uint16_t sd_cache_crc(songCacheHeader_t header, uint16_t crc) {
+  header.crc = 0;
+  const uint8_t * bytes = (const uint8_t *) &header;
+  for (uint8_t i = 0; i < sizeof(header); i++) {
+    crc = _crc_ccitt_update(crc, bytes[i]);
+  }
+  return crc;
+}
 
-    // Copies the name of the SD file onto the static name buffer.
-    entry.getName(name, sizeof(name));
+/**
+ * @brief Check that an open cache file was compiled from the exact same version of the text file and that its size matches
+ * its header. The notes are checked afterwards (one step at a time) against the CRC of the header. @see sd_song_open_run
+ *
+ * @param cache The open cache file.
+ * @param source The header that the cache must match (sourceSize, sourceDate and sourceTime are checked).
+ * @param header The header of the cache is read into this.
+ * @return If the header of the cache is up to date and valid.
+ */
+static bool sd_cache_check(File & cache, const songCacheHeader_t & source, songCacheHeader_t & header) {
+  return cache.read(&header, sizeof(header)) == (int) sizeof(header) && header.version == SONG_CACHE_VERSION &&
+    header.sourceSize == source.sourceSize && header.sourceDate == source.sourceDate && header.sourceTime == source.sourceTime &&
+    header.noteCount >= MIN_SONG_LENGTH && header.trackCount != 0 && header.trackCount <= SONG_MAX_TRACKS &&
+    cache.fileSize() == sizeof(header) + (uint32_t) header.noteCount * header.trackCount;
+}
 
-    const bool isValid = entry && !entry.isDirectory() && strcasestr(name, FILE_TXT_EXTENSION) && strcmp(name, README_FILE) != 0;
-    entry.close();
+/** @brief The states of the song text tokenizer. @see sd_song_parse */
+enum SongParseState: uint8_t {
+  /** @brief Skipping text which is not a value or a note (ex. "TONE_DELAY" or "Data:"). */
+  PARSE_TEXT,
+  /** @brief Skipping a comment until the end of the line. */
+  PARSE_COMMENT,
+  /** @brief Reading the number after an '=' sign. */
+  PARSE_VALUE,
+  /** @brief Reading the pitches (one for each track) after a '-' sign. */
+  PARSE_NOTE
+};
+
+/** @brief The most digits a value (TONE_DELAY or TONE_LENGTH) can have. TONE_DELAY must be 9999 or less. */
+constexpr uint8_t SONG_VALUE_DIGITS = 4;
+
+/** @brief What the next step of opening a song does. @see songOpen_t */
+enum SongOpenPhase: uint8_t {
+  /** @brief Reading the notes of the cache to check them against its CRC. */
+  OPEN_VERIFY,
+  /** @brief Parsing the text of the song into a new cache. */
+  OPEN_COMPILE
+};
 
-    if(!isValid) {
-      // Check to see if the file we are trying to open does not even exist.
-      if(name[0] == '\0') {
-        break;
-      }
-      // File is not a valid song but it does exist.
-      continue;
-    }
+/**
+ * @brief The song which is being opened. <i>(Used as songOpen_t)</i>
+ * @brief
+ * Holds everything the verifier and the tokenizer need between two steps so opening a song can be stopped after any step and
+ * continued later (ex. while the user is still browsing). Only one song is opened at a time. @see sd_song_open_start
+ */
+typedef struct songOpen {
+  /** @brief The cache file of the caller which started opening the song. nullptr if no song is being opened. */
+  File * cache;
+  /** @brief The header of the caller. Filled in as the song is verified or compiled. */
+  songCacheHeader_t * header;
+  /** @brief The text file of the song. */
+  File entry;
+  /** @brief The path of the cache file. */
+  char cachePath[24];
+  /** @brief The header that the cache must match (the size and modification time of the text file). */
+  songCacheHeader_t source;
+  /** @brief What the next step does. */
+  SongOpenPhase phase;
+  /** @brief The bytes of notes which have not been verified yet. */
+  uint32_t remaining;
+  /** @brief CRC-CCITT of the notes which have been verified or compiled so far. */
+  uint16_t crc;
+  /** @brief The state of the tokenizer. */
+  SongParseState state;
+  /** @brief Track if the current '=' sign being read is for the tone delay or for the tone length. */
+  bool isToneDelay;
+  /** @brief The pitch which is being read. */
+  char pitch[PITCH_BUFFER_SIZE];
+  /** @brief The amount of characters of the pitch or value which is being read. */
+  uint8_t tokenLength;
+  /** @brief The value which is being read. */
+  uint16_t value;
+  /** @brief The pitches of the note line which is being read. */
+  uint8_t step[SONG_MAX_TRACKS];
+  /** @brief The amount of pitches in step. */
+  uint8_t stepTracks;
+  /** @brief Notes which have not been written to the cache yet. */
+  uint8_t notes[SONG_STREAM_BLOCK_SIZE];
+  /** @brief The amount of notes in notes. */
+  uint8_t noteAmount;
+} songOpen_t;
+
+static songOpen_t songOpen;
 
-    if(count == index) {
-      break; // We have gotten to our number. Now we break out and return.
-    }
-    count++;
+/**
+ * @brief Stop opening the song. The cache is closed and, if it was being compiled, deleted since it is not complete.
+ *
+ * @return SONG_OPEN_FAILED
+ */
+static SongOpenStatus sd_song_open_fail() {
+  songOpen.entry.close();
+  songOpen.cache->close();
+  if (songOpen.phase == OPEN_COMPILE) {
+    SD.remove(songOpen.cachePath);
   }
-  // Close the root directory we were editing.
-  baseDir.close();
-  return name;
+  songOpen.cache = nullptr;
+  return SONG_OPEN_FAILED;
 }
 
-bool sd_songcpy(const char * const fileName) {
+/**
+ * @brief The song has been opened. The cache is left positioned at the first note.
+ *
+ * @return SONG_OPEN_DONE
+ */
+static SongOpenStatus sd_song_open_done() {
+  songOpen.entry.close();
+  songOpen.cache->seekSet(sizeof(songCacheHeader_t));
+  songOpen.cache = nullptr;
+  #if DEBUG == true
+  Serial.print(get_active_time());
+  Serial.print(songOpen.phase == OPEN_VERIFY ? F(" Opened a song from its compiled cache (") : F(" Compiled a song into ("));
+  Serial.print(songOpen.cachePath);
+  Serial.println(F(")."));
+  #endif
+  return SONG_OPEN_DONE;
+}
 
-  // If the file does not exist.
-  if (!SD.exists(fileName)) {
-    return false;
+/**
+ * @brief Start compiling the text of the song into a new cache so it does not need to be parsed the next time it is loaded.
+ * @remark The header is written last which means a cache that was not finished never has a valid version.
+ *
+ * @return SONG_OPEN_BUSY or SONG_OPEN_FAILED if the cache could not be created.
+ */
+static SongOpenStatus sd_song_compile_begin() {
+  songOpen.cache->close();
+  songOpen.phase = OPEN_COMPILE;
+  if (!SD.exists(SONG_CACHE_DIR)) {
+    SD.mkdir(SONG_CACHE_DIR);
+  }
+  File & cache = *songOpen.cache;
+  cache = SD.open(songOpen.cachePath, O_RDWR | O_CREAT | O_TRUNC);
+  if (!cache) {
+    return sd_song_open_fail();
   }
 
-  // Open a new file to read from.
-  File entry = SD.open(fileName);
-  // Track if the current '=' sign being read is for the tone delay or for the tone length.
-  bool isToneDelay = true;
-  // Remove all data from song
-  prgmSong.clear();
+  // Reserve the space for the header. The version is only set once the song has been compiled.
+  songCacheHeader_t & header = *songOpen.header;
+  header = songOpen.source;
+  header.version = 0;
+  cache.write((const uint8_t *) &header, sizeof(header));
 
   // Store these variables to update later if the user has input custom delays.
-  uint8_t noteDelay = DEFAULT_NOTE_DELAY;
-  uint16_t noteLength = DEFAULT_NOTE_LENGTH;
-
-  unsigned int songSize = 0;
-
-  // As long as their are avaliable characters in the file.
-  while (entry.available()) {
-
-    // Store the current character.
-    char letter = entry.read();
+  header.noteDelay = DEFAULT_NOTE_DELAY;
+  header.noteLength = DEFAULT_NOTE_LENGTH;
+  header.noteCount = 0;
+  header.trackCount = 0;
+  songOpen.crc = 0xFFFF;
+  songOpen.state = PARSE_TEXT;
+  songOpen.isToneDelay = true;
+  songOpen.tokenLength = 0;
+  songOpen.value = 0;
+  songOpen.stepTracks = 0;
+  songOpen.noteAmount = 0;
+  return SONG_OPEN_BUSY;
+}
 
+/**
+ * @brief Feed one character of the text of the song to the tokenizer. Notes are written to the cache in blocks of
+ * SONG_STREAM_BLOCK_SIZE.
+ * @remark Every value and pitch is bounded, CRLF line endings are skipped and tabs count as spaces.
+ *
+ * The pitches on a note line are separated by spaces and each one is a track. The first note line sets the amount of tracks of the
+ * song. Later lines may leave out tracks at the end (they rest) but may not add more.
+ *
+ * @param letter The next character of the text.
+ * @return If the song is still valid.
+ */
+static bool sd_song_parse(const char letter) {
+  songOpen_t & parser = songOpen;
+  songCacheHeader_t & header = *parser.header;
+  switch (parser.state) {
+  case PARSE_TEXT:
     // Ignore the lines with hashtags.
     if (letter == '#') {
-      while (letter != '\n' && entry.available()) {
-        letter = entry.read();
+      parser.state = PARSE_COMMENT;
+    } else if (letter == '=') {
+      parser.state = PARSE_VALUE;
+      parser.tokenLength = 0;
+      parser.value = 0;
+    } else if (letter == '-') {
+      // Lines with a '-' have a note on them.
+      parser.state = PARSE_NOTE;
+      parser.tokenLength = 0;
+    }
+    break;
+  case PARSE_COMMENT:
+    if (letter == '\n') {
+      parser.state = PARSE_TEXT;
+    }
+    break;
+  case PARSE_VALUE:
+  case PARSE_NOTE:
+    // A space (or the end of the line) ends a pitch. The next pitch on the line is the next track.
+    if (parser.state == PARSE_NOTE && parser.tokenLength != 0 && (letter == ' ' || letter == '\t' || letter == '\n' || letter == '#')) {
+      parser.pitch[parser.tokenLength] = '\0';
+      parser.tokenLength = 0;
+      const uint8_t foundNote = get_note_from_pitch(parser.pitch);
+      if (foundNote == EMPTY_NOTE_INDEX || parser.stepTracks == SONG_MAX_TRACKS ||
+        (header.trackCount != 0 && parser.stepTracks == header.trackCount)) {
+        #if DEBUG == true
+        Serial.print(get_active_time());
+        Serial.println(F("Song compile failed, found END note or too many tracks."));
+        #endif
+        return false;
       }
+      parser.step[parser.stepTracks++] = foundNote;
     }
-
-    // Attempt to read the tone delay and tone length values.
-    if (letter == '=') {
-      char buffer[5];
-      uint8_t index = 0;
-      while (entry.peek() != '\n') {
-        letter = entry.read();
-        // Ignore the spaces.|| letter == '\r' || letter == '\b' || letter = '\t'
-        if (letter == ' ' || letter == '\r' || letter == '\b' || letter == '\t' || letter == '=') {
-          continue;
+    // Ignore the spaces.
+    if (letter == ' ' || letter == '\r' || letter == '\b' || letter == '\t' || letter == '=') {
+      break;
+    }
+    if (letter != '\n' && letter != '#') {
+      if (parser.state == PARSE_VALUE) {
+        if (letter < '0' || letter > '9' || parser.tokenLength == SONG_VALUE_DIGITS) {
+          #if DEBUG == true
+          Serial.print(get_active_time());
+          Serial.println(F(" Song compile failed, found an invalid TONE_DELAY or TONE_LENGTH."));
+          #endif
+          return false;
+        }
+        parser.value = (parser.value * 10) + (letter - '0');
+      } else {
+        if (parser.tokenLength == PITCH_BUFFER_SIZE - 1) {
+          #if DEBUG == true
+          Serial.print(get_active_time());
+          Serial.print(F("Song failed due to note size. Count: "));
+          Serial.print(parser.tokenLength);
+          #endif
+          return false;
         }
-        // Add the character to the buffer.
-        buffer[index] = letter;
-        index++;
+        parser.pitch[parser.tokenLength] = letter;
       }
-      buffer[index] = '\0';
-      const uint16_t textToNum = atoi(buffer);
+      parser.tokenLength++;
+      break;
+    }
 
-      if (isToneDelay) {
-        isToneDelay = false;
-        noteDelay = textToNum;
+    // The value or note is complete.
+    if (parser.state == PARSE_VALUE) {
+      if (parser.tokenLength == 0 || (!parser.isToneDelay && parser.value > UINT8_MAX)) {
+        #if DEBUG == true
+        Serial.print(get_active_time());
+        Serial.println(F(" Song compile failed, found an invalid TONE_DELAY or TONE_LENGTH."));
+        #endif
+        return false;
+      }
+      if (parser.isToneDelay) {
+        parser.isToneDelay = false;
+        header.noteDelay = parser.value;
         #if DEBUG == true
         Serial.print(get_active_time());
         Serial.print(F(" Read a TONE DELAY of: "));
-        Serial.println(textToNum);
+        Serial.println(parser.value);
         #endif
       } else {
-
-        noteLength = textToNum;
+        header.noteLength = parser.value;
         #if DEBUG == true
         Serial.print(get_active_time());
         Serial.print(F(" Read a TONE LENGTH of: "));
-        Serial.println(textToNum);
+        Serial.println(parser.value);
         #endif
       }
-    }
-
-    // Find the lines with a '-' which indicates that they are notes.
-    if (letter == '-') {
-      char buffer[4];
-      uint8_t index = 0;
-      // Note: we are on a line with a '-' which means it has a note on it.
-      // Go through each character of the line until we find a line break.
-      while (entry.peek() != '\n') {
-        if (index == 4) {
-          entry.close();
-          #if DEBUG == true
-          Serial.print(get_active_time());
-          Serial.print(F("Song failed due to note size. Count: "));
-          Serial.print(index);
-          #endif
-          return false;
-        }
-        letter = entry.read();
-        // Ignore the spaces.
-        if (letter == ' ' || letter == '\r' || letter == '\b' || letter == '\t' || letter == '=') {
-          continue;
-        }
-        // Add the character to the buffer.
-        buffer[index] = letter;
-        index++;
-      }
-buffer[index] = '\0';
-      // Add the note.
-      note_t foundNote = get_note_from_pitch(buffer);
-      if (foundNote.frequency == EMPTY_NOTE.frequency) {
-        entry.close();
+    } else {
+      // Add the note (every track of the line).
+      if (parser.stepTracks == 0 || header.noteCount == UINT16_MAX) {
         #if DEBUG == true
         Serial.print(get_active_time());
-        Serial.println(F("Song copy finished, found END note."));
+        Serial.println(F("Song compile failed, found END note or the song is too long."));
         #endif
         return false;
       }
-      prgmSong.add_note(foundNote.frequency);
-      songSize++;
+      if (header.trackCount == 0) {
+        header.trackCount = parser.stepTracks;
+      }
+      for (uint8_t track = 0; track < header.trackCount; track++) {
+        const uint8_t foundNote = track < parser.stepTracks ? parser.step[track] : PAUSE_NOTE_INDEX;
+        parser.notes[parser.noteAmount++] = foundNote;
+        parser.crc = _crc_ccitt_update(parser.crc, foundNote);
+        if (parser.noteAmount == sizeof(parser.notes)) {
+          if (parser.cache->write(parser.notes, parser.noteAmount) != parser.noteAmount) {
+            return false;
+          }
+          parser.noteAmount = 0;
+        }
+      }
+      parser.stepTracks = 0;
+      header.noteCount++;
     }
+    parser.state = letter == '#' ? PARSE_COMMENT : PARSE_TEXT;
+    break;
+  }
+  return true;
+}
+
+/**
+ * @brief Write the last notes and the real header of a song which has been parsed to the end.
+ *
+ * @return SONG_OPEN_DONE or SONG_OPEN_FAILED if the song is too short or the cache could not be written.
+ */
+static SongOpenStatus sd_song_compile_end() {
+  songCacheHeader_t & header = *songOpen.header;
+  File & cache = *songOpen.cache;
+  if (songOpen.noteAmount != 0 && cache.write(songOpen.notes, songOpen.noteAmount) != songOpen.noteAmount) {
+    return sd_song_open_fail();
   }
-  if (songSize < MIN_SONG_LENGTH || songSize > MAX_SONG_LENGTH) {
+  if (header.noteCount < MIN_SONG_LENGTH) {
     #if DEBUG == true
     Serial.print(get_active_time());
     Serial.println(F("Song failed due to size."));
     #endif
-    entry.close();
-    return false;
+    return sd_song_open_fail();
   }
 
-  // Update the note length and note delay with what the file has read.
-  prgmSong.set_attributes(noteLength, noteDelay);
+  // The song is complete so the real header can be written over the reserved one.
+  header.version = songOpen.source.version;
+  header.crc = sd_cache_crc(header, songOpen.crc);
+  cache.seekSet(0);
+  cache.write((const uint8_t *) &header, sizeof(header));
+  if (!cache.sync()) {
+    return sd_song_open_fail();
+  }
+  return sd_song_open_done();
+}
 
-  // Close the file
-  entry.close();
-  
+/**
+ * @brief Verify or compile the next part of the song which is being opened.
+ * @remark A cache whose notes do not match its CRC is compiled again from the text.
+ *
+ * The text is read one chunk at a time and every character goes through a small state machine (sd_song_parse). The end of the
+ * file also ends the last line even if it does not have a line break.
+ *
+ * @param chunk A buffer to read the song into.
+ * @param size The size of the buffer. The most bytes of the song the step reads.
+ * @return SONG_OPEN_BUSY if there is more to do.
+ */
+static SongOpenStatus sd_song_open_run(uint8_t * const chunk, const uint16_t size) {
+  if (songOpen.phase == OPEN_VERIFY) {
+    const uint16_t amount = songOpen.remaining < size ? songOpen.remaining : size;
+    if (songOpen.cache->read(chunk, amount) != (int) amount) {
+      return sd_song_compile_begin();
+    }
+    for (uint16_t i = 0; i < amount; i++) {
+      songOpen.crc = _crc_ccitt_update(songOpen.crc, chunk[i]);
+    }
+    songOpen.remaining -= amount;
+    if (songOpen.remaining != 0) {
+      return SONG_OPEN_BUSY;
+    }
+    if (sd_cache_crc(*songOpen.header, songOpen.crc) != songOpen.header->crc) {
+      return sd_song_compile_begin();
+    }
+    return sd_song_open_done();
+  }
+
+  const int length = songOpen.entry.read(chunk, size);
+  for (int i = 0; i < length; i++) {
+    if (!sd_song_parse(chunk[i])) {
+      return sd_song_open_fail();
+    }
+  }
+  if (length > 0) {
+    return SONG_OPEN_BUSY;
+  }
+  // The end of the file also ends the last line.
+  if (!sd_song_parse('\n')) {
+    return sd_song_open_fail();
+  }
+  return sd_song_compile_end();
+}
+
+/**
+ * @brief Formats text into a sector sized buffer and writes it to a file one whole sector at a time.
+ * The file only receives a handful of large writes instead of one small write for every print.
+ */
+class SectorWriter: public Print {
+  private:
+  File & _file;
+  uint8_t _buffer[SD_SECTOR_SIZE];
+  uint16_t _length;
+  /** @brief If every write to the file was complete. */
+  bool _valid;
+
+  void write_buffer() {
+    _valid &= _file.write(_buffer, _length) == _length;
+    _length = 0;
+  }
+
+  public:
+  SectorWriter(File & file): _file(file), _length(0), _valid(true) {}
+
+  size_t write(uint8_t value) override {
+    _buffer[_length++] = value;
+    if (_length == SD_SECTOR_SIZE) {
+      write_buffer();
+    }
+    return 1;
+  }
+
+  size_t write(const uint8_t * buffer, size_t size) override {
+    const size_t total = size;
+    while (size > 0) {
+      const uint16_t count = size < (size_t) (SD_SECTOR_SIZE - _length) ? size : SD_SECTOR_SIZE - _length;
+      memcpy(_buffer + _length, buffer, count);
+      _length += count;
+      buffer += count;
+      size -= count;
+      if (_length == SD_SECTOR_SIZE) {
+        write_buffer();
+      }
+    }
+    return total;
+  }
+  using Print::write;
+
+  /**
+   * @brief Write whatever is left in the buffer and sync the file.
+   * @return If the whole file was written to the SD card.
+   */
+  bool finish() {
+    if (_length != 0) {
+      write_buffer();
+    }
+    return _file.sync() && _valid;
+  }
+};
+
+/**
+ * @brief Get a file name with a different extension. Ex: ("SONG.TXT", ".TMP") -> "SONG.TMP"
+ *
+ * @param fileName The name of the file.
+ * @param extension The new extension (with the dot).
+ * @param path A buffer of at least 13 characters to write the new name to.
+ */
+static void sd_swap_extension(const char * const fileName, const char * const extension, char * const path) {
+  uint8_t nameLength = 0;
+  while (fileName[nameLength] != '\0' && fileName[nameLength] != '.' && nameLength < 8) {
+    path[nameLength] = fileName[nameLength];
+    nameLength++;
+  }
+  strcpy(path + nameLength, extension);
+}
+
+/** @brief The last line of every song saved by sd_save_song. A temporary file which does not end with it was cut off. */
+static const char SONG_END_LINE[] PROGMEM = "# END";
+
+/**
+ * @brief Check if a temporary file holds a whole song.
+ *
+ * @param tempName The name of the temporary file.
+ * @return If the file ends with SONG_END_LINE.
+ */
+static bool sd_is_save_complete(const char * const tempName) {
+  File tempFile = SD.open(tempName, FILE_READ);
+  char tail[8];
+  const uint32_t size = tempFile.fileSize();
+  const uint8_t length = size < sizeof(tail) ? size : sizeof(tail);
+  tempFile.seekSet(size - length);
+  const bool isRead = tempFile && tempFile.read(tail, length) == length;
+  tempFile.close();
+  // Skip the line ending after the last line.
+  uint8_t end = length;
+  while (end > 0 && (tail[end - 1] == '\r' || tail[end - 1] == '\n')) {
+    end--;
+  }
+  const uint8_t lineLength = sizeof(SONG_END_LINE) - 1;
+  return isRead && end >= lineLength && strncmp_P(tail + end - lineLength, SONG_END_LINE, lineLength) == 0;
+}
+
+/**
+ * @brief Finish or throw away a save which was cut off (ex. power loss) before the temporary file replaced the song.
+ *
+ * @param tempName The name of the temporary file which was left on the SD card.
+ */
+static void sd_recover_save(const char * const tempName) {
+  char songName[13];
+  sd_swap_extension(tempName, FILE_TXT_EXTENSION, songName);
+  // The song was never removed if it still exists. A brand new song has no old version so the end of the file is checked.
+  if (SD.exists(songName) || !sd_is_save_complete(tempName)) {
+    SD.remove(tempName);
+    return;
+  }
+  // The whole new song was synced before the old song (if there was one) was removed.
+  if (SD.rename(tempName, songName)) {
+    File songFile = SD.open(songName, FILE_READ);
+    sd_index_add(songFile);
+    songFile.close();
+  }
+}
+
+void sd_index_build() {
+  songIndex.close();
+  // The index of the last run is kept. Only the entries from the first song which changed on a computer are written again.
+  songIndex = SD.open(SONG_INDEX_FILE, O_RDWR | O_CREAT);
+  const uint32_t indexedCount = songIndex.fileSize() / sizeof(songIndexEntry_t);
+  bool isStale = false;
+  songCount = 0;
+
+  File baseDir = SD.open(ROOT_DIR);
+  baseDir.rewindDirectory();
+  songIndexEntry_t entry;
+  // A save which was cut off leaves its temporary file behind. Only one song is saved at a time so there is at most one.
+  char tempName[13] = "";
+  // The walk goes on after the index is full so a temporary file after the last song is still found.
+  while (true) {
+    File file = baseDir.openNextFile();
+    if (!file) {
+      break;
+    }
+    // The bytes after the name are cleared so the index only changes when a song does.
+    memset(&entry, 0, sizeof(entry));
+    file.getName(entry.name, sizeof(entry.name));
+    if (sd_is_song(file, entry.name)) {
+      if (songCount == MAX_SONG_AMOUNT) {
+        file.close();
+        continue;
+      }
+      entry.dirIndex = file.dirIndex();
+      if (!isStale) {
+        songIndexEntry_t indexed;
+        if (songCount >= indexedCount || songIndex.read(&indexed, sizeof(indexed)) != (int) sizeof(indexed) ||
+          indexed.dirIndex != entry.dirIndex || strcmp(indexed.name, entry.name) != 0) {
+          isStale = true;
+          songIndex.seekSet((uint32_t)songCount * sizeof(songIndexEntry_t));
+        }
+      }
+      if (isStale) {
+        songIndex.write((const uint8_t *) &entry, sizeof(entry));
+      }
+      songCount++;
+    } else if (!file.isDirectory() && strcasestr(entry.name, FILE_TMP_EXTENSION)) {
+      strncpy(tempName, entry.name, sizeof(tempName) - 1);
+    }
+    file.close();
+  }
+  baseDir.close();
+  // Songs which were removed on a computer leave entries after the last song.
+  if (isStale || songCount != indexedCount) {
+    songIndex.truncate((uint32_t)songCount * sizeof(songIndexEntry_t));
+    songIndex.sync();
+    #if DEBUG == true
+    Serial.print(get_active_time());
+    Serial.println(F(" Updated the song index."));
+    #endif
+  }
+
+  if (tempName[0] != '\0') {
+    sd_recover_save(tempName);
+  }
+}
+
+void sd_save_song(const char * const fileName) {
+  // The staged or queued song may be the one which is replaced. Its cache is compiled again the next time it is opened.
+  stagedSong.close();
+  queuedSong.close();
+  // Write the new version of the song next to the old one.
+  char tempName[13];
+  sd_swap_extension(fileName, FILE_TMP_EXTENSION, tempName);
+  File tempFile = SD.open(tempName, O_RDWR | O_CREAT | O_TRUNC);
+  TRACE_EVENT(TRACE_SD_OPEN, prgmSong.get_size());
+  SectorWriter songFile(tempFile);
+
+  songFile.print(F(
+    "# Welcome to a song file!\n"
+    "# To view more information, check out https://github.com/devjluvisi/TuneStudio2560/wiki/For-Users\n"
+    "\n# The delay between each different tone (ms). (Must be 9999 or less and greater than 0)\n"
+    "TONE_DELAY="
+  ));
+  songFile.println(DEFAULT_NOTE_DELAY);
+  songFile.print(F("\n# The length that each tone should play for (ms). (Must be 255 or less and greater than 0)\nTONE_LENGTH="));
+  songFile.println(DEFAULT_NOTE_LENGTH);
+  songFile.println(F("\nData:"));
+
+  // Convert each note in the song to a pitch and save it on the SD. The tracks of a note go on the same line.
+  for (song_size_t i = 0; i < prgmSong.get_size(); i++) {
+    songFile.print(F("  - "));
+    for (uint8_t track = 0; track < prgmSong.get_track_count(); track++) {
+      if (track != 0) {
+        songFile.print(' ');
+      }
+      songFile.print((const __FlashStringHelper *) get_note_pitch_P(prgmSong.get_note(i, track)));
+    }
+    songFile.println();
+  }
+  songFile.print('\n');
+  songFile.println((const __FlashStringHelper *) SONG_END_LINE);
+  const bool written = songFile.finish();
+  tempFile.close();
+  TRACE_EVENT(TRACE_SD_CLOSE, 0);
+  if (!written) {
+    // Keep the previous version of the song.
+    SD.remove(tempName);
+    #if DEBUG == true
+    Serial.print(get_active_time());
+    Serial.println(F(" Failed to write the song to the SD Card."));
+    #endif
+    return;
+  }
+
+  // Only replace the old song once the new one is safely on the card.
+  sd_rem(fileName);
+  if (SD.rename(tempName, fileName)) {
+    File savedFile = SD.open(fileName, FILE_READ);
+    sd_index_add(savedFile);
+    savedFile.close();
+  }
   #if DEBUG == true
   Serial.print(get_active_time());
-  Serial.print(F(" Copied a song ("));
-  Serial.print(fileName);
-  Serial.println(F(") from SD card to memory."));
+  Serial.println(F(" Finished writing with SD Card."));
   #endif
-  return true;
+  return;
+}
+
+void sd_rem(const char * const fileName) {
+  stagedSong.close();
+  queuedSong.close();
+  if (SD.exists(fileName)) {
+    #if DEBUG == true
+    Serial.print(get_active_time());
+    Serial.print(F(" "));
+    Serial.print(fileName);
+    Serial.println(F(" HAS BEEN DELETED FROM SD CARD."));
+    #endif
+    // Delete the old file.
+    SD.remove(fileName);
+    sd_index_remove(fileName);
+    sd_cache_remove(fileName);
+  }
+  return;
+}
+
+void sd_cache_remove(const char * const fileName) {
+  char cachePath[24];
+  sd_cache_path(fileName, cachePath);
+  SD.remove(cachePath);
+}
+
+const char * sd_get_file(uint8_t index) {
+  static songIndexEntry_t entry;
+  if (index >= songCount) {
+    entry.name[0] = '\0';
+    return entry.name;
+  }
+  // Every entry has the same size so the song can be read directly.
+  songIndex.seekSet((uint32_t)index * sizeof(songIndexEntry_t));
+  if (songIndex.read(&entry, sizeof(entry)) != (int) sizeof(entry)) {
+    entry.name[0] = '\0';
+  }
+  return entry.name;
+}
+
+uint8_t sd_get_song_count() {
+  return songCount;
+}
+
+SongOpenStatus sd_song_open_start(const char * const fileName, File & cache, songCacheHeader_t & header) {
+  // Only one song is opened at a time.
+  if (songOpen.cache != nullptr) {
+    sd_song_open_fail();
+  }
+  cache.close();
+
+  // If the file does not exist.
+  if (!SD.exists(fileName)) {
+    return SONG_OPEN_FAILED;
+  }
+
+  // Open a new file to read from.
+  songOpen.entry = SD.open(fileName);
+  songOpen.cache = &cache;
+  songOpen.header = &header;
+
+  // The compiled cache is only used if it was made from the exact same version of the text file.
+  songCacheHeader_t & source = songOpen.source;
+  memset(&source, 0, sizeof(source));
+  source.version = SONG_CACHE_VERSION;
+  source.sourceSize = songOpen.entry.fileSize();
+  songOpen.entry.getModifyDateTime(&source.sourceDate, &source.sourceTime);
+  sd_cache_path(fileName, songOpen.cachePath);
+  cache = SD.open(songOpen.cachePath);
+  if (cache && sd_cache_check(cache, source, header)) {
+    songOpen.phase = OPEN_VERIFY;
+    songOpen.remaining = (uint32_t) header.noteCount * header.trackCount;
+    songOpen.crc = 0xFFFF;
+    return SONG_OPEN_BUSY;
+  }
+  return sd_song_compile_begin();
+}
+
+SongOpenStatus sd_song_open_step(File & cache) {
+  if (songOpen.cache != &cache) {
+    return SONG_OPEN_FAILED;
+  }
+  uint8_t chunk[SONG_OPEN_STEP_SIZE];
+  return sd_song_open_run(chunk, sizeof(chunk));
+}
+
+SongOpenStatus sd_song_open_finish(File & cache) {
+  if (songOpen.cache != &cache) {
+    return SONG_OPEN_FAILED;
+  }
+  // The same small chunk as a step. A whole sector would read no faster (SdFat reads the sector into its own cache either way) but
+  // would put another 512 bytes on the stack next to prgmSong.
+  uint8_t chunk[SONG_OPEN_STEP_SIZE];
+  SongOpenStatus status;
+  do {
+    status = sd_song_open_run(chunk, sizeof(chunk));
+  } while (status == SONG_OPEN_BUSY);
+  return status;
+}
+
+void sd_song_open_cancel(File & cache) {
+  if (songOpen.cache == &cache) {
+    sd_song_open_fail();
+  }
+}
+
+bool sd_song_open(const char * const fileName, File & cache, songCacheHeader_t & header) {
+  SongOpenStatus status = sd_song_open_start(fileName, cache, header);
+  if (status == SONG_OPEN_BUSY) {
+    status = sd_song_open_finish(cache);
+  }
+  return status == SONG_OPEN_DONE;
 }
 
 // FOR DEBUG USE ONLY
@@ -962,11 +1627,15 @@ void sd_make_readme() {
   "The SD card allows users to seemlessly edit, create, and remove songs without having to interact with TuneStudio at all!\n"
   "If you have already created songs then you will find them here.\n"
   "You can edit the songs and create your own but you must follow the standard file format. Two spaces and one hyphen followed by a space and then the tone.\n"
+  "To play up to 4 tones at the same time put them on the same line separated by spaces (ex. \"  - C4 E4 G4\"). Each one is a track.\n"
   "Each SD card also has \"#\" which indicate comments. These comments cannot be read by the device so feel free to put your own \"#\" followed by text to put notes!\n"
   "\n"
   "Remember: \n"
   " - Song must follow correct format.\n"
-  " - Song must have between 8-255 tones.\n"
+  " - Song must have at least 8 tones. Songs made on the device hold up to ";
+  // The limit of the creator mode depends on PRGM_MODE so it is written between the two halves.
+  static const char README_TEXT_END[] PROGMEM =
+  " tones, songs edited on a computer can be longer.\n"
   " - Ensure that tones added are valid and exist.\n"
   " - Follow number paremeters for customizing TONE_DELAY and TONE_LENGTH.\n"
   "\n"
@@ -990,6 +1659,10 @@ void sd_make_readme() {
 
   File readMe = SD.open(README_FILE, FILE_WRITE);
   readMe.print((__FlashStringHelper*)README_TEXT);
+  #if PRGM_MODE != 0
+  readMe.print(MAX_SONG_LENGTH);
+  readMe.print((__FlashStringHelper*)README_TEXT_END);
+  #endif
   readMe.close();
 
   #if DEBUG == true
@@ -997,4 +1670,108 @@ void sd_make_readme() {
   Serial.println(F(" Generated README file."));
   #endif
 
+}
+
+/**
+ * @brief Read the start of the README to check that the card reads correctly.
+ *
+ * @param bytesRead Set to the amount of bytes that were read (at most SPI_PROBE_BYTES).
+ * @return The CRC-CCITT of the bytes that were read.
+ */
+static uint16_t sd_probe_read(uint16_t & bytesRead) {
+  File readMe = SD.open(README_FILE);
+  uint8_t block[SONG_STREAM_BLOCK_SIZE];
+  uint16_t crc = 0xFFFF;
+  bytesRead = 0;
+  while (bytesRead < SPI_PROBE_BYTES) {
+    const int amount = readMe.read(block, sizeof(block));
+    if (amount <= 0) {
+      break;
+    }
+    for (uint8_t i = 0; i < amount; i++) {
+      crc = _crc_ccitt_update(crc, block[i]);
+    }
+    bytesRead += amount;
+  }
+  readMe.close();
+  return crc;
+}
+
+/**
+ * @brief Restart the SD card at an SPI clock and check that it reads the same start of the README as it did at SPI_CLOCK.
+ *
+ * @param clock The SPI clock in hz.
+ * @param expectedCrc The checksum returned by sd_probe_read at SPI_CLOCK.
+ * @param expectedBytes The amount of bytes read by sd_probe_read at SPI_CLOCK.
+ * @return If the card could be started and read correctly. The card is left at the clock either way.
+ */
+static bool sd_try_spi_clock(const uint32_t clock, const uint16_t expectedCrc, const uint16_t expectedBytes) {
+  if (!SD.begin(SD_CS_PIN, SD_SCK_HZ(clock))) {
+    #if DEBUG == true
+    Serial.print(get_active_time());
+    Serial.print(F(" SPI clock "));
+    Serial.print(clock);
+    Serial.println(F("hz could not start the SD card."));
+    #endif
+    return false;
+  }
+  #if DEBUG == true
+  const unsigned long start = micros();
+  #endif
+  uint16_t bytesRead;
+  const bool isValid = sd_probe_read(bytesRead) == expectedCrc && bytesRead == expectedBytes;
+  #if DEBUG == true
+  const unsigned long elapsed = micros() - start;
+  Serial.print(get_active_time());
+  Serial.print(F(" SPI clock "));
+  Serial.print(clock);
+  Serial.print(F("hz read "));
+  Serial.print(bytesRead);
+  Serial.print(F(" bytes at "));
+  // Bytes per millisecond is the same as kilobytes per second.
+  Serial.print(elapsed == 0 ? 0 : bytesRead * 1000UL / elapsed);
+  Serial.println(isValid ? F(" KB/s.") : F(" KB/s (bytes did not match)."));
+  #endif
+  return isValid;
+}
+
+void sd_tune_spi_clock() {
+  uint16_t expectedBytes;
+  const uint16_t expectedCrc = sd_probe_read(expectedBytes);
+  // Nothing to check the faster clocks with so the card stays at SPI_CLOCK.
+  if (expectedBytes == 0) {
+    return;
+  }
+
+  // The clock which was chosen the last time this card was used followed by its complement.
+  uint32_t saved[2];
+  File clockFile = SD.open(SPI_CLOCK_FILE);
+  const bool isSaved = clockFile.read(saved, sizeof(saved)) == (int) sizeof(saved) && saved[0] == ~saved[1];
+  clockFile.close();
+  if (isSaved) {
+    if (saved[0] == SPI_CLOCK_HZ || sd_try_spi_clock(saved[0], expectedCrc, expectedBytes)) {
+      return;
+    }
+    // The card no longer reads correctly at the saved clock so every clock is tried again.
+  }
+
+  uint32_t clock = SPI_CLOCK_HZ;
+  bool isStarted = false;
+  for (uint8_t i = 0; i < sizeof(SPI_PROBE_CLOCKS) / sizeof(SPI_PROBE_CLOCKS[0]); i++) {
+    isStarted = sd_try_spi_clock(SPI_PROBE_CLOCKS[i], expectedCrc, expectedBytes);
+    if (!isStarted) {
+      break;
+    }
+    clock = SPI_PROBE_CLOCKS[i];
+  }
+  // The card was left at a clock which failed.
+  if (!isStarted) {
+    SD.begin(SD_CS_PIN, SD_SCK_HZ(clock));
+  }
+
+  saved[0] = clock;
+  saved[1] = ~clock;
+  clockFile = SD.open(SPI_CLOCK_FILE, O_RDWR | O_CREAT | O_TRUNC);
+  clockFile.write((const uint8_t *) saved, sizeof(saved));
+  clockFile.close();
 }
\ No newline at end of file
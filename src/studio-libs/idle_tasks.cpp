@@ -0,0 +1,88 @@
+/**
+ * @file idle_tasks.cpp
+ * @author Jacob LuVisi
+ * @brief The background tasks run by delay_ms. @see idle_tasks.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/idle_tasks.h>
+
+/** @brief A background task which has been added. */
+typedef struct idleTask {
+  idleTaskStep_t step;
+  void * context;
+  uint16_t budgetUs;
+} idleTask_t;
+
+/** @brief The tasks which have been added (the first idleTaskCount are used). */
+static idleTask_t idleTasks[IDLE_TASK_MAX];
+/** @brief The amount of tasks which have been added. */
+static uint8_t idleTaskCount = 0;
+/** @brief The task which runs next. */
+static uint8_t nextIdleTask = 0;
+/** @brief If a task is running. Stops a step which waits from running the tasks again. */
+static bool isIdleRunning = false;
+
+bool idle_task_add(idleTaskStep_t step, void * context, uint16_t budgetUs) {
+  for (uint8_t i = 0; i < idleTaskCount; i++) {
+    if (idleTasks[i].step == step && idleTasks[i].context == context) {
+      return true;
+    }
+  }
+  if (idleTaskCount == IDLE_TASK_MAX) {
+    return false;
+  }
+  idleTasks[idleTaskCount].step = step;
+  idleTasks[idleTaskCount].context = context;
+  idleTasks[idleTaskCount].budgetUs = budgetUs;
+  idleTaskCount++;
+  return true;
+}
+
+void idle_task_remove(idleTaskStep_t step, void * context) {
+  for (uint8_t i = 0; i < idleTaskCount; i++) {
+    if (idleTasks[i].step == step && idleTasks[i].context == context) {
+      // The order of the tasks does not matter so the last one takes its place.
+      idleTasks[i] = idleTasks[--idleTaskCount];
+      return;
+    }
+  }
+}
+
+bool idle_tasks_run(unsigned long deadline) {
+  if (idleTaskCount == 0 || isIdleRunning) {
+    return false;
+  }
+  if (nextIdleTask >= idleTaskCount) {
+    nextIdleTask = 0;
+  }
+  // Copied because a step may remove its own task.
+  const idleTask_t task = idleTasks[nextIdleTask++];
+
+  // The current millisecond may be almost over so one more is kept spare.
+  if ((long) (deadline - millis()) <= (long) (task.budgetUs / 1000 + 1)) {
+    return false;
+  }
+  isIdleRunning = true;
+  const unsigned long start = micros();
+  unsigned long slowestStep = 0;
+  unsigned long elapsed = 0;
+  do {
+    const unsigned long stepStart = micros();
+    const bool hasWork = task.step(task.context);
+    const unsigned long stepTime = micros() - stepStart;
+    if (stepTime > slowestStep) {
+      slowestStep = stepTime;
+    }
+    elapsed = micros() - start;
+    if (!hasWork) {
+      break;
+    }
+  } while (elapsed + slowestStep <= task.budgetUs);
+  isIdleRunning = false;
+  return true;
+}
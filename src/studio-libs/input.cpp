@@ -0,0 +1,112 @@
+/**
+ * @file input.cpp
+ * @author Jacob LuVisi
+ * @brief The interrupt driven button scanner and event queue. @see input.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/input.h>
+#include <avr/interrupt.h>
+
+// The scan reads the ports directly (same as the pull ups in setup()). For Arduino Mega 2560 ONLY
+static_assert(BTN_TONE_1 == 27 && BTN_TONE_2 == 25 && BTN_TONE_3 == 28 && BTN_TONE_4 == 26 && BTN_TONE_5 == 24,
+  "input_read_buttons() must be changed to match the tone button pins.");
+static_assert(BTN_ADD_SELECT == 2 && BTN_DEL_CANCEL == 3 && BTN_OPTION == 4,
+  "input_read_buttons() must be changed to match the select, cancel and option button pins.");
+
+/** @brief The events which have not been taken by the main loop yet. */
+static volatile inputEvent_t inputQueue[INPUT_QUEUE_SIZE];
+/** @brief Where the interrupt writes the next event. Only changed by the interrupt. */
+static volatile uint8_t inputHead = 0;
+/** @brief Where the main loop reads the next event. Only changed by the main loop. */
+static volatile uint8_t inputTail = 0;
+/** @brief The debounced state of every button (bit n set if InputButton n is held). */
+static volatile uint8_t inputHeld = 0;
+/** @brief How many scans in a row each button has read a different level than inputHeld. Only used by the interrupt. */
+static uint8_t inputChanging[INPUT_BUTTON_COUNT];
+/** @brief How many scans each button has been held for (stops at INPUT_LONG_PRESS_TICKS). Only used by the interrupt. */
+static uint16_t inputHeldTicks[INPUT_BUTTON_COUNT];
+
+/**
+ * @return The raw state of every button (bit n set if InputButton n is down). The buttons are LOW when pressed.
+ */
+static inline uint8_t input_read_buttons() {
+  const uint8_t portA = ~PINA;
+  const uint8_t portE = ~PINE;
+  const uint8_t portG = ~PING;
+  return ((portA >> PORTA5) & 1) << INPUT_TONE_1 |
+    ((portA >> PORTA3) & 1) << INPUT_TONE_2 |
+    ((portA >> PORTA6) & 1) << INPUT_TONE_3 |
+    ((portA >> PORTA4) & 1) << INPUT_TONE_4 |
+    ((portA >> PORTA2) & 1) << INPUT_TONE_5 |
+    ((portE >> PORTE4) & 1) << INPUT_SELECT |
+    ((portE >> PORTE5) & 1) << INPUT_CANCEL |
+    ((portG >> PORTG5) & 1) << INPUT_OPTION;
+}
+
+/**
+ * @brief Add an event to the queue. Only called from the interrupt. The event is dropped if the queue is full.
+ */
+static void input_push(uint8_t type, uint8_t button) {
+  const uint8_t head = inputHead;
+  const uint8_t next = (head + 1) & (INPUT_QUEUE_SIZE - 1);
+  if (next == inputTail) {
+    return;
+  }
+  inputQueue[head].type = type;
+  inputQueue[head].button = button;
+  // Only published after the event is written.
+  inputHead = next;
+}
+
+void input_begin() {
+  // Timer2 is already running (prescaler 64, phase correct PWM) for analogWrite so its overflow is about every 2ms.
+  TIMSK2 |= _BV(TOIE2);
+}
+
+bool input_pop(inputEvent_t &event) {
+  const uint8_t tail = inputTail;
+  if (tail == inputHead) {
+    return false;
+  }
+  event.type = inputQueue[tail].type;
+  event.button = inputQueue[tail].button;
+  inputTail = (tail + 1) & (INPUT_QUEUE_SIZE - 1);
+  return true;
+}
+
+uint8_t input_get_held() {
+  return inputHeld;
+}
+
+ISR(TIMER2_OVF_vect) {
+  const uint8_t raw = input_read_buttons();
+  uint8_t held = inputHeld;
+  for (uint8_t button = 0; button < INPUT_BUTTON_COUNT; button++) {
+    const uint8_t mask = 1 << button;
+    if (!((raw ^ held) & mask)) {
+      inputChanging[button] = 0;
+      if ((held & mask) && inputHeldTicks[button] < INPUT_LONG_PRESS_TICKS && ++inputHeldTicks[button] == INPUT_LONG_PRESS_TICKS) {
+        input_push(INPUT_LONG_PRESS, button);
+      }
+      continue;
+    }
+    if (++inputChanging[button] < INPUT_DEBOUNCE_TICKS) {
+      continue;
+    }
+    inputChanging[button] = 0;
+    held ^= mask;
+    if (!(held & mask)) {
+      input_push(INPUT_RELEASE, button);
+      continue;
+    }
+    inputHeldTicks[button] = 0;
+    const bool isChord = (button == INPUT_SELECT || button == INPUT_CANCEL) && (held & (1 << INPUT_OPTION));
+    input_push(isChord ? INPUT_CHORD : INPUT_PRESS, button);
+  }
+  inputHeld = held;
+}
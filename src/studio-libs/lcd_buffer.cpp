@@ -0,0 +1,84 @@
+/**
+ * @file lcd_buffer.cpp
+ * @author Jacob LuVisi
+ * @brief The shadow framebuffer for the display. @see lcd_buffer.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/lcd_buffer.h>
+
+/** @brief The row that the HD44780 address counter moves to after the last column of each row. */
+static const uint8_t NEXT_ROW[LCD_ROWS] = { 2, 3, 1, 0 };
+
+LcdBuffer::LcdBuffer(uint8_t lcdAddr): _lcd(lcdAddr, LCD_COLS, LCD_ROWS) {
+  memset(_cells, ' ', sizeof(_cells));
+  memset(_shown, ' ', sizeof(_shown));
+  _col = 0;
+  _row = 0;
+}
+
+void LcdBuffer::init() {
+  _lcd.init();
+  memset(_shown, ' ', sizeof(_shown));
+  clear();
+}
+
+void LcdBuffer::backlight() {
+  _lcd.backlight();
+}
+
+void LcdBuffer::createChar(uint8_t location, uint8_t charmap[]) {
+  _lcd.createChar(location, charmap);
+}
+
+void LcdBuffer::clear() {
+  memset(_cells, ' ', sizeof(_cells));
+  _col = 0;
+  _row = 0;
+}
+
+void LcdBuffer::setCursor(uint8_t col, uint8_t row) {
+  _col = col < LCD_COLS ? col : LCD_COLS - 1;
+  _row = row < LCD_ROWS ? row : LCD_ROWS - 1;
+}
+
+size_t LcdBuffer::write(uint8_t value) {
+  _cells[_row][_col] = value;
+  if (++_col == LCD_COLS) {
+    _col = 0;
+    _row = NEXT_ROW[_row];
+  }
+  return 1;
+}
+
+void LcdBuffer::clear_row(uint8_t row) {
+  setCursor(0, row);
+  memset(_cells[_row], ' ', LCD_COLS);
+}
+
+void LcdBuffer::flush() {
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    // If the cursor of the display is already on this cell (the previous cell was just sent).
+    bool inRun = false;
+    for (uint8_t col = 0; col < LCD_COLS; col++) {
+      if (_cells[row][col] == _shown[row][col]) {
+        inRun = false;
+        continue;
+      }
+      if (!inRun) {
+        _lcd.setCursor(col, row);
+        inRun = true;
+      }
+      _lcd.write(_cells[row][col]);
+      _shown[row][col] = _cells[row][col];
+    }
+  }
+}
+
+LiquidCrystal_I2C & LcdBuffer::get_display() {
+  return _lcd;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file pot.cpp
+ * @author Jacob LuVisi
+ * @brief The interrupt driven potentiometer reader. @see pot.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/pot.h>
+#include <avr/interrupt.h>
+
+/** @brief The value which is read by the program. */
+static volatile uint16_t potValue = 0;
+/** @brief If potValue changed since pot_has_changed() was last called. */
+static volatile bool potChanged = true;
+/** @brief The sum of the conversions since the last average. Only used by the interrupt. */
+static uint16_t potSum = 0;
+/** @brief The amount of conversions in potSum. Only used by the interrupt. */
+static uint8_t potSamples = 0;
+
+void pot_begin() {
+  // A single blocking read so there is a value before the first average is ready.
+  potValue = analogRead(TONE_FREQ);
+  potChanged = true;
+
+  const uint8_t channel = TONE_FREQ - PIN_A0;
+  // Reference AVCC (same as analogRead) and the channel of the potentiometer.
+  ADMUX = _BV(REFS0) | (channel & 0x07);
+  // Free running trigger source.
+  ADCSRB = channel & 0x08 ? _BV(MUX5) : 0;
+  // The digital input of the pin is never used and only adds noise.
+  if (channel < 8) {
+    DIDR0 |= _BV(channel);
+  }
+  // Prescaler 128 (125kHz ADC clock) for full accuracy. Auto trigger, interrupt and start the first conversion.
+  ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+uint16_t pot_get_value() {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint16_t value = potValue;
+  SREG = sreg;
+  return value;
+}
+
+bool pot_has_changed() {
+  const uint8_t sreg = SREG;
+  cli();
+  const bool changed = potChanged;
+  potChanged = false;
+  SREG = sreg;
+  return changed;
+}
+
+ISR(ADC_vect) {
+  potSum += ADC;
+  if (++potSamples != POT_OVERSAMPLE) {
+    return;
+  }
+  uint16_t average = potSum / POT_OVERSAMPLE;
+  potSum = 0;
+  potSamples = 0;
+  // Snap to the ends so the hysteresis never keeps the value just short of the first or last tone.
+  if (average < POT_HYSTERESIS) {
+    average = 0;
+  } else if (average > POT_MAX - POT_HYSTERESIS) {
+    average = POT_MAX;
+  }
+  if (average + POT_HYSTERESIS < potValue || average > potValue + POT_HYSTERESIS ||
+    ((average == 0 || average == POT_MAX) && average != potValue)) {
+    potValue = average;
+    potChanged = true;
+  }
+}
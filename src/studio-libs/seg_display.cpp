@@ -0,0 +1,143 @@
+/**
+ * @file seg_display.cpp
+ * @author Jacob LuVisi
+ * @brief The interrupt driven 7-segment display. @see seg_display.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/seg_display.h>
+#include <avr/interrupt.h>
+
+/** @brief The amount of segments which are multiplexed (A to G, the decimal point is never used). */
+constexpr uint8_t SEG_PHASES = 7;
+/** @brief The shift register output (0-7 first register, 8-15 second register) of each digit. Digits are on when LOW. */
+constexpr uint8_t SEG_DIGIT_OUTPUTS[SEG_DIGIT_COUNT] = { 8 + 2, 8 + 5, 8 + 6, 2 };
+/** @brief The shift register output of each segment from A to G. Segments are on when HIGH. */
+constexpr uint8_t SEG_SEGMENT_OUTPUTS[SEG_PHASES] = { 8 + 3, 8 + 7, 4, 6, 7, 8 + 4, 3 };
+
+/**
+ * @return The shift register word which lights one segment of a note.
+ */
+constexpr uint16_t seg_note_word(uint8_t note, uint8_t segment) {
+  return (1U << SEG_SEGMENT_OUTPUTS[segment]) |
+    ((seg_note_glyph(note, 0) >> segment) & 1 ? 0 : 1U << SEG_DIGIT_OUTPUTS[0]) |
+    ((seg_note_glyph(note, 1) >> segment) & 1 ? 0 : 1U << SEG_DIGIT_OUTPUTS[1]) |
+    ((seg_note_glyph(note, 2) >> segment) & 1 ? 0 : 1U << SEG_DIGIT_OUTPUTS[2]) |
+    ((seg_note_glyph(note, 3) >> segment) & 1 ? 0 : 1U << SEG_DIGIT_OUTPUTS[3]);
+}
+
+/** @brief The shift register word which turns every digit off. */
+constexpr uint16_t SEG_BLANK_WORD = (1U << SEG_DIGIT_OUTPUTS[0]) | (1U << SEG_DIGIT_OUTPUTS[1]) | (1U << SEG_DIGIT_OUTPUTS[2]) |
+  (1U << SEG_DIGIT_OUTPUTS[3]);
+
+#define SEG_NOTE_FRAME(note) { seg_note_word(note, 0), seg_note_word(note, 1), seg_note_word(note, 2), seg_note_word(note, 3), \
+  seg_note_word(note, 4), seg_note_word(note, 5), seg_note_word(note, 6) }
+
+/** @brief The row of SEG_FRAMES which shows the pause note. */
+constexpr uint8_t SEG_FRAME_PAUSE = PROGRAM_NOTE_AMOUNT;
+/** @brief The row of SEG_FRAMES which shows the empty note. */
+constexpr uint8_t SEG_FRAME_EMPTY = PROGRAM_NOTE_AMOUNT + 1;
+/** @brief The row of SEG_FRAMES which shows nothing. */
+constexpr uint8_t SEG_FRAME_BLANK = PROGRAM_NOTE_AMOUNT + 2;
+
+/** @brief The words which the interrupt shifts out for every note (one row per note, one word per segment). */
+static const uint16_t SEG_FRAMES[PROGRAM_NOTE_AMOUNT + 3][SEG_PHASES] PROGMEM = {
+  SEG_NOTE_FRAME(0), SEG_NOTE_FRAME(1), SEG_NOTE_FRAME(2), SEG_NOTE_FRAME(3), SEG_NOTE_FRAME(4), SEG_NOTE_FRAME(5),
+  SEG_NOTE_FRAME(6), SEG_NOTE_FRAME(7), SEG_NOTE_FRAME(8), SEG_NOTE_FRAME(9), SEG_NOTE_FRAME(10), SEG_NOTE_FRAME(11),
+  SEG_NOTE_FRAME(12), SEG_NOTE_FRAME(13), SEG_NOTE_FRAME(14), SEG_NOTE_FRAME(15), SEG_NOTE_FRAME(16), SEG_NOTE_FRAME(17),
+  SEG_NOTE_FRAME(18), SEG_NOTE_FRAME(19), SEG_NOTE_FRAME(20), SEG_NOTE_FRAME(21), SEG_NOTE_FRAME(22), SEG_NOTE_FRAME(23),
+  SEG_NOTE_FRAME(24), SEG_NOTE_FRAME(25), SEG_NOTE_FRAME(26), SEG_NOTE_FRAME(27), SEG_NOTE_FRAME(28), SEG_NOTE_FRAME(29),
+  SEG_NOTE_FRAME(30), SEG_NOTE_FRAME(31), SEG_NOTE_FRAME(32), SEG_NOTE_FRAME(33), SEG_NOTE_FRAME(34), SEG_NOTE_FRAME(35),
+  SEG_NOTE_FRAME(36), SEG_NOTE_FRAME(37), SEG_NOTE_FRAME(38), SEG_NOTE_FRAME(39), SEG_NOTE_FRAME(40), SEG_NOTE_FRAME(41),
+  SEG_NOTE_FRAME(42), SEG_NOTE_FRAME(43), SEG_NOTE_FRAME(44), SEG_NOTE_FRAME(45), SEG_NOTE_FRAME(46), SEG_NOTE_FRAME(47),
+  SEG_NOTE_FRAME(48), SEG_NOTE_FRAME(49), SEG_NOTE_FRAME(50), SEG_NOTE_FRAME(51), SEG_NOTE_FRAME(52), SEG_NOTE_FRAME(53),
+  SEG_NOTE_FRAME(54), SEG_NOTE_FRAME(55), SEG_NOTE_FRAME(56), SEG_NOTE_FRAME(57), SEG_NOTE_FRAME(58), SEG_NOTE_FRAME(59),
+  SEG_NOTE_FRAME(60), SEG_NOTE_FRAME(61), SEG_NOTE_FRAME(62), SEG_NOTE_FRAME(63), SEG_NOTE_FRAME(64), SEG_NOTE_FRAME(65),
+  SEG_NOTE_FRAME(66), SEG_NOTE_FRAME(67), SEG_NOTE_FRAME(68), SEG_NOTE_FRAME(69), SEG_NOTE_FRAME(70), SEG_NOTE_FRAME(71),
+  SEG_NOTE_FRAME(72), SEG_NOTE_FRAME(73), SEG_NOTE_FRAME(74), SEG_NOTE_FRAME(75), SEG_NOTE_FRAME(76), SEG_NOTE_FRAME(77),
+  SEG_NOTE_FRAME(78), SEG_NOTE_FRAME(79), SEG_NOTE_FRAME(80), SEG_NOTE_FRAME(81), SEG_NOTE_FRAME(82), SEG_NOTE_FRAME(83),
+  SEG_NOTE_FRAME(84),
+  SEG_NOTE_FRAME(PAUSE_NOTE_INDEX),
+  SEG_NOTE_FRAME(EMPTY_NOTE_INDEX),
+  { SEG_BLANK_WORD, SEG_BLANK_WORD, SEG_BLANK_WORD, SEG_BLANK_WORD, SEG_BLANK_WORD, SEG_BLANK_WORD, SEG_BLANK_WORD }
+};
+static_assert(PROGRAM_NOTE_AMOUNT == 85, "SEG_FRAMES must have one SEG_NOTE_FRAME for every note in PROGRAM_NOTES.");
+
+/** @brief The row of SEG_FRAMES which the interrupt shows. Only changed with interrupts off. */
+static const uint16_t * volatile segFrame = SEG_FRAMES[SEG_FRAME_BLANK];
+/** @brief The segment which the interrupt lights next. */
+static volatile uint8_t segPhase = 0;
+
+/**
+ * @brief Shift a word out to both shift registers (second register first) and latch it.
+ * @remark SHCP and STCP are always left LOW so an interrupted read-modify-write of their port in the main loop cannot change them.
+ */
+static void seg_shift_out(uint16_t word) {
+  for (uint8_t i = 0; i < 16; i++) {
+    if (word & 0x8000) {
+      digitalWriteFast(SHIFT_PIN_DS, HIGH);
+    } else {
+      digitalWriteFast(SHIFT_PIN_DS, LOW);
+    }
+    digitalWriteFast(SHIFT_PIN_SHCP, HIGH);
+    digitalWriteFast(SHIFT_PIN_SHCP, LOW);
+    word <<= 1;
+  }
+  digitalWriteFast(SHIFT_PIN_STCP, HIGH);
+  digitalWriteFast(SHIFT_PIN_STCP, LOW);
+}
+
+/**
+ * @brief Change the row of SEG_FRAMES which is shown.
+ */
+static void seg_show_frame(uint8_t frame) {
+  const uint8_t sreg = SREG;
+  cli();
+  segFrame = SEG_FRAMES[frame];
+  SREG = sreg;
+}
+
+void seg_begin() {
+  pinModeFast(SHIFT_PIN_DS, OUTPUT);
+  pinModeFast(SHIFT_PIN_SHCP, OUTPUT);
+  pinModeFast(SHIFT_PIN_STCP, OUTPUT);
+  seg_shift_out(SEG_BLANK_WORD);
+  // Compare A fires once every Timer0 overflow. Placed between the overflow (millis) and compare B (the sequencer) so the
+  // interrupts do not run back to back.
+  OCR0A = 0x40;
+  TIMSK0 |= _BV(OCIE0A);
+}
+
+void seg_show_note(uint8_t note) {
+  seg_show_frame(note < PROGRAM_NOTE_AMOUNT ? note : note == PAUSE_NOTE_INDEX ? SEG_FRAME_PAUSE : SEG_FRAME_EMPTY);
+}
+
+void seg_blank() {
+  seg_show_frame(SEG_FRAME_BLANK);
+}
+
+uint8_t seg_get_glyph(uint8_t digit) {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint16_t * const frame = segFrame;
+  SREG = sreg;
+  uint8_t glyph = 0;
+  for (uint8_t segment = 0; segment < SEG_PHASES; segment++) {
+    // The digit shows the segment if it is turned on (LOW) while the segment is lit.
+    if (!(pgm_read_word(&frame[segment]) & (1U << SEG_DIGIT_OUTPUTS[digit]))) {
+      glyph |= 1 << segment;
+    }
+  }
+  return glyph;
+}
+
+ISR(TIMER0_COMPA_vect) {
+  seg_shift_out(pgm_read_word(&segFrame[segPhase]));
+  if (++segPhase == SEG_PHASES) {
+    segPhase = 0;
+  }
+}
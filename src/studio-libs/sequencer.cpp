@@ -0,0 +1,196 @@
+/**
+ * @file sequencer.cpp
+ * @author Jacob LuVisi
+ * @brief The interrupt driven note sequencer. @see sequencer.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/sequencer.h>
+#include <studio-libs/voices.h>
+#include <avr/interrupt.h>
+#include <debug/trace.h>
+
+/** @brief What the sequencer is currently doing. */
+enum SequencerStatus: uint8_t {
+  /** @brief Waiting for the deadline of the next note. */
+  SEQUENCER_WAITING,
+  /** @brief The notes of a step are playing until the deadline. */
+  SEQUENCER_NOTE_ON,
+  /** @brief A rest (every track is PAUSE_NOTE_INDEX) lasts until the deadline. */
+  SEQUENCER_RESTING
+};
+
+/** @brief The steps which have been fed but not played (one note per track). Written by the main loop and read by the interrupt. */
+static volatile uint8_t noteQueue[SEQUENCER_QUEUE_SIZE][SONG_MAX_TRACKS];
+/** @brief The position where the next note is fed. Only changed by the main loop (or with interrupts off). */
+static volatile uint8_t queueHead = 0;
+/** @brief The position of the next note to play. Only changed by the interrupt (or with interrupts off). */
+static volatile uint8_t queueTail = 0;
+static volatile SequencerStatus status = SEQUENCER_WAITING;
+/** @brief The voices started by the current step (bit n set if voice n is playing). */
+static volatile uint8_t stepVoices = 0;
+static volatile bool isPaused = false;
+/** @brief The time (millis) that the next event is due at. */
+static volatile unsigned long deadline = 0;
+static volatile uint16_t notesPlayed = 0;
+static volatile uint16_t sequencerDelay = DEFAULT_NOTE_DELAY;
+static volatile uint8_t sequencerLength = DEFAULT_NOTE_LENGTH;
+/** @brief If the timing changes when the step in timingChangeSlot starts. @see sequencer_feed_timing */
+static volatile bool hasTimingChange = false;
+/** @brief The position in the queue of the step which the timing changes at. */
+static volatile uint8_t timingChangeSlot = 0;
+static volatile uint16_t changedDelay = DEFAULT_NOTE_DELAY;
+static volatile uint8_t changedLength = DEFAULT_NOTE_LENGTH;
+
+void sequencer_begin() {
+  // Compare B fires once every Timer0 overflow (~1.024ms). The value only sets where in the period it happens.
+  OCR0B = 0x80;
+  TIMSK0 |= _BV(OCIE0B);
+}
+
+void sequencer_set_timing(uint16_t noteDelay, uint8_t noteLength) {
+  const uint8_t sreg = SREG;
+  cli();
+  sequencerDelay = noteDelay;
+  sequencerLength = noteLength;
+  SREG = sreg;
+}
+
+bool sequencer_feed_timing(uint16_t noteDelay, uint8_t noteLength) {
+  const uint8_t sreg = SREG;
+  cli();
+  if (hasTimingChange) {
+    SREG = sreg;
+    return false;
+  }
+  changedDelay = noteDelay;
+  changedLength = noteLength;
+  // The next step is always fed into the head of the queue.
+  timingChangeSlot = queueHead;
+  hasTimingChange = true;
+  SREG = sreg;
+  return true;
+}
+
+bool sequencer_feed(const uint8_t * notes, uint8_t amount) {
+  const uint8_t next = (queueHead + 1) & (SEQUENCER_QUEUE_SIZE - 1);
+  if (next == queueTail) {
+    return false;
+  }
+  for (uint8_t track = 0; track < SONG_MAX_TRACKS; track++) {
+    noteQueue[queueHead][track] = track < amount ? notes[track] : EMPTY_NOTE_INDEX;
+  }
+  queueHead = next;
+  return true;
+}
+
+/**
+ * @brief Stop every voice of the current step. Only called with interrupts off.
+ */
+static void sequencer_stop_step() {
+  const uint8_t voices = stepVoices;
+  for (uint8_t voice = 0; voice < VOICE_COUNT; voice++) {
+    if (voices & (1 << voice)) {
+      voice_stop(voice);
+      TRACE_EVENT(TRACE_NOTE_OFF, voice << 8);
+    }
+  }
+  stepVoices = 0;
+}
+
+void sequencer_clear() {
+  // The sequencer interrupt reads the queue so it is emptied with interrupts off. Only called from the main loop.
+  const uint8_t sreg = SREG;
+  cli();
+  if (status == SEQUENCER_NOTE_ON) {
+    sequencer_stop_step();
+  }
+  status = SEQUENCER_WAITING;
+  queueHead = 0;
+  queueTail = 0;
+  hasTimingChange = false;
+  notesPlayed = 0;
+  deadline = millis();
+  SREG = sreg;
+}
+
+void sequencer_pause(bool paused) {
+  const uint8_t sreg = SREG;
+  cli();
+  if (paused && status != SEQUENCER_WAITING) {
+    if (status == SEQUENCER_NOTE_ON) {
+      sequencer_stop_step();
+    }
+    status = SEQUENCER_WAITING;
+    notesPlayed++;
+  }
+  isPaused = paused;
+  deadline = millis();
+  SREG = sreg;
+}
+
+uint16_t sequencer_get_played() {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint16_t played = notesPlayed;
+  SREG = sreg;
+  return played;
+}
+
+ISR(TIMER0_COMPB_vect) {
+  if (isPaused) {
+    return;
+  }
+  const unsigned long now = millis();
+  if ((long) (now - deadline) < 0) {
+    return;
+  }
+  // The current note (or rest) has finished. Wait for the note delay before the next one.
+  if (status != SEQUENCER_WAITING) {
+    if (status == SEQUENCER_NOTE_ON) {
+      sequencer_stop_step();
+    }
+    status = SEQUENCER_WAITING;
+    notesPlayed++;
+    deadline += sequencerDelay;
+    return;
+  }
+  if (queueTail == queueHead) {
+    // Nothing has been fed yet. The next note starts as soon as it is.
+    deadline = now;
+    return;
+  }
+  if (hasTimingChange && queueTail == timingChangeSlot) {
+    sequencerDelay = changedDelay;
+    sequencerLength = changedLength;
+    hasTimingChange = false;
+  }
+  volatile uint8_t * const notes = noteQueue[queueTail];
+  queueTail = (queueTail + 1) & (SEQUENCER_QUEUE_SIZE - 1);
+  uint8_t voices = 0;
+  for (uint8_t track = 0; track < SONG_MAX_TRACKS; track++) {
+    const uint8_t note = notes[track];
+    if (note >= PROGRAM_NOTE_AMOUNT) {
+      continue;
+    }
+    // Each note takes the lowest free voice so a single track always plays on SPEAKER_1.
+    const uint8_t voice = voice_start(get_note_frequency(note));
+    if (voice < VOICE_COUNT) {
+      voices |= 1 << voice;
+      TRACE_EVENT(TRACE_NOTE_ON, note | voice << 8);
+    }
+  }
+  stepVoices = voices;
+  if (voices) {
+    status = SEQUENCER_NOTE_ON;
+    deadline += sequencerLength;
+  } else {
+    // Rests (and notes which could not be read) are silent for PAUSE_DELAY.
+    status = SEQUENCER_RESTING;
+    deadline += PAUSE_DELAY;
+  }
+}
@@ -7,13 +7,16 @@
  *
  * @copyright Copyright (c) 2021
  *
- * NOTE: Every song object created takes the same amount of SRAM [for max length 255] regardless of the number of notes and
+ * NOTE: Every song object created takes the same amount of SRAM [for max length 510] regardless of the number of notes and
  * empty spaces in the song. Increasing the maximum number of notes may increase the size of the objects.
  *
  */
 
 #include <studio-libs/song.h>
 #include <studio-libs/tune_studio.h>
+#include <studio-libs/sequencer.h>
+#include <debug/trace.h>
+#include <debug/stack_watch.h>
 
 
 template <> Song<MAX_SONG_LENGTH>::Song(uint8_t pin, uint8_t noteLength, uint16_t noteDelay) {
@@ -25,60 +28,58 @@ template <> Song<MAX_SONG_LENGTH>::Song(uint8_t pin, uint8_t noteLength, uint16_
     _noteDelay = noteDelay;
     _noteLength = noteLength;
     _currSize = 0;
-    _songData[MAX_SONG_LENGTH] = {EMPTY_NOTE.frequency};
+    memset(_songData, EMPTY_NOTE_INDEX, sizeof(_songData));
 }
 
 template<> song_size_t Song<MAX_SONG_LENGTH>::get_size() {
     return _currSize;
 }
 
-template <> void Song<MAX_SONG_LENGTH>::play_note(uint16_t note) {
+template <> void Song<MAX_SONG_LENGTH>::play_note(uint8_t note) {
+    const uint16_t frequency = get_note_frequency(note);
 #if DEBUG == true
     Serial.print(get_active_time());
     Serial.print(F(" song.cpp >> Playing note: "));
-    Serial.println(note);
+    Serial.println(frequency);
 #endif
     // Since v1.1.0-R2
     // Check NewTone lib for details: https://bitbucket.org/teckel12/arduino-new-tone/src/master/
-    NewTone(_pin, note);
+    NewTone(_pin, frequency);
+    TRACE_EVENT(TRACE_NOTE_ON, note);
 }
 
 template<> bool Song<MAX_SONG_LENGTH>::is_song_full() {
-    // Check if the final value in the array is zero. If so we know it is not full since 0's represent empty values in
-    // an integer array.
-    return _songData[MAX_SONG_LENGTH - 1] != EMPTY_NOTE.frequency;
+    return get_size() == MAX_SONG_LENGTH;
 }
-template<> void Song<MAX_SONG_LENGTH>::add_note(uint16_t note) {
-    if (is_song_full() || note == EMPTY_NOTE.frequency) return;
-    _songData[get_size()] = note;
-    _currSize++;
+template<> void Song<MAX_SONG_LENGTH>::add_note(uint8_t note) {
+    if (is_song_full() || note == EMPTY_NOTE_INDEX) return;
+    _songData[_currSize++] = note;
 }
 template<> void Song<MAX_SONG_LENGTH>::add_pause() {
-    add_note(PAUSE_NOTE.frequency);
+    add_note(PAUSE_NOTE_INDEX);
 }
 template<> void Song<MAX_SONG_LENGTH>::remove_note() {
-    _songData[get_size() - 1] = EMPTY_NOTE.frequency;
     _currSize--;
+    _songData[get_size()] = EMPTY_NOTE_INDEX;
 }
 template<> void Song<MAX_SONG_LENGTH>::play_song() {
-    
+    STACK_WATCH_BEGIN(STACK_OP_PLAYBACK);
+    sequencer_clear();
+    sequencer_set_timing(_noteDelay, _noteLength);
+    sequencer_pause(false);
     song_size_t songIndex = 0;
-    // While the song index is not empty and does not equal the maximum length allowed.
-    while (songIndex != get_size()) {
-        if (_songData[songIndex] == PAUSE_NOTE.frequency) {
-            delay_ms(PAUSE_DELAY); // Delay the song from continuing for a certain amount of time.
-            songIndex++; // Go to the next index of the song.
-            continue; // Go to the next iteration of the loop.
+    // Keep the queue of the sequencer full until every note has been played.
+    while (sequencer_get_played() != get_size() && !is_interrupt()) {
+        while (songIndex != get_size() && sequencer_feed(&_songData[songIndex], 1)) {
+            songIndex++;
         }
-        play_note(_songData[songIndex]);
-        delay_ms(_noteLength);
-        noNewTone(_pin);
-        delay_ms(_noteDelay);
-        songIndex++;
+        delay_ms(1);
     }
+    sequencer_clear();
+    STACK_WATCH_END(STACK_OP_PLAYBACK);
 }
 template<> void Song<MAX_SONG_LENGTH>::clear() {
-    memset(_songData, EMPTY_NOTE.frequency, sizeof(_songData));
+    memset(_songData, EMPTY_NOTE_INDEX, sizeof(_songData));
     _currSize = 0;
     #if DEBUG == true
     Serial.print(get_active_time());
@@ -86,12 +87,16 @@ template<> void Song<MAX_SONG_LENGTH>::clear() {
     #endif
 }
 
-template<> uint16_t Song<MAX_SONG_LENGTH>::get_note(song_size_t index) {
-    return _songData[index];
+template<> uint8_t Song<MAX_SONG_LENGTH>::get_note(song_size_t index, uint8_t track) {
+    return track == 0 ? _songData[index] : EMPTY_NOTE_INDEX;
 }
 
 template<> bool Song<MAX_SONG_LENGTH>::is_empty() {
-    return _songData[0] == EMPTY_NOTE.frequency;
+    return get_size() == 0;
+}
+
+template<> uint8_t Song<MAX_SONG_LENGTH>::get_track_count() {
+    return 1;
 }
 
 template<> void Song<MAX_SONG_LENGTH>::set_attributes(uint8_t noteLength, uint16_t noteDelay) {
@@ -0,0 +1,164 @@
+/**
+ * @file song_stream.cpp
+ * @author Jacob LuVisi
+ * @brief Streams the notes of a song from its compiled cache in two blocks. @see song_stream.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/song_stream.h>
+#include <debug/trace.h>
+#include <debug/stack_watch.h>
+
+SongStream stagedSong;
+SongStream queuedSong;
+
+SongStream::SongStream() {
+  memset(&_header, 0, sizeof(_header));
+  _fileName[0] = '\0';
+  _isOpening = false;
+  _blockNumber[0] = NO_BLOCK;
+  _blockNumber[1] = NO_BLOCK;
+}
+
+SongStream::~SongStream() {
+  close();
+}
+
+bool SongStream::open(const char * const fileName) {
+  STACK_WATCH_BEGIN(STACK_OP_OPEN);
+  if ((is_opening(fileName) || open_begin(fileName)) && _isOpening) {
+    open_status(sd_song_open_finish(_file));
+  }
+  STACK_WATCH_END(STACK_OP_OPEN);
+  return is_open(fileName);
+}
+
+bool SongStream::open_begin(const char * const fileName) {
+  close();
+  strncpy(_fileName, fileName, sizeof(_fileName) - 1);
+  _fileName[sizeof(_fileName) - 1] = '\0';
+  _isOpening = true;
+  open_status(sd_song_open_start(fileName, _file, _header));
+  return _isOpening || _file;
+}
+
+bool SongStream::open_step() {
+  if (!_isOpening) {
+    return false;
+  }
+  open_status(sd_song_open_step(_file));
+  return _isOpening;
+}
+
+void SongStream::open_status(SongOpenStatus status) {
+  if (status == SONG_OPEN_BUSY) {
+    return;
+  }
+  _isOpening = false;
+  if (status == SONG_OPEN_DONE) {
+    TRACE_EVENT(TRACE_SD_OPEN, _header.noteCount);
+    if (load_block(0)) {
+      return;
+    }
+    close();
+  } else {
+    TRACE_EVENT(TRACE_SD_OPEN, 0);
+  }
+  // A song which could not be opened has no notes.
+  memset(&_header, 0, sizeof(_header));
+  _fileName[0] = '\0';
+}
+
+bool SongStream::is_open(const char * const fileName) {
+  return _file && !_isOpening && strcmp(_fileName, fileName) == 0;
+}
+
+bool SongStream::is_opening(const char * const fileName) {
+  return _isOpening && strcmp(_fileName, fileName) == 0;
+}
+
+void SongStream::close() {
+  if (_isOpening) {
+    // The cache of the song is closed (and deleted if it was only partly compiled).
+    sd_song_open_cancel(_file);
+    _isOpening = false;
+  }
+  if (_file) {
+    TRACE_EVENT(TRACE_SD_CLOSE, 0);
+  }
+  _file.close();
+  _fileName[0] = '\0';
+  _blockNumber[0] = NO_BLOCK;
+  _blockNumber[1] = NO_BLOCK;
+}
+
+bool SongStream::load_block(song_size_t block) {
+  const uint32_t start = (uint32_t) block * SONG_STREAM_BLOCK_SIZE;
+  const uint32_t size = (uint32_t) _header.noteCount * _header.trackCount;
+  if (start >= size) {
+    return false;
+  }
+  const uint8_t slot = block & 1;
+  const uint8_t amount = size - start < SONG_STREAM_BLOCK_SIZE ? size - start : SONG_STREAM_BLOCK_SIZE;
+  // Blocks are usually read one after another so the file is often already in the right position.
+  const uint32_t position = sizeof(songCacheHeader_t) + start;
+  if (_file.curPosition() != position) {
+    _file.seekSet(position);
+  }
+  if (_file.read(_blocks[slot], amount) != (int) amount) {
+    _blockNumber[slot] = NO_BLOCK;
+    return false;
+  }
+  _blockNumber[slot] = block;
+  #if DEBUG == true
+  Serial.print(get_active_time());
+  Serial.print(F(" song_stream.cpp >> Loaded block: "));
+  Serial.println(block);
+  #endif
+  return true;
+}
+
+uint8_t SongStream::get_note(song_size_t index, uint8_t track) {
+  if (index >= _header.noteCount || track >= _header.trackCount) {
+    return EMPTY_NOTE_INDEX;
+  }
+  const uint32_t position = (uint32_t) index * _header.trackCount + track;
+  const song_size_t block = position / SONG_STREAM_BLOCK_SIZE;
+  if (_blockNumber[block & 1] != block && !load_block(block)) {
+    return EMPTY_NOTE_INDEX;
+  }
+  return _blocks[block & 1][position % SONG_STREAM_BLOCK_SIZE];
+}
+
+void SongStream::get_step(song_size_t index, uint8_t * notes) {
+  for (uint8_t track = 0; track < _header.trackCount; track++) {
+    notes[track] = get_note(index, track);
+  }
+}
+
+void SongStream::prefetch(song_size_t index) {
+  const song_size_t block = (uint32_t) index * _header.trackCount / SONG_STREAM_BLOCK_SIZE + 1;
+  if (_blockNumber[block & 1] != block) {
+    load_block(block);
+  }
+}
+
+song_size_t SongStream::get_size() {
+  return _header.noteCount;
+}
+
+uint8_t SongStream::get_track_count() {
+  return _header.trackCount == 0 ? 1 : _header.trackCount;
+}
+
+uint16_t SongStream::get_note_delay() {
+  return _header.noteDelay;
+}
+
+uint8_t SongStream::get_note_length() {
+  return _header.noteLength;
+}
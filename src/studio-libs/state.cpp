@@ -11,6 +11,7 @@
 
 #include <studio-libs/state.h>
 #include <studio-libs/tune_studio.h>
+#include <studio-libs/seg_display.h>
 
 ProgramState::ProgramState(StateID stateId) {
     this->_stateId = stateId;
@@ -32,7 +33,7 @@ void ProgramState::execute() {
         
         // Execute these instructions before every initalization
 
-        segDisplay.blank();
+        seg_blank();
         lcd.clear(); // Remove all information from the previous state.
 
         this->init();
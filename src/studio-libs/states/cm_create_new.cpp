@@ -11,6 +11,8 @@
  */
 
 #include <studio-libs/states/states.h>
+#include <debug/trace.h>
+#include <debug/stack_watch.h>
 
 CreatorModeCreateNew::CreatorModeCreateNew(): ProgramState::ProgramState(CM_CREATE_NEW) {}
 CreatorModeCreateNew::~CreatorModeCreateNew() {}
@@ -58,15 +60,14 @@ void CreatorModeCreateNew::loop() {
     }
   }
   // Create a note from the last tune button which was pressed.
-  const note_t currentNote = optionWaiting && lastButtonPress == BTN_TONE_2 ? PAUSE_NOTE : get_current_tone(lastButtonPress);
+  const uint8_t currentNote = optionWaiting && lastButtonPress == BTN_TONE_2 ? PAUSE_NOTE_INDEX : get_current_tone(lastButtonPress);
   // If the previous note was the pause note then disable the option waiting as it has been used.
 
-  segDisplay.refreshDisplay();
+  // Only changes which row of the note table the display interrupt reads.
+  seg_show_note(currentNote);
 
   if (millis() - previousUpdate > 100) {
     previousUpdate = millis();
-    segDisplay.setChars(currentNote.pitch);
-    segDisplay.refreshDisplay();
     if (optionWaiting) {
       #if PRGM_MODE == 0
       digitalWriteFast(RGB_BLUE, HIGH);
@@ -82,8 +83,9 @@ void CreatorModeCreateNew::loop() {
     }
   }
   // Add a tune if the button to add/select is pressed.
-  if (is_pressed(BTN_ADD_SELECT)) {
-    if (optionWaiting && currentNote.frequency != PAUSE_NOTE.frequency) {
+  // Holding OPTION while pressing SELECT or DEL is a chord. OPTION was already toggled by its own press so it is the same as a press.
+  if (is_pressed(BTN_ADD_SELECT) || is_chord_pressed(BTN_ADD_SELECT)) {
+    if (optionWaiting && currentNote != PAUSE_NOTE_INDEX) {
       // SAVE SONG.
       if (prgmSong.get_size() < MIN_SONG_LENGTH) {
         lcd.clear();
@@ -130,7 +132,9 @@ void CreatorModeCreateNew::loop() {
       char tempBuff[14];
       memcpy(tempBuff, buffer, sizeof(tempBuff));
 
+      STACK_WATCH_BEGIN(STACK_OP_SAVE);
       sd_save_song(tempBuff);
+      STACK_WATCH_END(STACK_OP_SAVE);
 
       #if DEBUG == true
       Serial.print(get_active_time());
@@ -145,10 +149,11 @@ void CreatorModeCreateNew::loop() {
       print_song_lcd();
       return;
     }
-    // Add the note if the user was not trying to save.
-    prgmSong.add_note(currentNote.frequency);
-    this -> print_song_lcd();
-  } else if (is_pressed(BTN_DEL_CANCEL)) {
+    // Add the note if the user was not trying to save. The note always goes on the last row so only that row is printed.
+    add_song_note(currentNote);
+    print_song_header();
+    print_song_row(rowCount - 1);
+  } else if (is_pressed(BTN_DEL_CANCEL) || is_chord_pressed(BTN_DEL_CANCEL)) {
     // Exit the state.
     if (optionWaiting) {
       #if PRGM_MODE == 0
@@ -161,16 +166,20 @@ void CreatorModeCreateNew::loop() {
     }
     // If the song still has notes remaining.
     if (prgmSong.get_size() != 0) {
-      prgmSong.remove_note();
-      this -> print_song_lcd();
+      // The last row is cleared if its only note was removed.
+      const uint8_t lastRow = rowCount - 1;
+      remove_song_note();
+      print_song_header();
+      print_song_row(lastRow);
     }
 
   }
 
   if (playSound) {
-    prgmSong.play_note(currentNote.frequency);
+    prgmSong.play_note(currentNote);
     delay_ms(200);
     noNewTone(SPEAKER_1);
+    TRACE_EVENT(TRACE_NOTE_OFF, 0);
     // Eliminates static noise
     pinModeFast(SPEAKER_1, INPUT);
     playSound = false;
@@ -187,11 +196,11 @@ void CreatorModeCreateNew::init() {
     lcd.print(F("[SONG]"));
   }
   
-  segDisplay.setBrightness(-100);
-
   previousUpdate = 0;
   lastButtonPress = 0;
   scrolledLines = 0;
+  rowCount = 0;
+  lastRowColumns = 0;
   optionWaiting = false;
   playSound = false;
   // Eliminates static noise
@@ -200,10 +209,61 @@ void CreatorModeCreateNew::init() {
 }
 
 /**
- * @brief Prints the current song data onto the LCD display.
+ * @return The amount of lcd columns the pitch of a note takes.
+ */
+static uint8_t get_pitch_columns(uint8_t note) {
+  return strlen_P(get_note_pitch_P(note));
+}
+
+void CreatorModeCreateNew::add_song_note(uint8_t note) {
+  const song_size_t index = prgmSong.get_size();
+  prgmSong.add_note(note);
+  if (prgmSong.get_size() == index) {
+    return;
+  }
+  const uint8_t pitchSize = get_pitch_columns(note);
+  // Start a new row if the pitch would overflow the last one.
+  if (rowCount == 0 || lastRowColumns + pitchSize > LCD_COLS) {
+    rowStarts[rowCount++] = index;
+    lastRowColumns = 0;
+  }
+  lastRowColumns += pitchSize;
+}
+
+void CreatorModeCreateNew::remove_song_note() {
+  const song_size_t songSize = prgmSong.get_size();
+  if (songSize == 0) {
+    return;
+  }
+  lastRowColumns -= get_pitch_columns(prgmSong.get_note(songSize - 1));
+  prgmSong.remove_note();
+  if (rowStarts[rowCount - 1] != songSize - 1) {
+    return;
+  }
+  // The last row is empty. The row before it holds at most ten pitches so adding them up again is still constant time.
+  rowCount--;
+  lastRowColumns = 0;
+  if (rowCount != 0) {
+    for (song_size_t i = rowStarts[rowCount - 1]; i < songSize - 1; i++) {
+      lastRowColumns += get_pitch_columns(prgmSong.get_note(i));
+    }
+  }
+}
+
+/**
+ * @brief Prints the current song data onto the LCD display. Only the rows which are scrolled onto the LCD are read.
  *
  */
 void CreatorModeCreateNew::print_song_lcd() {
+  lcd.clear();
+  print_song_header();
+  // -1 for the top [Song] header.
+  for (uint8_t lcdRow = 1; lcdRow < LCD_ROWS; lcdRow++) {
+    print_song_row(scrolledLines + lcdRow - 1);
+  }
+}
+
+void CreatorModeCreateNew::print_song_header() {
   const song_size_t songSize = prgmSong.get_size();
 
   // Setup the top row of the display.
@@ -215,7 +275,7 @@ void CreatorModeCreateNew::print_song_lcd() {
       sprintf(buffer, "[SONG] ([%d] %d/%d)", scrolledLines+1, songSize, MAX_SONG_LENGTH);
   */
 
-  lcd.clear();
+  lcd.clear_row(0);
   // Attempt to prevent character overflowing by changing [SONG] to [x] if there are two many detected characters.
   if(MAX_SONG_LENGTH >= 1000 || (songSize >= 100 && scrolledLines >= 10)) {
     lcd.print(F("["));
@@ -231,37 +291,21 @@ void CreatorModeCreateNew::print_song_lcd() {
   lcd.print(F("/"));
   lcd.print(MAX_SONG_LENGTH);
   lcd.print(F(")"));
+}
 
-  uint8_t lcdCursor = 1;
-  uint8_t columnCount = 0;
-
-  // Print each of the notes from the song onto the LCD.
-  uint8_t scrolledLineCounter = scrolledLines;
-  for (song_size_t i = 0; i < songSize; i++) {
-    const char * pitch = get_note_from_freq(prgmSong.get_note(i)).pitch;
-    const uint8_t pitchSize = strlen(pitch);
-
-    // Get if adding the pitch to the current column would overflow. If so then reset the column.
-    if (columnCount + pitchSize > LCD_COLS) {
-      columnCount = 0;
-      if (scrolledLineCounter == 0) {
-        ++lcdCursor;
-      } else {
-        --scrolledLineCounter;
-      }
-    }
-    // -1 for the top [Song] header.
-    // Stop printing if we are off the screen.
-    if (lcdCursor > (LCD_ROWS - 1)) {
-      return;
-    }
-
-    if (scrolledLineCounter == 0) {
-      lcd.setCursor(columnCount, lcdCursor);
-      lcd.print(pitch);
-    }
-
-    columnCount += pitchSize;
+void CreatorModeCreateNew::print_song_row(uint8_t row) {
+  // Stop if the row is not on the screen. -1 for the top [Song] header.
+  if (row < scrolledLines || row - scrolledLines > LCD_ROWS - 2) {
+    return;
+  }
+  const uint8_t lcdCursor = row - scrolledLines + 1;
+  lcd.clear_row(lcdCursor);
+  if (row >= rowCount) {
+    return;
+  }
+  const song_size_t rowEnd = row + 1 < rowCount ? rowStarts[row + 1] : prgmSong.get_size();
+  for (song_size_t i = rowStarts[row]; i < rowEnd; i++) {
+    lcd.print((const __FlashStringHelper *) get_note_pitch_P(prgmSong.get_note(i)));
   }
 }
 
@@ -271,18 +315,7 @@ void CreatorModeCreateNew::print_song_lcd() {
  * @return A number of rows.
  */
 uint8_t CreatorModeCreateNew::get_lcd_required_rows() {
-  uint8_t columnCount = 0;
-  uint8_t rowCounter = 0;
-  for (song_size_t i = 0; i < prgmSong.get_size(); i++) {
-    const uint8_t pitchSize = strlen(get_note_from_freq(prgmSong.get_note(i)).pitch);
-    if (columnCount + pitchSize > LCD_COLS) {
-      columnCount = 0;
-      rowCounter++;
-    }
-    columnCount += pitchSize;
-  }
-  return rowCounter;
-
+  return rowCount == 0 ? 0 : rowCount - 1;
 }
 
 // NOTE: Methods like the ones below would not be included on ports to the UNO because the UNO does not
@@ -308,7 +341,7 @@ void CreatorModeCreateNew::set_save_name(char fileName[9]) {
   uint8_t slideInfo = 0;
   unsigned long lastUpdate = 0;
   const uint16_t updateInterval = 5000; // 5 seconds.
-  segDisplay.blank();
+  seg_blank();
 
   char analogChar = get_character_from_analog();
   while (true) {
@@ -316,7 +349,6 @@ void CreatorModeCreateNew::set_save_name(char fileName[9]) {
     // same as millis() % 32 == 0
     if (millis() & ((2 ^ 5) - 1)) {
       analogChar = get_character_from_analog();
-      segDisplay.refreshDisplay();
       if (optionWaiting) {
         #if PRGM_MODE == 0
         digitalWriteFast(RGB_BLUE, HIGH);
@@ -345,13 +377,15 @@ void CreatorModeCreateNew::set_save_name(char fileName[9]) {
     }
 
     lcd.print(F(".txt "));
+    // Only the characters which changed are sent.
+    lcd.flush();
 
     // Toggle option button.
     if (is_pressed(BTN_OPTION)) {
       optionWaiting = !optionWaiting;
     }
 
-    if (is_pressed(BTN_ADD_SELECT)) {
+    if (is_pressed(BTN_ADD_SELECT) || is_chord_pressed(BTN_ADD_SELECT)) {
       // Return an array of each character.
       if (optionWaiting) {
         if (index == 0) {
@@ -377,7 +411,7 @@ void CreatorModeCreateNew::set_save_name(char fileName[9]) {
       index++;
     }
 
-    if (is_pressed(BTN_DEL_CANCEL)) {
+    if (is_pressed(BTN_DEL_CANCEL) || is_chord_pressed(BTN_DEL_CANCEL)) {
       if (optionWaiting) {
         // Return an empty string.
         strcpy(fileName, "\0");
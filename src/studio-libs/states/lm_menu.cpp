@@ -10,9 +10,23 @@
  */
 
 #include <studio-libs/states/states.h>
+#include <studio-libs/idle_tasks.h>
 
 ListeningModeMenu::ListeningModeMenu(): ProgramState::ProgramState(LM_MENU) {}
-ListeningModeMenu::~ListeningModeMenu() {}
+ListeningModeMenu::~ListeningModeMenu() {
+  idle_task_remove(stage_task, this);
+}
+
+bool ListeningModeMenu::stage_task(void * context) {
+  if (stagedSong.open_step()) {
+    return true;
+  }
+  ListeningModeMenu & state = *(ListeningModeMenu *) context;
+  state.isStaging = false;
+  state.isStaged = true;
+  idle_task_remove(stage_task, context);
+  return false;
+}
 
 void ListeningModeMenu::loop() {
   
@@ -33,8 +47,26 @@ void ListeningModeMenu::loop() {
     lcd.print(get_selected_page());
     lcd.print(F(")"));
     previousSong = get_selected_song();
+    highlightTime = millis();
+    isStaged = false;
+    // A song which was skipped past is left half open. It is continued if it is highlighted again.
+    idle_task_remove(stage_task, this);
+    isStaging = false;
+  }
+  // Open the song once it has stayed highlighted so pressing SELECT can start playing it right away. The song (and its text if it
+  // has no cache yet) is verified and compiled by stage_task so a long song does not stop the menu.
+  if (!isStaged && !isStaging && millis() - highlightTime >= LM_STAGE_DELAY) {
+    const char * name = sd_get_file(previousSong - 1);
+    if (strlen(name) && !stagedSong.is_open(name) && (stagedSong.is_opening(name) || stagedSong.open_begin(name))) {
+      isStaging = idle_task_add(stage_task, this, LM_STAGE_TASK_BUDGET_US);
+    }
+    isStaged = !isStaging;
+  }
+  if (isStaging) {
+    // The menu never waits in delay_ms so the task is given its budget here.
+    idle_tasks_run(millis() + LM_STAGE_TASK_BUDGET_US / 1000 + 2);
   }
-  const uint8_t indexer = !digitalReadFast(BTN_TONE_1) ? 1 : !digitalReadFast(BTN_TONE_2) ? 2 : !digitalReadFast(BTN_TONE_3) ? 3 : !digitalReadFast(BTN_TONE_4) ? 4 : !digitalReadFast(BTN_TONE_5) ? 5 : 0;
+  const uint8_t indexer = is_pressed(BTN_TONE_1) ? 1 : is_pressed(BTN_TONE_2) ? 2 : is_pressed(BTN_TONE_3) ? 3 : is_pressed(BTN_TONE_4) ? 4 : is_pressed(BTN_TONE_5) ? 5 : 0;
   set_selected_song(indexer == 0 ? previousSong : ((get_selected_page() - 1) * 5) + indexer);
   if(is_pressed(BTN_OPTION)) {
     set_selected_page(get_selected_page() + 1 > (MAX_SONG_AMOUNT / 5) ? 0 : get_selected_page() + 1);
@@ -49,6 +81,9 @@ void ListeningModeMenu::init() {
   Serial.println(F(" Entered listening mode."));
   #endif
   previousSong = 0;
+  highlightTime = 0;
+  isStaged = true;
+  isStaging = false;
   delay_ms(500);
   lcd.setCursor(2, 1);
   lcd.print(F("[Listening Mode]"));
@@ -65,6 +100,7 @@ void ListeningModeMenu::init() {
     "Press the \"DEL/CANCEL\" button to go back to main menu.\n"
     "While listening, press \"SELECT\" to pause song.\n"
     "While paused, press Green Tone to go back, Blue Tone to go forward, and SELECT to restart after a song is finished.\n"
+    "While listening, press Red Tone to play the next songs in order, shuffled, or on repeat.\n"
     "While listening, press \"OPTION+DEL\" to delete song."));
 
   //TODO: Possibly add instruction for OPTION+SELECT to edit a saved song.
@@ -7,6 +7,12 @@
  * Note: The way that songs are played back is different then usual. This class does NOT use the song.cpp way of playing back songs
  * and instead it relies on a global index and the general loop() function instead of a seperate while loop.
  *
+ * Songs are not copied into prgmSong. The notes are streamed from the compiled cache of the song (see SongStream) so any length
+ * of song can be played back and the next block of notes is read from the SD card in between notes. The song is usually already
+ * open (stagedSong) because the listening mode menu opens the highlighted song while the user is browsing.
+ *
+ * Notes are played by the sequencer interrupt (see sequencer.h). The loop only keeps the sequencer fed and updates the lcd.
+ *
  * @version 0.1
  * @date 2021-07-26
  *
@@ -15,10 +21,197 @@
  */
 
 #include <studio-libs/states/states.h>
+#include <studio-libs/idle_tasks.h>
 
-ListeningModePlayingSong::ListeningModePlayingSong(): ProgramState::ProgramState(LM_PLAYING_SONG) {}
+/** @brief The playlist order. Kept between songs because the state is made again every time a song is picked. */
+static uint8_t playlistMode = PLAYLIST_OFF;
+
+ListeningModePlayingSong::ListeningModePlayingSong(): ProgramState::ProgramState(LM_PLAYING_SONG) {
+  song = &stagedSong;
+  feedSong = song;
+}
 ListeningModePlayingSong::~ListeningModePlayingSong() {
-  prgmSong.clear();
+  idle_task_remove(feed_task, this);
+  sequencer_clear();
+  stagedSong.close();
+  queuedSong.close();
+}
+
+void ListeningModePlayingSong::seek_playback() {
+  sequencer_clear();
+  // The next song of the playlist may have been fed already. It is fed again after the current song.
+  sequencer_set_timing(song->get_note_delay(), song->get_note_length());
+  feedSong = song;
+  playbackStart = currentSongNote;
+  nextFeedNote = currentSongNote;
+}
+
+bool ListeningModePlayingSong::feed_step() {
+  if (nextFeedNote >= feedSong->get_size()) {
+    // Only one song is fed ahead. The sequencer also keeps one timing change so the first step of the song which was fed
+    // ahead has to start before the next one is fed.
+    if (feedSong != song || queuedSongNumber == 0) {
+      return false;
+    }
+    SongStream * const next = song == &stagedSong ? &queuedSong : &stagedSong;
+    if (!sequencer_feed_timing(next->get_note_delay(), next->get_note_length())) {
+      return false;
+    }
+    feedSong = next;
+    nextFeedNote = 0;
+  }
+  // Every track of the note is fed at once so they start together.
+  uint8_t step[SONG_MAX_TRACKS];
+  feedSong->get_step(nextFeedNote, step);
+  if (!sequencer_feed(step, feedSong->get_track_count())) {
+    return false;
+  }
+  nextFeedNote++;
+  return true;
+}
+
+bool ListeningModePlayingSong::feed_task(void * context) {
+  ListeningModePlayingSong & state = *(ListeningModePlayingSong *) context;
+  // The loop does not feed the song while the user is asked to delete it either.
+  if (state.invalidSong || state.requestedDelete) {
+    return false;
+  }
+  if (state.feed_step()) {
+    return true;
+  }
+  state.feedSong->prefetch(state.nextFeedNote);
+  // The sequencer is fed so the rest of the budget goes to opening the next song of the playlist.
+  return state.queue_step();
+}
+
+void ListeningModePlayingSong::queue_next_song() {
+  isQueueTried = true;
+  queueTries = 0;
+  queueCandidate = get_selected_song();
+  queue_open_candidate();
+}
+
+void ListeningModePlayingSong::queue_open_candidate() {
+  SongStream & next = song == &stagedSong ? queuedSong : stagedSong;
+  const uint8_t songCount = sd_get_song_count();
+  const uint8_t current = get_selected_song();
+  // A song which failed on repeat is not tried again.
+  while (queueTries < songCount && (queueTries == 0 || playlistMode != PLAYLIST_REPEAT)) {
+    queueTries++;
+    if (playlistMode == PLAYLIST_SEQUENTIAL) {
+      queueCandidate = queueCandidate % songCount + 1;
+    } else if (playlistMode == PLAYLIST_SHUFFLE && songCount > 1) {
+      // Any song other than the current one.
+      queueCandidate = random(1, songCount);
+      if (queueCandidate >= current) {
+        queueCandidate++;
+      }
+    }
+    if (next.open_begin(sd_get_file(queueCandidate - 1))) {
+      return;
+    }
+  }
+  queueCandidate = 0;
+}
+
+bool ListeningModePlayingSong::queue_step() {
+  if (queueCandidate == 0) {
+    return false;
+  }
+  SongStream & next = song == &stagedSong ? queuedSong : stagedSong;
+  if (next.open_step()) {
+    return true;
+  }
+  if (next.get_size() != 0) {
+    queuedSongNumber = queueCandidate;
+    queueCandidate = 0;
+    return false;
+  }
+  queue_open_candidate();
+  return queueCandidate != 0;
+}
+
+void ListeningModePlayingSong::unqueue_next_song() {
+  if (feedSong != song) {
+    // The start of the next song is already in the queue of the sequencer. The current note is started again.
+    seek_playback();
+  }
+  (song == &stagedSong ? queuedSong : stagedSong).close();
+  queuedSongNumber = 0;
+  queueCandidate = 0;
+  isQueueTried = false;
+}
+
+void ListeningModePlayingSong::start_queued_song() {
+  // The sequencer keeps counting from the start of the previous song.
+  playbackStart -= currentSongSize;
+  song->close();
+  song = feedSong;
+  currentSongSize = song->get_size();
+  set_selected_song(queuedSongNumber);
+  set_selected_page((queuedSongNumber - 1) / 5 + 1);
+  queuedSongNumber = 0;
+  isQueueTried = false;
+  currentSongNote = playbackStart + sequencer_get_played();
+
+  lcd_clear_row(0);
+  lcd_clear_row(1);
+  lcd_clear_row(2);
+  print_song_info(sd_get_file(get_selected_song() - 1));
+  lcd.setCursor(1, 1);
+  lcd.write(byte(PLAYING_SONG_SYMBOL));
+  lcd.print(F(" NOW PLAYING "));
+  lcd.write(byte(MUSIC_NOTE_SYMBOL));
+}
+
+void ListeningModePlayingSong::print_song_info(const char * name) {
+  lcd.setCursor(0, 0);
+  lcd.print(F("[#"));
+  lcd.print(get_selected_song());
+  lcd.print(F("] "));
+
+  if (!invalidSong) {
+    char buffer[9];
+    // Copy the song name to the buffer and remove the file extension.
+    strncpy(buffer, name, strlen(name) - strlen(FILE_TXT_EXTENSION));
+    buffer[strlen(name) - strlen(FILE_TXT_EXTENSION)] = '\0'; // Terminate "garbage" unneeded data.
+    lcd.print(buffer);
+  }
+
+  lcd.setCursor(0, 2);
+  lcd.print(F("PROGRESS: "));
+  // Put unfilled progress blocks.
+  for (uint8_t i = 0; i < 8; i++) {
+    lcd.write(byte(PROGRESS_BLOCK_UNFILLED_SYMBOL));
+  }
+
+  // Seperate the progress bar into 8 different blocks.
+  #if PRGM_MODE == 0
+  blockRequirement = currentSongSize / 8;
+  #else
+  blockRequirement = (float)((float)currentSongSize / 8.0F);
+  #endif
+
+  blockSize = blockRequirement;
+}
+
+void ListeningModePlayingSong::print_playlist_mode() {
+  lcd_clear_row(3);
+  lcd.print(F("Playlist: "));
+  switch (playlistMode) {
+  case PLAYLIST_OFF:
+    lcd.print(F("OFF"));
+    break;
+  case PLAYLIST_SEQUENTIAL:
+    lcd.print(F("IN ORDER"));
+    break;
+  case PLAYLIST_SHUFFLE:
+    lcd.print(F("SHUFFLE"));
+    break;
+  case PLAYLIST_REPEAT:
+    lcd.print(F("REPEAT"));
+    break;
+  }
 }
 
 void ListeningModePlayingSong::loop() {
@@ -33,7 +226,7 @@ void ListeningModePlayingSong::loop() {
 
   // Check if the user is trying to delete their song.
   if(requestedDelete) {
-    if(digitalReadFast(BTN_ADD_SELECT) == LOW) {
+    if(is_pressed(BTN_ADD_SELECT)) {
       // User has confirmed. Delete the file from the SD card.
       lcd.clear();
       lcd.setCursor(0, 1);
@@ -41,13 +234,15 @@ void ListeningModePlayingSong::loop() {
       lcd.setCursor(0, 2);
       lcd.print(sd_get_file(get_selected_song() - 1));
       delay_ms(2000);
+      sequencer_clear();
+      song->close();
       sd_rem(sd_get_file(get_selected_song() - 1));
       update_state(MAIN_MENU);
       set_selected_page(1);
       set_selected_song(1);
       delay_ms(500);
       return;
-    }else if(digitalReadFast(BTN_DEL_CANCEL) == LOW) {
+    }else if(is_pressed(BTN_DEL_CANCEL) || is_chord_pressed(BTN_DEL_CANCEL)) {
       delay_ms(850);
       lcd.clear();
       delay_ms(850);
@@ -69,11 +264,11 @@ void ListeningModePlayingSong::loop() {
       break;
     case 1:
       lcd.print(F("Note Delay: "));
-      lcd.print(prgmSong.get_note_delay());
+      lcd.print(song->get_note_delay());
       break;
     case 2:
       lcd.print(F("Note Length: "));
-      lcd.print(prgmSong.get_note_length());
+      lcd.print(song->get_note_length());
       break;
     case 3:
       lcd.print(F("Song #: "));
@@ -83,20 +278,24 @@ void ListeningModePlayingSong::loop() {
       lcd.print(F("Page #: "));
       lcd.print(get_selected_page());
       break;
+    case 5:
+      print_playlist_mode();
+      break;
     }
-    // Move to the next text mode.
+    // Move to the next text mode. The playlist is only shown when it is on.
     bottomTextMode++;
-    if (bottomTextMode == 5) {
+    if (bottomTextMode >= (playlistMode == PLAYLIST_OFF ? 5 : 6)) {
       bottomTextMode = 0;
     }
     lastTextUpdate = millis();
   }
 
   // When the user presses the add/select button.
-  if (digitalReadFast(BTN_ADD_SELECT) == LOW) {
+  if (is_pressed(BTN_ADD_SELECT)) {
     // If the song is being played then pause it.
     if (currentSongNote < currentSongSize) {
       isPaused = !isPaused;
+      sequencer_pause(isPaused);
       // Update the paused indicator.
       lcd_clear_row(1);
       lcd.setCursor(1, 1);
@@ -108,7 +307,6 @@ void ListeningModePlayingSong::loop() {
         lcd.print(F(" NOW PLAYING "));
       }
       lcd.write(byte(MUSIC_NOTE_SYMBOL));
-      delay_ms(200);
     } else {
       // If the song has finished then restart it.
       delay_ms(500);
@@ -121,19 +319,39 @@ void ListeningModePlayingSong::loop() {
     }
   }
 
+  // Change the playlist. The next song is picked again for the new order.
+  if (is_pressed(BTN_TONE_3)) {
+    playlistMode++;
+    if (playlistMode == PLAYLIST_MODE_AMOUNT) {
+      playlistMode = PLAYLIST_OFF;
+    }
+    if (playlistMode == PLAYLIST_SHUFFLE) {
+      randomSeed(micros());
+    }
+    unqueue_next_song();
+    print_playlist_mode();
+    lastTextUpdate = millis();
+  }
+
   // Forward/Backwards
+  // Presses are always taken so a press while the song is playing does not move it once it is paused.
+  // Holding the button keeps moving the song.
+  const bool forward = is_pressed(BTN_TONE_1) || is_long_pressed(BTN_TONE_1);
+  const bool backward = is_pressed(BTN_TONE_2) || is_long_pressed(BTN_TONE_2);
   if (currentSongNote < currentSongSize) {
     if (isPaused) {
-      if (digitalReadFast(BTN_TONE_1) == LOW) {
+      if (forward) {
         // Forward
         currentSongNote++;
+        seek_playback();
         delay_ms(100);
-      } else if (digitalReadFast(BTN_TONE_2) == LOW) {
+      } else if (backward) {
         // Backwards
         if (currentSongNote == 0) {
           return;
         }
         currentSongNote--;
+        seek_playback();
         delay_ms(100);
         // NOTE: The progress bar needs to be reset because the instructions to update the progress bar usually do not 
         // account for a reduction in the block size. Therefore we need to regenerate the block size from zero.
@@ -157,7 +375,7 @@ void ListeningModePlayingSong::loop() {
   // End
 
   // Deleting the song
-  if (digitalReadFast(BTN_DEL_CANCEL) == LOW && digitalReadFast(BTN_OPTION) == LOW) {
+  if (is_chord_pressed(BTN_DEL_CANCEL)) {
     if(!requestedDelete) {
       #if DEBUG == true
       Serial.print(get_active_time());
@@ -180,7 +398,7 @@ void ListeningModePlayingSong::loop() {
     }
   }
   // User pressed Cancel but not option; Return to listening mode menu.
-  else if (digitalReadFast(BTN_DEL_CANCEL) == LOW) {
+  else if (is_pressed(BTN_DEL_CANCEL)) {
     delay_ms(1000);
     update_state(LM_MENU);
     return;
@@ -192,26 +410,27 @@ void ListeningModePlayingSong::loop() {
   This class uses a custom song playing method in order to play the individual notes from the song.
   This is required in order to make the pause, rewind/forward, and progress bar work properly.
 
-  The playing of songs in this class relies entirely on the looping method of this class.
-  Therefore, the performance of song playback is dependent on the performance of the code in this looping function.
-  Code in this function must be optimized to a high level or else extra delays between notes can occur.
-
-  Using DEBUG and PERF_METRIC modes can cause the notes to be delayed for a longer period of time.
+  The notes are started and stopped by the sequencer interrupt using absolute deadlines so the timing of the song does not depend
+  on how long this loop takes. The loop only needs to keep the queue of the sequencer fed (which reads from the SD card when
+  needed) and track how many notes have been played.
   */
-  if (!isPaused && currentSongNote < currentSongSize && millis() - lastTonePlay > prgmSong.get_note_delay()) {
-    if (prgmSong.get_note(currentSongNote) != PAUSE_NOTE.frequency) {
-      prgmSong.play_note(prgmSong.get_note(currentSongNote));
-      delay_ms(prgmSong.get_note_length());
-      noNewTone(SPEAKER_1);
-      lastTonePlay = millis();
-      currentSongNote++;
-    } else {
-      delay_ms(PAUSE_DELAY); // Delay the song from continuing for a certain amount of time.
-      lastTonePlay = millis();
-      currentSongNote++; // Go to the next index of the song.
-    }
+  while (feed_step()) {
+  }
+  // The next song is opened while the current one is still playing so it can be fed right after the last note. Only one
+  // step is taken every loop so the buttons and the lcd are not held up while it is compiled.
+  if (playlistMode != PLAYLIST_OFF && !isQueueTried) {
+    queue_next_song();
+  }
+  queue_step();
+  // Read the next block of notes while the queue is still full.
+  feedSong->prefetch(nextFeedNote);
+  currentSongNote = playbackStart + sequencer_get_played();
 
-  } else if (currentSongNote >= currentSongSize) {
+  if (currentSongNote >= currentSongSize && feedSong != song) {
+    start_queued_song();
+  }
+
+  if (currentSongNote >= currentSongSize) {
     lcd.setCursor(1, 1);
     lcd.write(byte(FINISHED_SONG_SYMBOL));
     lcd.print(F(" FINISHED SONG "));
@@ -244,8 +463,16 @@ void ListeningModePlayingSong::init() {
   lastTextUpdate = 0;
   isPaused = false;
   invalidSong = false;
-  lastTonePlay = 0;
   requestedDelete = false;
+  playbackStart = 0;
+  nextFeedNote = 0;
+  // init() is run again when the song is restarted. The song must not start before the wait at the end.
+  idle_task_remove(feed_task, this);
+  sequencer_clear();
+  sequencer_pause(false);
+  // The next song of the playlist is picked again. The current song may be in either stream after the playlist moved on.
+  feedSong = song;
+  unqueue_next_song();
 
   const char * name = sd_get_file(get_selected_song() - 1);
 
@@ -260,31 +487,19 @@ void ListeningModePlayingSong::init() {
     invalidSong = true;
   }
 
-  lcd.print(F("[#"));
-  lcd.print(get_selected_song());
-  lcd.print(F("] "));
-
-  if (!invalidSong) {
-    char buffer[9];
-    // Copy the song name to the buffer and remove the file extension.
-    strncpy(buffer, name, strlen(name) - strlen(FILE_TXT_EXTENSION));
-    buffer[strlen(name) - strlen(FILE_TXT_EXTENSION)] = '\0'; // Terminate "garbage" unneeded data.
-    lcd.print(buffer);
-  }
+  // The listening mode menu opens the highlighted song ahead of time so it can start playing right away.
+  const bool isStaged = !invalidSong && song->is_open(name);
+  const bool isOpen = isStaged || (!invalidSong && song->open(name));
+  currentSongSize = song->get_size();
+  sequencer_set_timing(song->get_note_delay(), song->get_note_length());
 
+  print_song_info(name);
   lcd.setCursor(1, 1);
   lcd.write('#');
   lcd.print(F(" INITALIZING "));
   lcd.write(byte(MUSIC_NOTE_SYMBOL));
 
-  lcd.setCursor(0, 2);
-  lcd.print(F("PROGRESS: "));
-  // Put unfilled progress blocks.
-  for (uint8_t i = 0; i < 8; i++) {
-    lcd.write(byte(PROGRESS_BLOCK_UNFILLED_SYMBOL));
-  }
-
-  if (invalidSong || sd_songcpy(name) == false) {
+  if (!isOpen) {
     lcd.clear();
     lcd.print(F("Invalid Song"));
     #if PRGM_MODE == 0
@@ -300,25 +515,18 @@ void ListeningModePlayingSong::init() {
     #endif
     invalidSong = true;
   }
-
-  currentSongSize = prgmSong.get_size();
-  // Seperate the progress bar into 8 different blocks.
-  #if PRGM_MODE == 0
-  blockRequirement = currentSongSize / 8;
-  #else
-  blockRequirement = (float)((float)currentSongSize / 8.0F);
-  #endif
-
-  blockSize = blockRequirement;
   
-
-  delay_ms(750);
+  if (!isStaged) {
+    delay_ms(750);
+  }
 
   if (!invalidSong) {
     lcd.setCursor(1, 1);
     lcd.write(byte(PLAYING_SONG_SYMBOL));
     lcd.print(F(" NOW PLAYING "));
     lcd.write(byte(MUSIC_NOTE_SYMBOL));
+    // Added after the wait above so the song does not start while INITALIZING is shown.
+    idle_task_add(feed_task, this, LM_FEED_TASK_BUDGET_US);
   }
 
 }
\ No newline at end of file
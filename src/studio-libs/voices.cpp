@@ -0,0 +1,112 @@
+/**
+ * @file voices.cpp
+ * @author Jacob LuVisi
+ * @brief The timer driven voices. @see voices.h
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <studio-libs/voices.h>
+#include <avr/interrupt.h>
+
+/** @brief The registers of one of Timers 3 to 5 and the speaker pin it toggles. */
+typedef struct voiceTimer {
+  volatile uint8_t * tccrA;
+  volatile uint8_t * tccrB;
+  volatile uint8_t * timsk;
+  volatile uint16_t * tcnt;
+  volatile uint16_t * ocrA;
+  volatile uint8_t * port;
+  uint8_t mask;
+} voiceTimer_t;
+
+/**
+ * @brief The timers of voices 1 to 3 (voice 0 is NewTone on Timer1).
+ * Timers 3 to 5 have the same register layout so the bits of Timer3 (WGM32, CS30, CS31, OCIE3A) are used for all of them.
+ */
+static const voiceTimer_t VOICE_TIMERS[VOICE_COUNT - 1] = {
+  { &TCCR3A, &TCCR3B, &TIMSK3, &TCNT3, &OCR3A, __digitalPinToPortReg(SPEAKER_2), _BV(__digitalPinToBit(SPEAKER_2)) },
+  { &TCCR4A, &TCCR4B, &TIMSK4, &TCNT4, &OCR4A, __digitalPinToPortReg(SPEAKER_3), _BV(__digitalPinToBit(SPEAKER_3)) },
+  { &TCCR5A, &TCCR5B, &TIMSK5, &TCNT5, &OCR5A, __digitalPinToPortReg(SPEAKER_4), _BV(__digitalPinToBit(SPEAKER_4)) }
+};
+static_assert(VOICE_COUNT == 4, "VOICE_TIMERS must have a timer for every voice after the first.");
+
+/** @brief The voices which are playing (bit n set if voice n is playing). Only changed with interrupts off. */
+static volatile uint8_t activeVoices = 0;
+
+void voice_begin() {
+  pinModeFast(SPEAKER_2, OUTPUT);
+  pinModeFast(SPEAKER_3, OUTPUT);
+  pinModeFast(SPEAKER_4, OUTPUT);
+  digitalWriteFast(SPEAKER_2, LOW);
+  digitalWriteFast(SPEAKER_3, LOW);
+  digitalWriteFast(SPEAKER_4, LOW);
+}
+
+uint8_t voice_start(uint16_t frequency) {
+  if (frequency == 0) {
+    return VOICE_COUNT;
+  }
+  const uint8_t sreg = SREG;
+  cli();
+  uint8_t voice = 0;
+  while (voice < VOICE_COUNT && (activeVoices & (1 << voice))) {
+    voice++;
+  }
+  if (voice == 0) {
+    NewTone(SPEAKER_1, frequency);
+  } else if (voice < VOICE_COUNT) {
+    // The pin toggles on every compare match so the timer has to match twice per period.
+    uint8_t prescaler = _BV(CS30);
+    unsigned long top = F_CPU / 2 / frequency - 1;
+    if (top > 65535) {
+      // Below 123hz @ 16MHz. Prescaler 8 reaches down to 16hz.
+      prescaler = _BV(CS31);
+      top = F_CPU / 16 / frequency - 1;
+    }
+    const voiceTimer_t &timer = VOICE_TIMERS[voice - 1];
+    *timer.tccrA = 0;
+    *timer.tcnt = 0;
+    *timer.ocrA = top;
+    *timer.tccrB = _BV(WGM32) | prescaler;
+    *timer.timsk |= _BV(OCIE3A);
+  }
+  if (voice < VOICE_COUNT) {
+    activeVoices |= 1 << voice;
+  }
+  SREG = sreg;
+  return voice;
+}
+
+void voice_stop(uint8_t voice) {
+  if (voice >= VOICE_COUNT) {
+    return;
+  }
+  const uint8_t sreg = SREG;
+  cli();
+  if (voice == 0) {
+    noNewTone(SPEAKER_1);
+  } else {
+    const voiceTimer_t &timer = VOICE_TIMERS[voice - 1];
+    *timer.timsk &= ~_BV(OCIE3A);
+    *timer.tccrB = 0;
+    *timer.port &= ~timer.mask;
+  }
+  activeVoices &= ~(1 << voice);
+  SREG = sreg;
+}
+
+ISR(TIMER3_COMPA_vect) {
+  *__digitalPinToPortReg(SPEAKER_2) ^= _BV(__digitalPinToBit(SPEAKER_2));
+}
+
+ISR(TIMER4_COMPA_vect) {
+  *__digitalPinToPortReg(SPEAKER_3) ^= _BV(__digitalPinToBit(SPEAKER_3));
+}
+
+ISR(TIMER5_COMPA_vect) {
+  *__digitalPinToPortReg(SPEAKER_4) ^= _BV(__digitalPinToBit(SPEAKER_4));
+}
@@ -0,0 +1,585 @@
+/**
+ * @file cycle_runner.c
+ * @author Jacob LuVisi
+ * @brief Runs a CYCLE_BENCH build of TuneStudio2560 on an emulated ATmega2560 (simavr) and prints the exact CPU cycles of every
+ * benchmark. Runs on a computer, not on the Arduino.
+ *
+ * <b>Usage</b><br />
+ * cc -O2 -o cycle_runner test/simavr/cycle_runner.c $(pkg-config --cflags --libs simavr) -lelf<br />
+ * cycle_runner [-c CYCLES] SD_IMAGE FIRMWARE.elf
+ *
+ * - -c: Stop with an error if the benchmarks have not finished after CYCLES cycles (default 60 seconds at 16MHz).
+ * - SD_IMAGE: A FAT formatted image which is used as the SD card (a multiple of 512KB in size). It is written to.
+ * - FIRMWARE.elf: The firmware of one of the simavr_mode environments in platformio.ini.
+ *
+ * The benchmarks are marked by the firmware through the GPIOR registers (see include/debug/cycle_bench.h). Prints one line per
+ * benchmark with the amount of runs and the fewest, most and average cycles of a run, less the cycles of the marks themselves
+ * ("empty"). The fewest cycles are a run which no interrupt landed in. Everything the firmware sends over Serial is printed as it
+ * arrives, before the table (ex. the stack report of the simavr_stack environment).
+ *
+ * Then prints the worst case interrupt load of playing a song: every voice plays LOAD_FREQUENCY (4 voices toggling their pins 8000
+ * times a second each) on top of the ADC, Timer0 and Timer2 interrupts, each counted at its most cycles. The exit code is 1 if
+ * less than LOAD_MIN_LEFT percent of the CPU would be left for loop().
+ *
+ * <b>Peripherals</b><br />
+ * Only what setup() needs to finish is emulated:
+ * - An SDHC card in SPI mode on the SD_CS_PIN. It answers the commands SdFat sends right away (no busy time).
+ * - The I2C LCD acknowledges every byte so the LCD writes cost the same as on the real display.
+ * - Every button pin is held HIGH (not pressed). The potentiometer reads 0. The TIMER2_OVF_vect benchmark presses the buttons by
+ *   making their pins outputs and driving them LOW, which the pin registers read over the level held here.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+#include "avr_twi.h"
+#include "avr_uart.h"
+
+// Must match tune_studio.h and cycle_bench.h
+#define F_CPU 16000000
+#define LCD_I2C_ADDRESS 0x27
+#define CYCLE_BENCH_START 1
+#define CYCLE_BENCH_STOP 2
+#define CYCLE_BENCH_DONE 3
+
+// The data addresses of the general purpose I/O registers of the ATmega2560.
+#define GPIOR0_ADDRESS 0x3E
+#define GPIOR2_ADDRESS 0x4B
+
+#define BENCH_MAX 32
+/** @brief The note every voice plays for the interrupt load. Above B7 (3951hz), the highest note. */
+#define LOAD_FREQUENCY 4000
+/** @brief The least of the CPU (percent) the interrupts have to leave for loop() at LOAD_FREQUENCY. */
+#define LOAD_MIN_LEFT 50
+/**
+ * @brief The cycles of an interrupt which a benchmark run does not count: the jmp in the vector table. Entering an interrupt costs
+ * the CPU as much as the call of the run (5 cycles) and the run ends with the reti of the interrupt.
+ */
+#define INTERRUPT_EXTRA_CYCLES 3
+#define BENCH_NAME_SIZE 40
+#define SD_BLOCK_SIZE 512
+#define SD_QUEUE_SIZE 1024
+
+/** @brief A pin which is held HIGH. */
+typedef struct {
+  char port;
+  uint8_t bit;
+} button_pin_t;
+
+/** @brief The buttons (BTN_TONE_1-5 on PORTA, ADD/SELECT and DEL/CANCEL on PORTE and OPTION on PORTG). Must match input.cpp */
+static const button_pin_t BUTTON_PINS[] = {
+  {'A', 2}, {'A', 3}, {'A', 4}, {'A', 5}, {'A', 6}, {'E', 4}, {'E', 5}, {'G', 5}
+};
+
+/** @brief How often an interrupt runs while every voice plays. Every benchmark whose name starts with the name is that interrupt. */
+typedef struct {
+  const char* name;
+  double perSecond;
+} interrupt_rate_t;
+
+/** @brief The interrupts which run while a song plays. Must match the timer and ADC settings of the firmware. */
+static const interrupt_rate_t INTERRUPT_RATES[] = {
+  // The voices toggle their speaker pin twice per period of the note (voices.cpp and NewTone).
+  {"TIMER1_COMPA_vect", 2.0 * LOAD_FREQUENCY},
+  {"TIMER3_COMPA_vect", 2.0 * LOAD_FREQUENCY},
+  {"TIMER4_COMPA_vect", 2.0 * LOAD_FREQUENCY},
+  {"TIMER5_COMPA_vect", 2.0 * LOAD_FREQUENCY},
+  // Timer0 counts to 256 at prescaler 64 (the Arduino core). Compare A is the display, compare B the sequencer.
+  {"TIMER0_OVF_vect", F_CPU / 64.0 / 256},
+  {"TIMER0_COMPA_vect", F_CPU / 64.0 / 256},
+  {"TIMER0_COMPB_vect", F_CPU / 64.0 / 256},
+  // Timer2 counts up and down (510 steps) at prescaler 64 (input.cpp).
+  {"TIMER2_OVF_vect", F_CPU / 64.0 / 510},
+  // A conversion takes 13 ADC clocks at prescaler 128 (pot.cpp).
+  {"ADC_vect", F_CPU / 128.0 / 13},
+};
+
+typedef enum {
+  /** @brief Waiting for (or reading) a 6 byte command. */
+  SD_COMMAND,
+  /** @brief Waiting for the start token of a block which is written. */
+  SD_WRITE_TOKEN,
+  /** @brief Reading a block which is written (512 bytes and the CRC). */
+  SD_WRITE_DATA
+} sd_state_t;
+
+/** @brief An SD card in SPI mode backed by an image file. */
+typedef struct {
+  int fd;
+  uint32_t blocks;
+  int selected;
+  int idle;
+  int appCommand;
+  sd_state_t state;
+  uint8_t command[6];
+  uint8_t commandLength;
+  /** @brief If blocks are read until CMD12. */
+  int multiRead;
+  /** @brief If blocks are written until the stop token. */
+  int multiWrite;
+  /** @brief The next block to read or write. */
+  uint32_t address;
+  uint8_t block[SD_BLOCK_SIZE + 2];
+  uint16_t blockLength;
+  /** @brief The bytes which are sent back (one per byte received). */
+  uint8_t queue[SD_QUEUE_SIZE];
+  uint16_t queueHead;
+  uint16_t queueTail;
+} sd_card_t;
+
+typedef struct {
+  char name[BENCH_NAME_SIZE];
+  uint32_t runs;
+  uint64_t fewest;
+  uint64_t most;
+  uint64_t total;
+} bench_t;
+
+typedef struct {
+  avr_t* avr;
+  sd_card_t card;
+  avr_irq_t* spiInput;
+  avr_irq_t* twiInput;
+  int lcdSelected;
+  bench_t benches[BENCH_MAX];
+  int benchCount;
+  char nextName[BENCH_NAME_SIZE];
+  int nextNameLength;
+  uint64_t runStart;
+  int done;
+} runner_t;
+
+static void sd_queue(sd_card_t* card, uint8_t value) {
+  if (card->queueTail < SD_QUEUE_SIZE) card->queue[card->queueTail++] = value;
+}
+
+/** @brief Queue a data block: the start token, the data and a CRC (which SdFat does not check). */
+static void sd_queue_data(sd_card_t* card, const uint8_t* data, uint16_t length) {
+  sd_queue(card, 0xFF);
+  sd_queue(card, 0xFE);
+  for (uint16_t i = 0; i < length; i++) sd_queue(card, data[i]);
+  sd_queue(card, 0xFF);
+  sd_queue(card, 0xFF);
+}
+
+static void sd_queue_block(sd_card_t* card, uint32_t block) {
+  uint8_t data[SD_BLOCK_SIZE];
+  memset(data, 0, sizeof(data));
+  if (pread(card->fd, data, SD_BLOCK_SIZE, (off_t)block * SD_BLOCK_SIZE) < 0) perror("sd read");
+  sd_queue_data(card, data, SD_BLOCK_SIZE);
+}
+
+/** @brief Queue the CSD (version 2, SDHC) with the size of the image. */
+static void sd_queue_csd(sd_card_t* card) {
+  const uint32_t size = card->blocks / 1024 - 1;
+  const uint8_t csd[16] = {
+    0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, (uint8_t)((size >> 16) & 0x3F), (uint8_t)(size >> 8), (uint8_t)size,
+    0x7F, 0x80, 0x0A, 0x40, 0x00, 0x01
+  };
+  sd_queue_data(card, csd, sizeof(csd));
+}
+
+static void sd_queue_cid(sd_card_t* card) {
+  const uint8_t cid[16] = {0x03, 'T', 'S', 'S', 'I', 'M', 'A', 'V', 0x10, 0x00, 0x00, 0x00, 0x01, 0x01, 0x5A, 0x01};
+  sd_queue_data(card, cid, sizeof(cid));
+}
+
+static void sd_command(sd_card_t* card) {
+  const uint8_t index = card->command[0] & 0x3F;
+  const uint32_t argument = (uint32_t)card->command[1] << 24 | (uint32_t)card->command[2] << 16 |
+    (uint32_t)card->command[3] << 8 | card->command[4];
+  const int appCommand = card->appCommand;
+  const uint8_t r1 = card->idle ? 0x01 : 0x00;
+  card->appCommand = 0;
+  if (index == 12) {
+    // Stop a multiple block read. Whatever was queued of the next block is dropped.
+    card->multiRead = 0;
+    card->queueHead = card->queueTail = 0;
+    sd_queue(card, 0xFF);
+    sd_queue(card, 0x00);
+    sd_queue(card, 0xFF);
+    return;
+  }
+  // Every response is sent one byte after the command (NCR).
+  sd_queue(card, 0xFF);
+  if (appCommand && index == 41) {
+    card->idle = 0;
+    sd_queue(card, 0x00);
+    return;
+  }
+  switch (index) {
+  case 0:
+    card->idle = 1;
+    card->multiRead = 0;
+    card->multiWrite = 0;
+    sd_queue(card, 0x01);
+    break;
+  case 8:
+    sd_queue(card, r1);
+    sd_queue(card, 0x00);
+    sd_queue(card, 0x00);
+    sd_queue(card, (argument >> 8) & 0x0F);
+    sd_queue(card, argument & 0xFF);
+    break;
+  case 9:
+    sd_queue(card, r1);
+    sd_queue_csd(card);
+    break;
+  case 10:
+    sd_queue(card, r1);
+    sd_queue_cid(card);
+    break;
+  case 13:
+    sd_queue(card, r1);
+    sd_queue(card, 0x00);
+    break;
+  case 17:
+  case 18:
+    if (argument >= card->blocks) {
+      sd_queue(card, r1 | 0x40);
+      break;
+    }
+    sd_queue(card, r1);
+    sd_queue_block(card, argument);
+    card->address = argument + 1;
+    card->multiRead = index == 18;
+    break;
+  case 24:
+  case 25:
+    if (argument >= card->blocks) {
+      sd_queue(card, r1 | 0x40);
+      break;
+    }
+    sd_queue(card, r1);
+    card->address = argument;
+    card->multiWrite = index == 25;
+    card->state = SD_WRITE_TOKEN;
+    break;
+  case 55:
+    card->appCommand = 1;
+    sd_queue(card, r1);
+    break;
+  case 58:
+    // Powered up, 2.7-3.6V and CCS (block addressing).
+    sd_queue(card, r1);
+    sd_queue(card, 0xC0);
+    sd_queue(card, 0xFF);
+    sd_queue(card, 0x80);
+    sd_queue(card, 0x00);
+    break;
+  case 16:
+  case 23:
+  case 32:
+  case 33:
+  case 38:
+  case 59:
+    sd_queue(card, r1);
+    break;
+  default:
+    // Illegal command.
+    sd_queue(card, r1 | 0x04);
+    break;
+  }
+}
+
+/** @brief Take in a byte which the microcontroller sent. */
+static void sd_receive(sd_card_t* card, uint8_t value) {
+  switch (card->state) {
+  case SD_WRITE_TOKEN:
+    if (value == 0xFE || value == 0xFC) {
+      card->state = SD_WRITE_DATA;
+      card->blockLength = 0;
+    } else if (value == 0xFD) {
+      // The end of a multiple block write. Busy for one byte.
+      card->multiWrite = 0;
+      card->state = SD_COMMAND;
+      sd_queue(card, 0xFF);
+      sd_queue(card, 0x00);
+    }
+    break;
+  case SD_WRITE_DATA:
+    card->block[card->blockLength++] = value;
+    if (card->blockLength == sizeof(card->block)) {
+      if (pwrite(card->fd, card->block, SD_BLOCK_SIZE, (off_t)card->address * SD_BLOCK_SIZE) < 0) perror("sd write");
+      card->address++;
+      // Data accepted, then busy for one byte.
+      sd_queue(card, 0x05);
+      sd_queue(card, 0x00);
+      card->state = card->multiWrite ? SD_WRITE_TOKEN : SD_COMMAND;
+    }
+    break;
+  case SD_COMMAND:
+    if (card->commandLength == 0 && (value & 0xC0) != 0x40) {
+      break;
+    }
+    card->command[card->commandLength++] = value;
+    if (card->commandLength == sizeof(card->command)) {
+      card->commandLength = 0;
+      sd_command(card);
+    }
+    break;
+  }
+}
+
+/** @brief Exchange one byte over SPI. @return The byte the card sends back. */
+static uint8_t sd_exchange(sd_card_t* card, uint8_t value) {
+  uint8_t reply = 0xFF;
+  if (card->queueHead < card->queueTail) {
+    reply = card->queue[card->queueHead++];
+  } else {
+    card->queueHead = card->queueTail = 0;
+    if (card->multiRead && card->address < card->blocks) {
+      sd_queue_block(card, card->address++);
+    }
+  }
+  sd_receive(card, value);
+  return reply;
+}
+
+static void spi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+  runner_t* runner = param;
+  (void)irq;
+  const uint8_t reply = runner->card.selected ? sd_exchange(&runner->card, (uint8_t)value) : 0xFF;
+  avr_raise_irq(runner->spiInput, reply);
+}
+
+/** @brief SD_CS_PIN (53, PB0) changed. The card only listens while it is LOW. */
+static void sd_chip_select(struct avr_irq_t* irq, uint32_t value, void* param) {
+  runner_t* runner = param;
+  (void)irq;
+  runner->card.selected = value == 0;
+  if (!runner->card.selected) {
+    runner->card.commandLength = 0;
+  }
+}
+
+static void twi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+  runner_t* runner = param;
+  avr_twi_msg_irq_t message;
+  (void)irq;
+  message.u.v = value;
+  if (message.u.twi.msg & TWI_COND_STOP) {
+    runner->lcdSelected = 0;
+  }
+  if (message.u.twi.msg & TWI_COND_START) {
+    runner->lcdSelected = (message.u.twi.addr >> 1) == LCD_I2C_ADDRESS;
+  }
+  if (runner->lcdSelected && (message.u.twi.msg & (TWI_COND_START | TWI_COND_WRITE))) {
+    avr_raise_irq(runner->twiInput, avr_twi_irq_msg(TWI_COND_ACK, message.u.twi.addr, 1));
+  }
+}
+
+/** @brief A byte which the firmware sent over Serial (UART0). */
+static void uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+  (void)irq;
+  (void)param;
+  if (value != '\r') putchar((int)value);
+}
+
+static bench_t* current_bench(runner_t* runner) {
+  return runner->benchCount == 0 ? NULL : &runner->benches[runner->benchCount - 1];
+}
+
+/** @brief GPIOR2: The name of the next benchmark one character at a time. */
+static void name_write(struct avr_t* avr, avr_io_addr_t address, uint8_t value, void* param) {
+  runner_t* runner = param;
+  avr->data[address] = value;
+  if (value != '\0') {
+    if (runner->nextNameLength < BENCH_NAME_SIZE - 1) runner->nextName[runner->nextNameLength++] = value;
+    return;
+  }
+  runner->nextName[runner->nextNameLength] = '\0';
+  runner->nextNameLength = 0;
+  if (runner->benchCount == BENCH_MAX) {
+    fprintf(stderr, "cycle_runner: more than %d benchmarks\n", BENCH_MAX);
+    return;
+  }
+  bench_t* bench = &runner->benches[runner->benchCount++];
+  memset(bench, 0, sizeof(*bench));
+  strcpy(bench->name, runner->nextName);
+}
+
+/** @brief GPIOR0: A CycleBenchMark. */
+static void mark_write(struct avr_t* avr, avr_io_addr_t address, uint8_t value, void* param) {
+  runner_t* runner = param;
+  avr->data[address] = value;
+  bench_t* bench = current_bench(runner);
+  if (value == CYCLE_BENCH_START) {
+    runner->runStart = avr->cycle;
+  } else if (value == CYCLE_BENCH_STOP && bench != NULL) {
+    const uint64_t cycles = avr->cycle - runner->runStart;
+    if (bench->runs == 0 || cycles < bench->fewest) bench->fewest = cycles;
+    if (cycles > bench->most) bench->most = cycles;
+    bench->total += cycles;
+    bench->runs++;
+  } else if (value == CYCLE_BENCH_DONE) {
+    runner->done = 1;
+  }
+}
+
+static uint64_t less_overhead(uint64_t cycles, uint64_t overhead) {
+  return cycles > overhead ? cycles - overhead : 0;
+}
+
+static void print_results(const runner_t* runner) {
+  uint64_t overhead = 0;
+  for (int i = 0; i < runner->benchCount; i++) {
+    if (strcmp(runner->benches[i].name, "empty") == 0 && runner->benches[i].runs != 0) overhead = runner->benches[i].fewest;
+  }
+  printf("%-32s %5s %10s %10s %12s %10s\n", "benchmark", "runs", "fewest", "most", "average", "fewest us");
+  for (int i = 0; i < runner->benchCount; i++) {
+    const bench_t* bench = &runner->benches[i];
+    if (strcmp(bench->name, "empty") == 0) continue;
+    if (bench->runs == 0) {
+      printf("%-32s %5u %10s %10s %12s %10s\n", bench->name, 0, "-", "-", "-", "-");
+      continue;
+    }
+    const uint64_t fewest = less_overhead(bench->fewest, overhead);
+    const double average = (double)bench->total / bench->runs - overhead;
+    printf("%-32s %5u %10llu %10llu %12.1f %10.2f\n", bench->name, bench->runs, (unsigned long long)fewest,
+      (unsigned long long)less_overhead(bench->most, overhead), average > 0 ? average : 0, fewest * 1e6 / F_CPU);
+  }
+}
+
+/**
+ * @brief Print how much of the CPU the interrupts take at the most while every voice plays LOAD_FREQUENCY, counting the most cycles
+ * of every interrupt.
+ * @return 0 if at least LOAD_MIN_LEFT percent is left for loop(), 1 if not or an interrupt was not benchmarked.
+ */
+static int print_interrupt_load(const runner_t* runner) {
+  uint64_t overhead = 0;
+  for (int i = 0; i < runner->benchCount; i++) {
+    if (strcmp(runner->benches[i].name, "empty") == 0 && runner->benches[i].runs != 0) overhead = runner->benches[i].fewest;
+  }
+  printf("\n%-32s %10s %10s %8s\n", "interrupt", "per second", "cycles", "cpu");
+  double total = 0;
+  int missing = 0;
+  for (size_t i = 0; i < sizeof(INTERRUPT_RATES) / sizeof(INTERRUPT_RATES[0]); i++) {
+    const interrupt_rate_t* rate = &INTERRUPT_RATES[i];
+    uint64_t most = 0;
+    int found = 0;
+    for (int j = 0; j < runner->benchCount; j++) {
+      const bench_t* bench = &runner->benches[j];
+      if (bench->runs == 0 || strncmp(bench->name, rate->name, strlen(rate->name)) != 0) continue;
+      const uint64_t cycles = less_overhead(bench->most, overhead);
+      if (cycles > most) most = cycles;
+      found = 1;
+    }
+    if (!found) {
+      printf("%-32s %10.0f %10s %8s\n", rate->name, rate->perSecond, "-", "-");
+      missing = 1;
+      continue;
+    }
+    const double perSecond = rate->perSecond * (most + INTERRUPT_EXTRA_CYCLES);
+    total += perSecond;
+    printf("%-32s %10.0f %10llu %7.2f%%\n", rate->name, rate->perSecond, (unsigned long long)(most + INTERRUPT_EXTRA_CYCLES),
+      100.0 * perSecond / F_CPU);
+  }
+  const double left = 100.0 - 100.0 * total / F_CPU;
+  printf("interrupt load with every voice at %dhz: %.2f%% of the CPU, %.2f%% left for loop()\n", LOAD_FREQUENCY,
+    100.0 - left, left);
+  if (missing) {
+    fprintf(stderr, "cycle_runner: not every interrupt was benchmarked\n");
+    return 1;
+  }
+  if (left < LOAD_MIN_LEFT) {
+    fprintf(stderr, "cycle_runner: the interrupts leave less than %d%% of the CPU for loop()\n", LOAD_MIN_LEFT);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  uint64_t cycleLimit = 60ULL * F_CPU;
+  int argument = 1;
+  if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+    cycleLimit = strtoull(argv[2], NULL, 10);
+    argument = 3;
+  }
+  if (argc - argument != 2) {
+    fprintf(stderr, "Usage: %s [-c CYCLES] SD_IMAGE FIRMWARE.elf\n", argv[0]);
+    return 2;
+  }
+
+  static runner_t runner;
+  runner.card.fd = open(argv[argument], O_RDWR);
+  struct stat imageStat;
+  if (runner.card.fd < 0 || fstat(runner.card.fd, &imageStat) != 0) {
+    perror(argv[argument]);
+    return 2;
+  }
+  runner.card.blocks = imageStat.st_size / SD_BLOCK_SIZE;
+  if (runner.card.blocks < 1024 || runner.card.blocks % 1024 != 0) {
+    fprintf(stderr, "cycle_runner: %s must be a multiple of 512KB\n", argv[argument]);
+    return 2;
+  }
+
+  elf_firmware_t firmware;
+  memset(&firmware, 0, sizeof(firmware));
+  if (elf_read_firmware(argv[argument + 1], &firmware) != 0) {
+    fprintf(stderr, "cycle_runner: could not read %s\n", argv[argument + 1]);
+    return 2;
+  }
+  avr_t* avr = avr_make_mcu_by_name("atmega2560");
+  if (avr == NULL) {
+    fprintf(stderr, "cycle_runner: simavr does not have the atmega2560\n");
+    return 2;
+  }
+  avr_init(avr);
+  avr_load_firmware(avr, &firmware);
+  avr->frequency = F_CPU;
+  avr->log = LOG_ERROR;
+  runner.avr = avr;
+
+  runner.spiInput = avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), spi_output, &runner);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 0), sd_chip_select, &runner);
+  runner.card.selected = 0;
+  runner.card.idle = 1;
+
+  runner.twiInput = avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), twi_output, &runner);
+
+  // Serial is printed by uart_output instead of the simavr log.
+  uint32_t uartFlags = 0;
+  avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &uartFlags);
+  uartFlags &= ~AVR_UART_FLAG_STDIO;
+  avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &uartFlags);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uart_output, &runner);
+
+  for (size_t i = 0; i < sizeof(BUTTON_PINS) / sizeof(BUTTON_PINS[0]); i++) {
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(BUTTON_PINS[i].port), BUTTON_PINS[i].bit), 1);
+  }
+
+  avr_register_io_write(avr, GPIOR0_ADDRESS, mark_write, &runner);
+  avr_register_io_write(avr, GPIOR2_ADDRESS, name_write, &runner);
+
+  int state = cpu_Running;
+  while (!runner.done && state != cpu_Done && state != cpu_Crashed && avr->cycle < cycleLimit) {
+    state = avr_run(avr);
+  }
+  close(runner.card.fd);
+
+  print_results(&runner);
+  if (!runner.done) {
+    fprintf(stderr, "cycle_runner: the benchmarks did not finish (%s after %llu cycles)\n",
+      state == cpu_Crashed ? "crashed" : state == cpu_Done ? "stopped" : "timed out", (unsigned long long)avr->cycle);
+    return 1;
+  }
+  return print_interrupt_load(&runner);
+}
@@ -0,0 +1,90 @@
+#!/bin/sh
+# Builds the cycle count benchmarks (include/debug/cycle_bench.h) for every PRGM_MODE and runs them on an emulated ATmega2560.
+# Then checks the stack painter and the stack scan (include/debug/stack_watch.h) on the emulated chip with the simavr_stack build,
+# that at least 128 bytes of SRAM are left below its deepest stack and whether that stack fits next to its globals
+# (tools/sram_report.cpp).
+# Needs PlatformIO, simavr (with its headers and pkg-config file), libelf, mkfs.fat and mtools. Exits with 1 if any mode did not
+# finish its benchmarks, its interrupts would leave less than half of the CPU to loop() or the stack check failed.
+#
+# The table of every mode is compared to the one recorded in test/simavr/recorded and the run fails if the fewest cycles of any
+# benchmark grew by more than 10%. Record the tables and the stack report again (and commit them) with "run_cycle_bench.sh
+# --record" when a change is meant to make a benchmark slower or use more stack.
+set -e
+cd "$(dirname "$0")/../.."
+out=.pio/simavr
+recorded=test/simavr/recorded
+record=0
+if [ "$1" = "--record" ]; then
+  record=1
+  mkdir -p "$recorded"
+fi
+mkdir -p "$out"
+cc -O2 -o "$out/cycle_runner" test/simavr/cycle_runner.c \
+  $(pkg-config --cflags --libs simavr 2>/dev/null || echo "-I/usr/include/simavr -lsimavr") -lelf
+
+# Every run starts with a fresh card (32MB FAT16) holding the song library.
+make_card() {
+  rm -f "$out/sd.img"
+  mkfs.fat -C -F 16 "$out/sd.img" 32768 > /dev/null
+  mcopy -i "$out/sd.img" test/songs/*.TXT ::
+}
+
+# Prints every benchmark of the table $2 whose fewest cycles grew by more than 10% over the recorded table $1. Exits with 1 if any.
+compare_table() {
+  awk '
+    FNR == 1 { table = 0 }
+    /^benchmark / { table = 1; next }
+    table && NF == 0 { table = 0 }
+    table && NF == 6 && FILENAME == ARGV[1] { fewest[$1] = $3 }
+    table && NF == 6 && FILENAME == ARGV[2] && ($1 in fewest) && $3 + 0 > fewest[$1] * 1.1 {
+      printf "REGRESSION %s: %s cycles (recorded %s)\n", $1, $3, fewest[$1]
+      failed = 1
+    }
+    END { exit failed }' "$1" "$2" >&2
+}
+
+status=0
+for mode in 0 1 2; do
+  pio run -s -e "simavr_mode$mode"
+  make_card
+  echo "PRGM_MODE $mode"
+  "$out/cycle_runner" "$out/sd.img" ".pio/build/simavr_mode$mode/firmware.elf" > "$out/mode$mode.txt" || status=1
+  cat "$out/mode$mode.txt"
+  if [ $record = 1 ]; then
+    cp "$out/mode$mode.txt" "$recorded/mode$mode.txt"
+  elif [ -f "$recorded/mode$mode.txt" ]; then
+    compare_table "$recorded/mode$mode.txt" "$out/mode$mode.txt" || status=1
+  else
+    echo "No table of PRGM_MODE $mode is recorded yet. Run with --record and commit $recorded." >&2
+  fi
+  echo
+done
+
+pio run -s -e simavr_stack
+make_card
+echo "STACK CHECK"
+build=.pio/build/simavr_stack
+"$out/cycle_runner" "$out/sd.img" "$build/firmware.elf" > "$out/stack.txt" || status=1
+grep '^STACK' "$out/stack.txt" || true
+# A painter which did not run leaves no free SRAM in the report. A scan which does not work reports no state. The benchmarks open
+# and save a song so both have to be measured.
+if ! grep -q '^STACK state' "$out/stack.txt" || ! grep -q '^STACK op open ' "$out/stack.txt" ||
+  ! grep -q '^STACK op save ' "$out/stack.txt" || grep -q ' free=0$' "$out/stack.txt"; then
+  echo "The stack painter or the stack scan did not work." >&2
+  status=1
+fi
+# What is left at the deepest point has to hold an interrupt landing there (and what the benchmarks do not reach).
+min_free=128
+least_free=$(sed -n 's/^STACK.* free=\([0-9]*\)$/\1/p' "$out/stack.txt" | sort -n | head -n 1)
+if [ -n "$least_free" ] && [ "$least_free" -lt $min_free ]; then
+  echo "Only $least_free bytes of SRAM are left below the deepest stack (at least $min_free are needed)." >&2
+  status=1
+fi
+if [ $record = 1 ]; then
+  grep '^STACK' "$out/stack.txt" > "$recorded/stack.txt" || true
+fi
+used=$(sed -n 's/.* used=\([0-9]*\).*/\1/p' "$out/stack.txt" | sort -n | tail -n 1)
+if [ -n "$used" ] && [ -x "$build/sram_report" ]; then
+  "$build/sram_report" --stack "$used" "$build/symbols.txt" || status=1
+fi
+exit $status
@@ -0,0 +1,479 @@
+/**
+ * @file song_render.cpp
+ * @author Jacob LuVisi
+ * @brief Renders every song (.txt) in a directory to a WAV file the way TuneStudio2560 would play it. Runs on a computer, not on
+ * the Arduino.
+ *
+ * <b>Usage</b><br />
+ * g++ -O3 -march=native -pthread -o song_render tools/song_render.cpp<br />
+ * song_render [-j THREADS] [-r RATE] [-o OUTDIR] SONGDIR
+ *
+ * - -j: The amount of songs rendered at the same time (default the amount of CPU threads).
+ * - -r: The sample rate of the WAV files (default 22050).
+ * - -o: Write OUTDIR/NAME.wav for every song. Without it the songs are only rendered and checked.
+ *
+ * Prints one line per song (in name order) with its length and a CRC-32 of its samples, then a summary. The lines only change
+ * when the way a song sounds changes, so the output of two runs can be diffed to regression check a whole library of songs.
+ * Songs the device would refuse to play are listed as FAILED with the reason and make the exit code 1.
+ *
+ * <b>Timing</b><br />
+ * Songs are parsed with the same rules as sd_song_compile() in main.cpp and timed like the sequencer (sequencer.cpp): every step
+ * plays for TONE_LENGTH (or PAUSE_DELAY when every track rests) followed by TONE_DELAY of silence. The sequencer only checks its
+ * deadlines from the Timer0 compare B interrupt, once every 1024us when millis() has moved on, so every note starts and stops on
+ * that tick. Songs start at millis() 0. The device starts a song at whatever millis() is at the time so every note of it can be
+ * one tick earlier or later than in the render.
+ *
+ * <b>Sound</b><br />
+ * Track n of a step plays on the lowest free voice like voice_start() in voices.cpp. Voice 0 uses the period NewTone calculates for
+ * Timer1 (phase and frequency correct PWM, prescaler 1 or 256) and voices 1 to 3 the period of Timers 3 to 5 in CTC mode
+ * (prescaler 1 or 8). Each voice is a square wave which starts at the beginning of its period. The voices are mixed together with
+ * the same amplitude as the --wav output of the native simulator.
+ *
+ * Songs are spread over the threads with work stealing. Each thread takes songs from its own queue and steals from the others
+ * once its queue is empty so a few long songs do not hold up the rest.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+  // Must match tune_studio.h, song.h and main.cpp
+  constexpr uint32_t F_CPU = 16000000;
+  constexpr uint8_t PROGRAM_NOTE_AMOUNT = 85;
+  constexpr uint8_t PAUSE_NOTE_INDEX = 254;
+  constexpr uint8_t FIRST_NOTE_CHROMATIC = 11;
+  constexpr uint8_t PITCH_SEMITONES[7] = { 9, 11, 0, 2, 4, 5, 7 };
+  constexpr uint8_t PITCH_BUFFER_SIZE = 5;
+  constexpr uint8_t SONG_VALUE_DIGITS = 4;
+  constexpr uint8_t MIN_SONG_LENGTH = 8;
+  constexpr uint8_t SONG_MAX_TRACKS = 4;
+  constexpr uint16_t DEFAULT_NOTE_DELAY = 80;
+  constexpr uint8_t DEFAULT_NOTE_LENGTH = 50;
+  constexpr uint16_t PAUSE_DELAY = 500;
+  /** @brief The frequency of every note in PROGRAM_NOTES. */
+  constexpr uint16_t NOTE_FREQUENCIES[PROGRAM_NOTE_AMOUNT] = {
+    31, 33, 35, 37, 39, 41, 44, 46, 49, 52, 55, 58, 62, 65, 69, 73, 78,
+    82, 87, 93, 98, 104, 110, 117, 123, 131, 139, 147, 156, 165, 175, 185, 196, 208,
+    220, 233, 247, 262, 277, 294, 311, 330, 349, 370, 392, 415, 440, 466, 494, 523, 554,
+    587, 622, 659, 698, 740, 784, 831, 880, 932, 988, 1047, 1109, 1175, 1245, 1319, 1397, 1480,
+    1568, 1661, 1760, 1865, 1976, 2093, 2217, 2349, 2489, 2637, 2794, 2960, 3136, 3322, 3520, 3729, 3951
+  };
+
+  /** @brief The time between two Timer0 overflows (and so between two checks of the sequencer) in microseconds. */
+  constexpr uint32_t TIMER0_PERIOD_US = 1024;
+  /** @brief The amplitude of one voice. Four voices at once still fit in 16 bits. */
+  constexpr int32_t VOICE_AMPLITUDE = 8000;
+
+  /** @brief A compiled song. Notes are stored step-major like the song cache. */
+  struct Song {
+    uint16_t noteDelay;
+    uint8_t noteLength;
+    uint8_t trackCount;
+    std::vector<uint8_t> notes;
+  };
+
+  /** @brief A song to render and what happened to it. */
+  struct Job {
+    std::string name;
+    uint64_t size;
+    bool failed;
+    const char* error;
+    uint64_t samples;
+    uint32_t crc;
+  };
+
+  /** @brief The songs of one thread. The owner takes from the back, other threads steal from the front. */
+  struct WorkQueue {
+    std::mutex lock;
+    std::deque<Job*> jobs;
+  };
+
+  /** @brief Same as get_note_from_pitch() in main.cpp. @return The note index or -1 if the pitch is not valid. */
+  int note_from_pitch(const char* pitch) {
+    if (strcmp(pitch, "PS") == 0) return PAUSE_NOTE_INDEX;
+    const char letter = pitch[0];
+    const bool isSharp = letter != '\0' && pitch[1] == 'S';
+    const char octave = letter != '\0' ? pitch[1 + isSharp] : '\0';
+    const bool isValid = letter >= 'A' && letter <= 'G' && octave >= '0' && octave <= '7' && pitch[2 + isSharp] == '\0' &&
+      !(isSharp && (letter == 'E' || letter == 'B'));
+    const int note = isValid ? ((octave - '0') * 12) + PITCH_SEMITONES[letter - 'A'] + isSharp - FIRST_NOTE_CHROMATIC : -1;
+    return note >= 0 && note < PROGRAM_NOTE_AMOUNT ? note : -1;
+  }
+
+  /**
+   * @brief Parse the text of a song with the same rules as sd_song_compile() in main.cpp.
+   * @return nullptr if the song is valid or the reason it is not.
+   */
+  const char* compile_song(const std::vector<uint8_t>& text, Song& song) {
+    enum { PARSE_TEXT, PARSE_COMMENT, PARSE_VALUE, PARSE_NOTE } state = PARSE_TEXT;
+    song.noteDelay = DEFAULT_NOTE_DELAY;
+    song.noteLength = DEFAULT_NOTE_LENGTH;
+    song.trackCount = 0;
+    song.notes.clear();
+    bool isToneDelay = true;
+    char pitch[PITCH_BUFFER_SIZE];
+    uint8_t tokenLength = 0;
+    uint16_t value = 0;
+    uint8_t step[SONG_MAX_TRACKS];
+    uint8_t stepTracks = 0;
+    uint32_t noteCount = 0;
+    for (size_t position = 0; position <= text.size(); position++) {
+      // The end of the file also ends the last line.
+      const char letter = position == text.size() ? '\n' : text[position];
+      switch (state) {
+      case PARSE_TEXT:
+        if (letter == '#') {
+          state = PARSE_COMMENT;
+        } else if (letter == '=') {
+          state = PARSE_VALUE;
+          tokenLength = 0;
+          value = 0;
+        } else if (letter == '-') {
+          state = PARSE_NOTE;
+          tokenLength = 0;
+        }
+        break;
+      case PARSE_COMMENT:
+        if (letter == '\n') state = PARSE_TEXT;
+        break;
+      case PARSE_VALUE:
+      case PARSE_NOTE:
+        if (state == PARSE_NOTE && tokenLength != 0 && (letter == ' ' || letter == '\t' || letter == '\n' || letter == '#')) {
+          pitch[tokenLength] = '\0';
+          tokenLength = 0;
+          const int note = note_from_pitch(pitch);
+          if (note < 0) return "unknown pitch";
+          if (stepTracks == SONG_MAX_TRACKS || (song.trackCount != 0 && stepTracks == song.trackCount)) return "too many tracks";
+          step[stepTracks++] = note;
+        }
+        if (letter == ' ' || letter == '\r' || letter == '\b' || letter == '\t' || letter == '=') break;
+        if (letter != '\n' && letter != '#') {
+          if (state == PARSE_VALUE) {
+            if (letter < '0' || letter > '9' || tokenLength == SONG_VALUE_DIGITS) return "invalid TONE_DELAY or TONE_LENGTH";
+            value = (value * 10) + (letter - '0');
+          } else {
+            if (tokenLength == PITCH_BUFFER_SIZE - 1) return "pitch too long";
+            pitch[tokenLength] = letter;
+          }
+          tokenLength++;
+          break;
+        }
+        if (state == PARSE_VALUE) {
+          if (tokenLength == 0 || (!isToneDelay && value > UINT8_MAX)) return "invalid TONE_DELAY or TONE_LENGTH";
+          if (isToneDelay) {
+            isToneDelay = false;
+            song.noteDelay = value;
+          } else {
+            song.noteLength = value;
+          }
+        } else {
+          if (stepTracks == 0) return "empty note";
+          if (noteCount == UINT16_MAX) return "too many notes";
+          if (song.trackCount == 0) song.trackCount = stepTracks;
+          for (uint8_t track = 0; track < song.trackCount; track++) {
+            song.notes.push_back(track < stepTracks ? step[track] : PAUSE_NOTE_INDEX);
+          }
+          stepTracks = 0;
+          noteCount++;
+        }
+        state = letter == '#' ? PARSE_COMMENT : PARSE_TEXT;
+        break;
+      }
+    }
+    if (noteCount < MIN_SONG_LENGTH) return "too few notes";
+    return nullptr;
+  }
+
+  /**
+   * @return The time (in microseconds from the start of the song) of the sequencer tick which handles a deadline. millis() after
+   * k Timer0 overflows is floor(k * 1.024) so the tick is the first k where that reaches the deadline.
+   */
+  uint64_t tick_of(uint64_t deadlineMs) {
+    return (deadlineMs * 1000 + TIMER0_PERIOD_US - 1) / TIMER0_PERIOD_US * TIMER0_PERIOD_US;
+  }
+
+  /** @brief The frequency Timer1 plays a note at after NewTone() rounds its period. */
+  double newtone_frequency(uint16_t frequency) {
+    uint32_t prescaler = 1;
+    uint32_t top = F_CPU / frequency / 4 - 1;
+    if (top > 65535) {
+      prescaler = 256;
+      top = top / 256 - 1;
+    }
+    return (double)F_CPU / (4.0 * prescaler * (top + 1));
+  }
+
+  /** @brief The frequency Timers 3 to 5 play a note at after voice_start() rounds its period. */
+  double voice_timer_frequency(uint16_t frequency) {
+    uint32_t prescaler = 1;
+    uint32_t top = F_CPU / 2 / frequency - 1;
+    if (top > 65535) {
+      prescaler = 8;
+      top = F_CPU / 16 / frequency - 1;
+    }
+    return (double)F_CPU / (2.0 * prescaler * (top + 1));
+  }
+
+  /**
+   * @brief Add a square wave which starts at the beginning of its period to the mix.
+   * The phase of every sample only depends on its index (no branches or carried state) so the compiler vectorizes the loop.
+   *
+   * @param phaseStep The phase added per sample where 2^32 is one period.
+   */
+  void add_square(int32_t* __restrict mix, uint32_t count, uint32_t phaseStep) {
+    for (uint32_t i = 0; i < count; i++) {
+      // The first half of the period (top bit clear) is high.
+      const int32_t isLow = (i * phaseStep) >> 31;
+      mix[i] += VOICE_AMPLITUDE - isLow * (2 * VOICE_AMPLITUDE);
+    }
+  }
+
+  /** @brief Render a song into 16-bit samples. */
+  void render_song(const Song& song, uint32_t rate, std::vector<int16_t>& samples) {
+    // Find when every step starts and stops first so the mix can be allocated once.
+    const size_t steps = song.notes.size() / song.trackCount;
+    std::vector<uint64_t> times(steps * 2);
+    uint64_t deadline = 0;
+    for (size_t step = 0; step < steps; step++) {
+      bool isPlaying = false;
+      for (uint8_t track = 0; track < song.trackCount; track++) {
+        isPlaying = isPlaying || song.notes[step * song.trackCount + track] < PROGRAM_NOTE_AMOUNT;
+      }
+      times[step * 2] = tick_of(deadline);
+      deadline += isPlaying ? song.noteLength : PAUSE_DELAY;
+      times[step * 2 + 1] = tick_of(deadline);
+      deadline += song.noteDelay;
+    }
+    const uint64_t total = steps == 0 ? 0 : times.back() * rate / 1000000;
+    std::vector<int32_t> mix(total, 0);
+    for (size_t step = 0; step < steps; step++) {
+      const uint64_t start = times[step * 2] * rate / 1000000;
+      const uint64_t end = times[step * 2 + 1] * rate / 1000000;
+      uint8_t voice = 0;
+      for (uint8_t track = 0; track < song.trackCount; track++) {
+        const uint8_t note = song.notes[step * song.trackCount + track];
+        if (note >= PROGRAM_NOTE_AMOUNT) continue;
+        const double frequency = voice == 0 ? newtone_frequency(NOTE_FREQUENCIES[note]) : voice_timer_frequency(NOTE_FREQUENCIES[note]);
+        add_square(&mix[start], end - start, (uint32_t)(frequency / rate * 4294967296.0 + 0.5));
+        voice++;
+      }
+    }
+    samples.resize(total);
+    for (uint64_t i = 0; i < total; i++) {
+      samples[i] = std::min<int32_t>(INT16_MAX, std::max<int32_t>(INT16_MIN, mix[i]));
+    }
+  }
+
+  /** @brief The CRC-32 of every byte value (polynomial 0xEDB88320). */
+  struct Crc32Table {
+    uint32_t values[256];
+    Crc32Table() {
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+          crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+        values[i] = crc;
+      }
+    }
+  };
+  const Crc32Table CRC32_TABLE;
+
+  uint32_t crc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+      crc = (crc >> 8) ^ CRC32_TABLE.values[(crc ^ data[i]) & 0xFF];
+    }
+    return ~crc;
+  }
+
+  void put_le(std::vector<uint8_t>& out, uint32_t value, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; i++) {
+      out.push_back((value >> (i * 8)) & 0xFF);
+    }
+  }
+
+  /** @brief Write mono 16-bit PCM samples to a WAV file. @return If the whole file was written. */
+  bool write_wav(const std::string& path, const std::vector<int16_t>& samples, uint32_t rate) {
+    const uint32_t dataBytes = samples.size() * 2;
+    std::vector<uint8_t> header;
+    header.insert(header.end(), {'R', 'I', 'F', 'F'});
+    put_le(header, 36 + dataBytes, 4);
+    header.insert(header.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    put_le(header, 16, 4);
+    put_le(header, 1, 2);
+    put_le(header, 1, 2);
+    put_le(header, rate, 4);
+    put_le(header, rate * 2, 4);
+    put_le(header, 2, 2);
+    put_le(header, 16, 2);
+    header.insert(header.end(), {'d', 'a', 't', 'a'});
+    put_le(header, dataBytes, 4);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+    // The samples are written as they are in memory (little endian hosts only).
+    const bool written = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+      fwrite(samples.data(), 2, samples.size(), file) == samples.size();
+    return fclose(file) == 0 && written;
+  }
+
+  /** @brief Read, compile, render and write one song. */
+  void run_job(Job& job, const std::string& songDir, const char* outDir, uint32_t rate) {
+    FILE* file = fopen((songDir + "/" + job.name).c_str(), "rb");
+    if (file == nullptr) {
+      job.failed = true;
+      job.error = "could not be opened";
+      return;
+    }
+    std::vector<uint8_t> text(job.size);
+    text.resize(fread(text.data(), 1, text.size(), file));
+    fclose(file);
+
+    Song song;
+    job.error = compile_song(text, song);
+    if (job.error != nullptr) {
+      job.failed = true;
+      return;
+    }
+    std::vector<int16_t> samples;
+    render_song(song, rate, samples);
+    job.samples = samples.size();
+    job.crc = crc32((const uint8_t*)samples.data(), samples.size() * 2);
+    if (outDir != nullptr) {
+      const std::string base = job.name.substr(0, job.name.rfind('.'));
+      if (!write_wav(std::string(outDir) + "/" + base + ".wav", samples, rate)) {
+        job.failed = true;
+        job.error = "could not write the WAV file";
+      }
+    }
+  }
+
+  /** @brief Take a job from the back of a queue (owner) or the front (thief). @return nullptr if the queue is empty. */
+  Job* take_job(WorkQueue& queue, bool isOwner) {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.jobs.empty()) return nullptr;
+    Job* job;
+    if (isOwner) {
+      job = queue.jobs.back();
+      queue.jobs.pop_back();
+    } else {
+      job = queue.jobs.front();
+      queue.jobs.pop_front();
+    }
+    return job;
+  }
+
+  void worker(std::vector<WorkQueue>& queues, size_t self, const std::string& songDir, const char* outDir, uint32_t rate) {
+    while (true) {
+      Job* job = take_job(queues[self], true);
+      for (size_t i = 1; job == nullptr && i < queues.size(); i++) {
+        job = take_job(queues[(self + i) % queues.size()], false);
+      }
+      // Jobs are never added once the threads start so every queue being empty means the work is done.
+      if (job == nullptr) return;
+      run_job(*job, songDir, outDir, rate);
+    }
+  }
+
+  bool is_song(const char* name) {
+    const size_t length = strlen(name);
+    return length > 4 && strcasecmp(name + length - 4, ".txt") == 0 && strcasecmp(name, "README.TXT") != 0;
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned int threads = std::thread::hardware_concurrency();
+  uint32_t rate = 22050;
+  const char* outDir = nullptr;
+  const char* songDir = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      rate = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      outDir = argv[++i];
+    } else if (songDir == nullptr && argv[i][0] != '-') {
+      songDir = argv[i];
+    } else {
+      songDir = nullptr;
+      break;
+    }
+  }
+  if (songDir == nullptr || rate < 8000 || rate > 192000) {
+    fprintf(stderr, "Usage: %s [-j THREADS] [-r RATE] [-o OUTDIR] SONGDIR\n", argv[0]);
+    return 2;
+  }
+  if (threads == 0) threads = 1;
+
+  DIR* dir = opendir(songDir);
+  if (dir == nullptr) {
+    fprintf(stderr, "Could not open \"%s\".\n", songDir);
+    return 2;
+  }
+  std::vector<Job> jobs;
+  while (const dirent* entry = readdir(dir)) {
+    struct stat info;
+    if (!is_song(entry->d_name) || stat((std::string(songDir) + "/" + entry->d_name).c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+      continue;
+    }
+    jobs.push_back(Job {entry->d_name, (uint64_t)info.st_size, false, nullptr, 0, 0});
+  }
+  closedir(dir);
+  std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.name < b.name; });
+  if (outDir != nullptr) mkdir(outDir, 0755);
+
+  // Deal the songs out largest first so every thread starts with its share of the long ones.
+  std::vector<Job*> order;
+  for (Job& job : jobs) order.push_back(&job);
+  std::sort(order.begin(), order.end(), [](const Job* a, const Job* b) { return a->size > b->size; });
+  if (threads > order.size() && !order.empty()) threads = order.size();
+  std::vector<WorkQueue> queues(threads);
+  for (size_t i = 0; i < order.size(); i++) {
+    // The owner takes from the back so it starts with its largest song. Thieves take the smallest ones from the front.
+    queues[i % threads].jobs.push_front(order[i]);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (size_t i = 0; i < threads; i++) {
+    pool.emplace_back(worker, std::ref(queues), i, std::string(songDir), outDir, rate);
+  }
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+  const double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint32_t failed = 0;
+  uint64_t samples = 0;
+  for (const Job& job : jobs) {
+    if (job.failed) {
+      failed++;
+      printf("%s FAILED (%s)\n", job.name.c_str(), job.error);
+      continue;
+    }
+    samples += job.samples;
+    printf("%s %.3fs %08x\n", job.name.c_str(), job.samples / (double)rate, job.crc);
+  }
+  const double audioSeconds = samples / (double)rate;
+  fprintf(stderr, "[render] %zu songs (%u failed), %.1fs of audio in %.3fs with %u threads (%.0fx real time)\n", jobs.size(), failed,
+    audioSeconds, hostSeconds, threads, hostSeconds > 0 ? audioSeconds / hostSeconds : 0.0);
+  return failed == 0 ? 0 : 1;
+}
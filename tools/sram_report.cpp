@@ -0,0 +1,124 @@
+/**
+ * @file sram_report.cpp
+ * @author Jacob LuVisi
+ * @brief Lists how much of the static SRAM every global of a firmware build uses. Runs on a computer, not on the Arduino.
+ *
+ * <b>Usage</b><br />
+ * Runs after every AVR build (tools/sram_report.py), which leaves sram_report and symbols.txt in the build directory. By hand:<br />
+ * g++ -O2 -o sram_report tools/sram_report.cpp<br />
+ * pio run && avr-nm -C -S --size-sort .pio/build/megaatmega2560/firmware.elf > symbols.txt<br />
+ * sram_report [--stack BYTES] symbols.txt
+ *
+ * - --stack: The deepest stack measured on the device ("used=" of the stack report, see include/debug/stack_watch.h). Prints how
+ *   many bytes would be left between the globals and that stack.
+ *
+ * Every variable in .data and .bss (ex. prgmSong, lcd, SD, statePool, the Serial buffers) takes SRAM for the whole time the
+ * program runs and the stack gets whatever is left of the 8 KB. Prints the globals from largest to smallest (globals smaller
+ * than SMALL_GLOBAL bytes are added up on one line) followed by the total and what is left for the stack. Run it before and after
+ * raising MAX_SONG_LENGTH or adding a buffer to see what it costs. The exit code is 1 if the deepest stack no longer fits.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+  /** @brief The SRAM of the ATmega2560 (RAMSTART 0x200 to RAMEND 0x21FF). */
+  constexpr uint32_t SRAM_SIZE = 8192;
+  /** @brief Globals smaller than this are only counted in the total. */
+  constexpr uint32_t SMALL_GLOBAL = 16;
+
+  struct Global {
+    std::string name;
+    uint32_t size;
+    bool initalized;
+  };
+
+  /** @brief Read the globals out of the output of "nm -S". @return false if the file could not be read. */
+  bool read_symbols(const char* path, std::vector<Global>& globals) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+      fprintf(stderr, "Could not open \"%s\".\n", path);
+      return false;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      // ADDRESS SIZE TYPE NAME. Demangled names may have spaces so the name is the rest of the line.
+      unsigned long size;
+      char type;
+      int nameStart;
+      if (sscanf(line, "%*s %lx %c %n", &size, &type, &nameStart) != 2) continue;
+      // b and B are .bss, d and D are .data. Anything else (code, PROGMEM, EEPROM) is not in SRAM.
+      if (strchr("bBdD", type) == nullptr) continue;
+      std::string name = line + nameStart;
+      while (!name.empty() && (name.back() == '\n' || name.back() == '\r')) {
+        name.pop_back();
+      }
+      globals.push_back({name, (uint32_t)size, type == 'd' || type == 'D'});
+    }
+    fclose(file);
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  long stack = -1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stack") == 0 && i + 1 < argc) {
+      stack = strtol(argv[++i], nullptr, 10);
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == nullptr) {
+    fprintf(stderr, "Usage: %s [--stack BYTES] SYMBOLS\n", argv[0]);
+    return 2;
+  }
+  std::vector<Global> globals;
+  if (!read_symbols(path, globals)) return 1;
+  if (globals.empty()) {
+    fprintf(stderr, "No globals were found. Was the file made with \"avr-nm -S\"?\n");
+    return 1;
+  }
+  std::stable_sort(globals.begin(), globals.end(), [](const Global& a, const Global& b) { return a.size > b.size; });
+
+  uint32_t total = 0;
+  uint32_t smallTotal = 0;
+  uint32_t smallCount = 0;
+  printf("  bytes   sram  section  global\n");
+  for (const Global& global : globals) {
+    total += global.size;
+    if (global.size < SMALL_GLOBAL) {
+      smallTotal += global.size;
+      smallCount++;
+      continue;
+    }
+    printf("%7u %5.1f%%  %-7s  %s\n", global.size, 100.0 * global.size / SRAM_SIZE, global.initalized ? ".data" : ".bss",
+      global.name.c_str());
+  }
+  if (smallCount != 0) {
+    printf("%7u %5.1f%%           (%u globals smaller than %u bytes)\n", smallTotal, 100.0 * smallTotal / SRAM_SIZE, smallCount,
+      SMALL_GLOBAL);
+  }
+
+  const long left = (long)SRAM_SIZE - (long)total;
+  printf("\nstatic: %u of %u bytes (%.1f%%)\n", total, SRAM_SIZE, 100.0 * total / SRAM_SIZE);
+  printf("left for the stack: %ld bytes\n", left);
+  if (stack < 0) return 0;
+  printf("deepest stack: %ld bytes, %ld bytes to spare\n", stack, left - stack);
+  if (left < stack) {
+    fprintf(stderr, "The deepest stack no longer fits next to the globals.\n");
+    return 1;
+  }
+  return 0;
+}
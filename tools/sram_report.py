@@ -0,0 +1,46 @@
+"""
+@file sram_report.py
+@author Jacob LuVisi
+@brief Runs tools/sram_report.cpp on every AVR firmware right after it is linked. A PlatformIO extra script (see platformio.ini).
+
+The report is built with the computer's compiler into the build directory the first time (and again whenever the source
+changes), the globals of firmware.elf are listed with avr-nm into symbols.txt next to it and the report is printed with the
+build output.
+
+Set "custom_sram_stack = BYTES" in an environment (the deepest "used=" of the stack report, see include/debug/stack_watch.h) to
+also check that the stack still fits next to the globals. The build fails if it does not. Without it the report is only printed
+and a missing host compiler only skips it.
+
+@version 0.1
+@date 2021-10-04
+
+@copyright Copyright (c) 2021
+"""
+import os
+
+Import("env")
+
+
+def sram_report(target, source, env):
+    build_dir = env.subst("$BUILD_DIR")
+    tool_source = os.path.join(env.subst("$PROJECT_DIR"), "tools", "sram_report.cpp")
+    tool = os.path.join(build_dir, "sram_report")
+    if not os.path.exists(tool) or os.path.getmtime(tool) < os.path.getmtime(tool_source):
+        if env.Execute('c++ -O2 -o "%s" "%s"' % (tool, tool_source)) != 0:
+            print("sram_report: could not build %s with the host compiler, skipped." % tool_source)
+            return 0
+
+    symbols = os.path.join(build_dir, "symbols.txt")
+    if env.Execute('avr-nm -C -S --size-sort "%s" > "%s"' % (target[0].get_abspath(), symbols)) != 0:
+        print("sram_report: avr-nm could not read the firmware, skipped.")
+        return 0
+
+    stack = env.GetProjectOption("custom_sram_stack", "")
+    if not stack:
+        env.Execute('"%s" "%s"' % (tool, symbols))
+        return 0
+    # A stack which no longer fits fails the build.
+    return env.Execute('"%s" --stack %s "%s"' % (tool, stack, symbols))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", sram_report)
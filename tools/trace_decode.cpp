@@ -0,0 +1,244 @@
+/**
+ * @file trace_decode.cpp
+ * @author Jacob LuVisi
+ * @brief Decodes PERF_METRICS trace dumps into loop() latency histograms. Runs on a computer, not on the Arduino.
+ *
+ * <b>Usage</b><br />
+ * g++ -O2 -o trace_decode tools/trace_decode.cpp<br />
+ * trace_decode CAPTURE [CAPTURE...]
+ *
+ * A capture is anything that was received from the serial port while TuneStudio2560 ran with PERF_METRICS enabled and 'T' was
+ * sent one or more times. Every dump found in the captures is decoded and bytes outside of dumps are skipped. The format of a
+ * dump is described in include/debug/trace.h. In the native simulator use "--serial FILE" with "serial T" in the script.
+ *
+ * Prints, for every StateID, a histogram of how long loop() took (buckets double in size) followed by the state changes,
+ * notes, songs opened on the SD card and the lowest free memory that was sampled.
+ *
+ * @version 0.1
+ * @date 2021-10-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+  // Must match trace.h
+  const char TRACE_MAGIC[] = "TSTR";
+  constexpr uint8_t TRACE_VERSION = 1;
+  constexpr uint8_t TRACE_RECORD_SIZE = 7;
+  enum TraceEvent: uint8_t {
+    TRACE_LOOP_START, TRACE_LOOP_END, TRACE_STATE, TRACE_NOTE_ON, TRACE_NOTE_OFF, TRACE_SD_OPEN, TRACE_SD_CLOSE, TRACE_MEMORY
+  };
+
+  // Must match the StateID enum in state.h
+  const char* const STATE_NAMES[] = {"MAIN_MENU", "CM_MENU", "LM_MENU", "LM_PLAYING_SONG", "CM_CREATE_NEW"};
+  constexpr uint8_t STATE_COUNT = sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]);
+
+  /** @brief Bucket n holds loops which took less than 2^n us (and at least 2^(n-1) us). The last bucket holds the rest. */
+  constexpr uint8_t BUCKET_COUNT = 24;
+
+  struct StateStats {
+    uint32_t buckets[BUCKET_COUNT];
+    uint32_t loops;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t entered;
+  };
+
+  struct Totals {
+    StateStats states[STATE_COUNT + 1];
+    uint32_t dumps;
+    uint32_t records;
+    uint32_t overwritten;
+    uint32_t notes;
+    uint32_t songsOpened;
+    uint32_t songsFailed;
+    uint64_t sdOpenUs;
+    uint32_t sdOpenCount;
+    uint32_t minFreeMemory;
+  };
+
+  uint32_t read_le(const uint8_t* data, uint8_t bytes) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++) {
+      value |= (uint32_t)data[i] << (i * 8);
+    }
+    return value;
+  }
+
+  uint8_t bucket_of(uint32_t us) {
+    uint8_t bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && us >= (1UL << bucket)) {
+      bucket++;
+    }
+    return bucket;
+  }
+
+  const char* state_name(uint8_t state) {
+    return state < STATE_COUNT ? STATE_NAMES[state] : "UNKNOWN";
+  }
+
+  /** @brief Decode the records of one dump. Loops and songs are only matched within a dump since records are lost between them. */
+  void decode_dump(const uint8_t* data, uint16_t count, Totals& totals) {
+    bool inLoop = false;
+    uint32_t loopStart = 0;
+    bool songOpen = false;
+    uint32_t songOpenTime = 0;
+    for (uint16_t i = 0; i < count; i++) {
+      const uint8_t* record = data + (size_t)i * TRACE_RECORD_SIZE;
+      const uint32_t time = read_le(record, 4);
+      const uint8_t event = record[4];
+      const uint16_t value = read_le(record + 5, 2);
+      switch (event) {
+      case TRACE_LOOP_START:
+        inLoop = true;
+        loopStart = time;
+        break;
+      case TRACE_LOOP_END:
+        if (inLoop) {
+          // micros() overflows every ~71 minutes. Unsigned subtraction still gives the right duration.
+          const uint32_t duration = time - loopStart;
+          StateStats& state = totals.states[value < STATE_COUNT ? value : STATE_COUNT];
+          state.buckets[bucket_of(duration)]++;
+          state.loops++;
+          state.totalUs += duration;
+          if (duration > state.maxUs) state.maxUs = duration;
+        }
+        inLoop = false;
+        break;
+      case TRACE_STATE:
+        totals.states[value < STATE_COUNT ? value : STATE_COUNT].entered++;
+        break;
+      case TRACE_NOTE_ON:
+        totals.notes++;
+        break;
+      case TRACE_SD_OPEN:
+        if (value == 0) {
+          totals.songsFailed++;
+          break;
+        }
+        totals.songsOpened++;
+        songOpen = true;
+        songOpenTime = time;
+        break;
+      case TRACE_SD_CLOSE:
+        if (songOpen) {
+          totals.sdOpenUs += time - songOpenTime;
+          totals.sdOpenCount++;
+        }
+        songOpen = false;
+        break;
+      case TRACE_MEMORY:
+        if (value < totals.minFreeMemory) totals.minFreeMemory = value;
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  /** @brief Find and decode every dump in a capture. @return false if the capture could not be read. */
+  bool decode_capture(const char* path, Totals& totals) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+      fprintf(stderr, "Could not open \"%s\".\n", path);
+      return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) != 0) {
+      data.insert(data.end(), chunk, chunk + length);
+    }
+    fclose(file);
+
+    constexpr size_t HEADER_SIZE = 10;
+    size_t position = 0;
+    while (position + HEADER_SIZE <= data.size()) {
+      if (memcmp(&data[position], TRACE_MAGIC, 4) != 0) {
+        position++;
+        continue;
+      }
+      const uint8_t* header = &data[position];
+      const uint16_t count = read_le(header + 6, 2);
+      if (header[4] != TRACE_VERSION || header[5] != TRACE_RECORD_SIZE) {
+        fprintf(stderr, "%s: skipped a dump with version %u and record size %u.\n", path, header[4], header[5]);
+        position += 4;
+        continue;
+      }
+      if (position + HEADER_SIZE + (size_t)count * TRACE_RECORD_SIZE > data.size()) {
+        fprintf(stderr, "%s: the last dump is cut off.\n", path);
+        break;
+      }
+      decode_dump(header + HEADER_SIZE, count, totals);
+      totals.dumps++;
+      totals.records += count;
+      totals.overwritten += read_le(header + 8, 2);
+      position += HEADER_SIZE + (size_t)count * TRACE_RECORD_SIZE;
+    }
+    return true;
+  }
+
+  void print_state(const char* name, const StateStats& state) {
+    if (state.loops == 0 && state.entered == 0) return;
+    printf("%s: %u loops, entered %u times", name, state.loops, state.entered);
+    if (state.loops == 0) {
+      printf("\n\n");
+      return;
+    }
+    printf(", avg %.1fus, max %uus\n", (double)state.totalUs / state.loops, state.maxUs);
+    uint32_t largest = 0;
+    for (uint32_t bucket : state.buckets) {
+      if (bucket > largest) largest = bucket;
+    }
+    for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+      if (state.buckets[i] == 0) continue;
+      const unsigned long low = i == 0 ? 0 : 1UL << (i - 1);
+      char range[32];
+      if (i == BUCKET_COUNT - 1) {
+        snprintf(range, sizeof(range), ">= %lu", low);
+      } else {
+        snprintf(range, sizeof(range), "%lu - %lu", low, (1UL << i) - 1);
+      }
+      const int bar = (int)(40ULL * state.buckets[i] / largest);
+      printf("  %18sus | %-40.*s %u\n", range, bar, "########################################", state.buckets[i]);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s CAPTURE [CAPTURE...]\n", argv[0]);
+    return 2;
+  }
+  Totals totals = {};
+  totals.minFreeMemory = UINT16_MAX;
+  for (int i = 1; i < argc; i++) {
+    if (!decode_capture(argv[i], totals)) return 1;
+  }
+  if (totals.dumps == 0) {
+    fprintf(stderr, "No trace dumps were found.\n");
+    return 1;
+  }
+
+  printf("%u dumps, %u records (%u overwritten before they were dumped)\n\n", totals.dumps, totals.records, totals.overwritten);
+  for (uint8_t i = 0; i < STATE_COUNT; i++) {
+    print_state(STATE_NAMES[i], totals.states[i]);
+  }
+  print_state(state_name(STATE_COUNT), totals.states[STATE_COUNT]);
+  printf("notes played: %u\n", totals.notes);
+  printf("songs opened: %u (%u failed)", totals.songsOpened, totals.songsFailed);
+  if (totals.sdOpenCount != 0) {
+    printf(", open for %.1fms on average", totals.sdOpenUs / 1000.0 / totals.sdOpenCount);
+  }
+  printf("\n");
+  if (totals.minFreeMemory != UINT16_MAX) {
+    printf("lowest free memory: %uB\n", totals.minFreeMemory);
+  }
+  return 0;
+}